@@ -3,6 +3,7 @@
 
 #include <string>
 #include "utils/Logger.hpp" // Fixed include path
+#include "models/Money.hpp"
 
 namespace AppConfig {
 
@@ -17,6 +18,72 @@ namespace AppConfig {
     constexpr const char* TRANSACTIONS_FILENAME = "transactions.json";
     constexpr const char* BACKUP_SUBDIRECTORY = "backup/"; // Subdirectory within DATA_DIRECTORY for backups
 
+    // Snapshot JSON files are written one compact record per line, streamed straight to the
+    // file. Set to false to pretty-print them instead (larger files, easier to read by hand).
+    // Explicit exports (FileHandler::exportToJson) are always pretty-printed.
+    constexpr bool COMPACT_JSON_SNAPSHOTS = true;
+
+    // === Durability Configuration ===
+    // Snapshots are always rewritten atomically (temp file, fsync, rename). When enabled, log
+    // appends are also fsynced before a save reports success.
+    // Saves that arrive together are written by the writer thread as one append, so they share one fsync.
+    constexpr bool SYNC_JOURNAL_APPENDS = true;
+
+    // === Write-Ahead Log Configuration ===
+    // Wallet and transaction changes are appended to one write-ahead log instead of rewriting
+    // wallets.json and transactions.json. Each commit is a single record (a transfer holds the
+    // debit, the credit and its transaction), so recovery replays it completely or not at all.
+    constexpr bool USE_WRITE_AHEAD_LOG = true;
+    constexpr const char* WRITE_AHEAD_LOG_FILENAME = "wallets.wal";
+    // A checkpoint rewrites both snapshots and empties the log once it holds at least this many
+    // entries and at least as many entries as the snapshots (keeps checkpoint cost amortized O(1)).
+    constexpr size_t CHECKPOINT_MIN_LOG_ENTRIES = 1000;
+    // Per-file journals of older versions; replayed once on startup and removed by the next checkpoint
+    constexpr const char* LEGACY_TRANSACTIONS_JOURNAL_FILENAME = "transactions.journal";
+    constexpr const char* LEGACY_WALLETS_JOURNAL_FILENAME = "wallets.journal";
+
+    // === Binary Snapshot Configuration ===
+    // When enabled, every snapshot is also written as a checksummed binary file next to the JSON
+    // (users.bin, wallets.bin, transactions.bin) and startup loads that instead of parsing JSON.
+    // A binary snapshot that is missing, damaged or older than its JSON file is ignored.
+    constexpr bool USE_BINARY_SNAPSHOTS = true;
+    constexpr const char* BINARY_SNAPSHOT_EXTENSION = ".bin";
+    // Keep writing the JSON snapshots for export and debugging. With binary snapshots enabled this
+    // can be turned off to halve snapshot cost; the JSON files are then only refreshed on migration.
+    constexpr bool WRITE_JSON_SNAPSHOTS = true;
+
+    // === Transaction Archive Configuration ===
+    // Finalized transactions beyond the most recent ones are moved out of memory into immutable,
+    // memory-mapped archive segments under DATA_DIRECTORY + ARCHIVE_SUBDIRECTORY.
+    constexpr bool USE_TRANSACTION_ARCHIVE = true;
+    constexpr const char* ARCHIVE_SUBDIRECTORY = "archive/";
+    // Archive once more than HOT_TRANSACTION_LIMIT transactions are in memory, keeping the newest
+    // HOT_TRANSACTIONS_KEPT. The gap between the two sets how many transactions go into one segment.
+    constexpr size_t HOT_TRANSACTION_LIMIT = 20000;
+    constexpr size_t HOT_TRANSACTIONS_KEPT = 10000;
+    // Checksumming a segment reads all of it; by default only the section table is validated
+    // on startup (every string and posting access is bounds-checked regardless).
+    constexpr bool VERIFY_ARCHIVE_CHECKSUMS_ON_OPEN = false;
+    // Each segment holds transactions of one calendar month (UTC), or one day when enabled, so
+    // history queries for a time range skip the other segments. Once a bucket has passed, its
+    // segments are merged into one.
+    constexpr bool ARCHIVE_BUCKET_BY_DAY = false;
+    // Segments whose newest transaction is older than this are moved to
+    // DATA_DIRECTORY + BACKUP_SUBDIRECTORY + ARCHIVE_SUBDIRECTORY and no longer appear in
+    // history or exports. 0 keeps every segment.
+    constexpr int ARCHIVE_RETENTION_DAYS = 730;
+    // Compaction rewrites segments whose newest transaction is older than this as compressed
+    // blocks of COLD_ARCHIVE_BLOCK_RECORDS records (zstd when the build found it, otherwise a
+    // built-in LZ codec). Reads decompress only the blocks holding the records they return.
+    // 0 never compresses.
+    constexpr int COLD_ARCHIVE_AFTER_DAYS = 90;
+    constexpr size_t COLD_ARCHIVE_BLOCK_RECORDS = 1024;
+    // Only each segment's metadata is read on startup; a segment is mapped the first time a history
+    // query or export needs it. Least recently used segments are unmapped again once more than
+    // ARCHIVE_MAPPED_BYTES_BUDGET bytes are mapped. When disabled every segment stays mapped.
+    constexpr bool LAZY_ARCHIVE_LOADING = true;
+    constexpr size_t ARCHIVE_MAPPED_BYTES_BUDGET = 256 * 1024 * 1024;
+
     // === Logging Configuration ===
     // Directory where log files are stored.
     // Ensure it ends with a slash.
@@ -62,11 +129,32 @@ namespace AppConfig {
 
     // === Wallet Configuration ===
     // Default balance for newly created wallets
-    constexpr double DEFAULT_INITIAL_WALLET_BALANCE = 0.0;
+    constexpr Money DEFAULT_INITIAL_WALLET_BALANCE = Money::fromPoints(0);
+
+    // Wallets are locked in stripes (wallet ID hash modulo this count) so transfers between
+    // unrelated wallets run in parallel without one mutex per wallet
+    constexpr size_t WALLET_LOCK_STRIPES = 64;
+
+    // Idempotency keys of transfers and deposits: the most recent keys are answered from memory
+    // for this long; older retries are matched against the in-memory transactions instead
+    constexpr size_t IDEMPOTENCY_CACHE_CAPACITY = 10000;
+    constexpr int IDEMPOTENCY_KEY_TTL_SECONDS = 600;
+
+    // Pending transfers (WalletService::reserveTransfer) not committed within this time are
+    // cancelled. Expiry is checked by a timer wheel with one slot per HOLD_TIMER_GRANULARITY_SECONDS.
+    constexpr int PENDING_TRANSFER_TIMEOUT_SECONDS = 24 * 60 * 60;
+    constexpr int HOLD_TIMER_GRANULARITY_SECONDS = 60;
+    constexpr size_t HOLD_TIMER_SLOTS = 256;
+
+    // Number of transactions shown per page of "Xem lich su giao dich"
+    constexpr size_t HISTORY_PAGE_SIZE = 10;
 
     // Special Wallet IDs
     constexpr const char* MASTER_WALLET_ID = "MASTER_WALLET_001";
     constexpr const char* SYSTEM_WALLET_ID_FOR_DEPOSITS = "SYSTEM_DEPOSIT_SRC"; // For deposits not from master
+    // Deposits from MASTER_WALLET_ID are debited from one of this many shard wallets
+    // ("MASTER_WALLET_001-S00", ...), so concurrent issuance does not queue on a single record
+    constexpr size_t MASTER_WALLET_SHARDS = 8;
 
 
 } // namespace AppConfig
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../models/Money.hpp"
+
 namespace AppConfig {
     // Password requirements
     constexpr int MIN_PASSWORD_LENGTH = 8;
@@ -31,10 +33,10 @@ namespace AppConfig {
     constexpr int OTP_VALIDITY_SECONDS = 30;
     
     // Transaction limits
-    constexpr double MIN_TRANSACTION_AMOUNT = 0.01;
-    constexpr double MAX_TRANSACTION_AMOUNT = 10000.00;
+    constexpr Money MIN_TRANSACTION_AMOUNT = Money::fromMinorUnits(1);     // 0.01
+    constexpr Money MAX_TRANSACTION_AMOUNT = Money::fromPoints(10000);
     
     // Wallet limits
-    constexpr double MIN_WALLET_BALANCE = 0.00;
-    constexpr double MAX_WALLET_BALANCE = 1000000.00;
+    constexpr Money MIN_WALLET_BALANCE = Money::fromPoints(0);
+    constexpr Money MAX_WALLET_BALANCE = Money::fromPoints(1000000);
 } 
\ No newline at end of file
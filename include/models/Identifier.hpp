@@ -0,0 +1,76 @@
+// include/models/Identifier.hpp
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+// Fixed-width identifier for users, wallets and transactions (16 bytes, no heap allocation).
+// IDs of up to 16 ASCII characters, which covers every generated wallet and transaction ID, are
+// stored inline. Longer ones (user UUIDs, the special wallet IDs) are interned in a process-wide
+// table and stored as a handle. Each text has exactly one representation, so equality and hashing
+// compare two integers instead of strings. Files always store the text, never handles.
+class Identifier {
+public:
+    static constexpr size_t INLINE_CAPACITY = 16;
+
+    constexpr Identifier() : words{0, 0} {}
+    // Implicit so IDs can be assigned from and compared with strings
+    Identifier(std::string_view text);
+    Identifier(const std::string& text) : Identifier(std::string_view(text)) {}
+    Identifier(const char* text) : Identifier(std::string_view(text)) {}
+
+    // Like the constructor, but never adds to the intern table: an ID that would need interning
+    // and was never seen yields an empty Identifier (which matches no record)
+    static Identifier find(std::string_view text);
+
+    bool empty() const { return words[0] == 0 && words[1] == 0; }
+    // Valid while this Identifier lives (interned text lives until exit)
+    std::string_view view() const;
+    std::string str() const { return std::string(view()); }
+
+    bool operator==(const Identifier& other) const { return words[0] == other.words[0] && words[1] == other.words[1]; }
+    bool operator!=(const Identifier& other) const { return !(*this == other); }
+    size_t hash() const { return std::hash<uint64_t>()(words[0] * 0x9E3779B97F4A7C15ull ^ words[1]); }
+
+private:
+    // Inline text is zero padded. An interned ID has INTERNED_MARKER in its last byte (never
+    // part of inline text, which is ASCII) and the handle in its first four bytes.
+    static constexpr unsigned char INTERNED_MARKER = 0x80;
+
+    uint64_t words[2];
+
+    const char* bytes() const { return reinterpret_cast<const char*>(words); }
+    bool isInterned() const { return static_cast<unsigned char>(bytes()[INLINE_CAPACITY - 1]) == INTERNED_MARKER; }
+    static bool fitsInline(std::string_view text);
+    void setInline(std::string_view text);
+    void setHandle(uint32_t handle);
+};
+
+namespace std {
+    template <>
+    struct hash<Identifier> {
+        size_t operator()(const Identifier& id) const { return id.hash(); }
+    };
+}
+
+// IDs appear in messages like strings
+inline std::string operator+(const std::string& lhs, const Identifier& rhs) { return lhs + std::string(rhs.view()); }
+inline std::string operator+(const char* lhs, const Identifier& rhs) { return lhs + std::string(rhs.view()); }
+inline std::string operator+(const Identifier& lhs, const std::string& rhs) { return std::string(lhs.view()) + rhs; }
+inline std::string operator+(const Identifier& lhs, const char* rhs) { return std::string(lhs.view()) + rhs; }
+inline std::ostream& operator<<(std::ostream& out, const Identifier& id) { return out << id.view(); }
+
+inline void to_json(json& j, const Identifier& id) {
+    j = id.str();
+}
+
+inline void from_json(const json& j, Identifier& id) {
+    id = Identifier(j.get<std::string>());
+}
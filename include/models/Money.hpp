@@ -0,0 +1,48 @@
+// include/models/Money.hpp
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Fixed-point point amount stored as a whole number of minor units (1/100 of a point).
+// Arithmetic and comparisons are exact integer operations; doubles only appear
+// at the edges (legacy JSON, display helpers).
+class Money {
+public:
+    static constexpr int64_t MINOR_UNITS_PER_POINT = 100;
+
+    constexpr Money() : minor(0) {}
+
+    static constexpr Money fromMinorUnits(int64_t minorUnits) { return Money(minorUnits); }
+    static constexpr Money fromPoints(int64_t points) { return Money(points * MINOR_UNITS_PER_POINT); }
+    // Rounds to the nearest minor unit (used to migrate legacy double values)
+    static Money fromDouble(double points);
+    // Parses an exact decimal such as "12", "12.5" or "-0.75" (at most two fraction digits)
+    static bool parse(const std::string& text, Money& outValue);
+
+    constexpr int64_t minorUnits() const { return minor; }
+    double toDouble() const { return static_cast<double>(minor) / MINOR_UNITS_PER_POINT; }
+    // Formats with exactly two fraction digits, e.g. "1234.50"
+    std::string toString() const;
+
+    constexpr bool isZero() const { return minor == 0; }
+    constexpr bool isPositive() const { return minor > 0; }
+
+    constexpr Money operator+(Money other) const { return Money(minor + other.minor); }
+    constexpr Money operator-(Money other) const { return Money(minor - other.minor); }
+    constexpr Money operator-() const { return Money(-minor); }
+    Money& operator+=(Money other) { minor += other.minor; return *this; }
+    Money& operator-=(Money other) { minor -= other.minor; return *this; }
+
+    constexpr bool operator==(Money other) const { return minor == other.minor; }
+    constexpr bool operator!=(Money other) const { return minor != other.minor; }
+    constexpr bool operator<(Money other) const { return minor < other.minor; }
+    constexpr bool operator<=(Money other) const { return minor <= other.minor; }
+    constexpr bool operator>(Money other) const { return minor > other.minor; }
+    constexpr bool operator>=(Money other) const { return minor >= other.minor; }
+
+private:
+    constexpr explicit Money(int64_t minorUnits) : minor(minorUnits) {}
+
+    int64_t minor;
+};
@@ -2,9 +2,14 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <ctime>
 #include <nlohmann/json.hpp>
 #include <optional>
+#include <cstdint>
+#include <initializer_list>
+#include "Money.hpp"
+#include "Identifier.hpp"
 
 using json = nlohmann::json;
 
@@ -16,26 +21,44 @@ enum class TransactionStatus {
     Cancelled
 };
 
+// Template a transaction's description is rendered from. Transactions store the template and its
+// arguments instead of the text, which mostly repeats fields the transaction already holds.
+enum class TransactionReason : uint8_t {
+    Note = 0,         // Free text, e.g. written before templates existed. Args: the text
+    Transfer = 1,     // User transfer. Args: sender username
+    Deposit = 2,      // Args: note, initiating user ID
+    AdminDeposit = 3  // Admin transfer from the master wallet. Args: reason, admin user ID
+};
+
 class Transaction {
 public:
-    std::string transactionId;      // Unique identifier for the transaction
-    std::string sourceWalletId;     // ID of the wallet sending the points
-    std::string targetWalletId;     // ID of the wallet receiving the points
-    double amount;                  // Amount of points transferred
-    std::string description;         // Optional description for the transaction
+    Identifier transactionId;       // Unique identifier for the transaction
+    Identifier sourceWalletId;      // ID of the wallet sending the points
+    Identifier targetWalletId;      // ID of the wallet receiving the points
+    Money amount;                   // Amount of points transferred
+    TransactionReason reason;       // Template of the description
+    std::string reasonArgs;         // Template arguments, separated by REASON_ARG_SEPARATOR
     time_t timestamp;               // Timestamp when the transaction was recorded/processed
     TransactionStatus status;        // Current status of the transaction
 
+    static constexpr char REASON_ARG_SEPARATOR = '\x1f';
+
     // Default constructor
     Transaction();
 
+    // Sets the description template and its arguments
+    void setReason(TransactionReason reason, std::initializer_list<std::string_view> args);
+    // Text shown to users, rendered from the template
+    std::string description() const;
+    // Renders a description; also used for archived records, which are never copied to render them
+    static std::string renderDescription(TransactionReason reason, std::string_view args,
+                                         std::string_view sourceWalletId, std::string_view targetWalletId);
+    static bool isValidReason(uint8_t reason) { return reason <= static_cast<uint8_t>(TransactionReason::AdminDeposit); }
+
     // Static utility functions for enum conversion
     static std::string statusToString(TransactionStatus status);
     static TransactionStatus stringToStatus(const std::string& statusStr);
 
-    // JSON serialization
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(Transaction, transactionId, sourceWalletId, targetWalletId, amount, description, timestamp, status)
-
     // Custom JSON conversion for enums
     static void to_json(json& j, const TransactionStatus& status) {
         j = static_cast<int>(status);
@@ -60,4 +83,61 @@ public:
             throw std::runtime_error("TransactionStatus must be a string or integer in JSON");
         }
     }
-};
\ No newline at end of file
+};
+
+// Non-owning, read-only view of a transaction (e.g. a record of a memory-mapped archive segment)
+struct TransactionView {
+    std::string_view transactionId;
+    std::string_view sourceWalletId;
+    std::string_view targetWalletId;
+    std::string_view reasonArgs;
+    Money amount;
+    time_t timestamp = 0;
+    TransactionStatus status = TransactionStatus::Completed;
+    TransactionReason reason = TransactionReason::Note;
+
+    // The view must not outlive tx
+    static TransactionView of(const Transaction& tx);
+    Transaction toTransaction() const;
+    std::string description() const;
+};
+
+// --- nlohmann/json serialization/deserialization for Transaction class ---
+inline void to_json(json& j, const Transaction& tx) {
+    j = json{
+        {"transactionId", tx.transactionId},
+        {"sourceWalletId", tx.sourceWalletId},
+        {"targetWalletId", tx.targetWalletId},
+        {"amountMinor", tx.amount.minorUnits()},
+        {"timestamp", tx.timestamp},
+        {"status", static_cast<int>(tx.status)},
+        {"reason", static_cast<int>(tx.reason)}
+    };
+    if (!tx.reasonArgs.empty()) {
+        j["reasonArgs"] = tx.reasonArgs;
+    }
+}
+
+inline void from_json(const json& j, Transaction& tx) {
+    j.at("transactionId").get_to(tx.transactionId);
+    j.at("sourceWalletId").get_to(tx.sourceWalletId);
+    j.at("targetWalletId").get_to(tx.targetWalletId);
+    if (j.contains("amountMinor")) {
+        tx.amount = Money::fromMinorUnits(j.at("amountMinor").get<int64_t>());
+    } else {
+        tx.amount = Money::fromDouble(j.at("amount").get<double>()); // Legacy floating-point files
+    }
+    if (j.contains("reason")) {
+        const int reason = j.at("reason").get<int>();
+        if (reason < 0 || !Transaction::isValidReason(static_cast<uint8_t>(reason))) {
+            throw std::runtime_error("Invalid TransactionReason value: " + std::to_string(reason));
+        }
+        tx.reason = static_cast<TransactionReason>(reason);
+        tx.reasonArgs = j.value("reasonArgs", std::string());
+    } else {
+        tx.reason = TransactionReason::Note; // Files written before description templates
+        j.at("description").get_to(tx.reasonArgs);
+    }
+    j.at("timestamp").get_to(tx.timestamp);
+    Transaction::from_json(j.at("status"), tx.status);
+}
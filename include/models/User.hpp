@@ -6,18 +6,20 @@
 #include <vector> // Thường không cần trực tiếp trong model User, nhưng có thể cần cho các hàm tiện ích khác
 #include "nlohmann/json.hpp" // Đảm bảo bạn đã có thư viện nlohmann/json trong include path
 #include <optional>
+#include <cstdint>
+#include "Identifier.hpp"
 
 // Sử dụng alias cho nlohmann::json
 using json = nlohmann::json;
 
 // Enum for user roles
-enum class UserRole {
+enum class UserRole : uint8_t {
     RegularUser,
     AdminUser
 };
 
 // Enum for account statuses
-enum class AccountStatus {
+enum class AccountStatus : uint8_t {
     NotActivated,
     Active,
     Inactive
@@ -56,18 +58,17 @@ inline void from_json(const json& j, AccountStatus& status) {
     else status = AccountStatus::NotActivated; // Default to NotActivated for unknown values
 }
 
+// Hot part of an account: the fields lookups, role checks and listings touch. Kept small so
+// scans of the user vector stay within a cache line per user. Credentials and contact details
+// live in UserDetails, stored at the same position of a separate vector.
 class User {
 public:
-    std::string userId;             // Unique identifier for the user (e.g., UUID)
+    Identifier userId;              // Unique identifier for the user (e.g., UUID)
     std::string username;           // Unique login name
-    std::string passwordHash;       // Hashed password
-    std::string fullName;           // Full name of the user
-    std::string email;              // Unique email address
-    std::string phoneNumber;        // Phone number
     UserRole role;                  // Role of the user in the system
     AccountStatus status;           // Current status of the account
-    std::string otpSecretKey;       // Secret key (Base32 encoded) for OTP generation
     bool isTemporaryPassword;       // True if the password was auto-generated and not yet changed
+    bool otpEnabled;                // True once an OTP secret is set (mirrors UserDetails::otpSecretKey)
 
     // Default constructor
     User();
@@ -78,6 +79,19 @@ public:
     static std::string statusToString(AccountStatus status);
     static AccountStatus stringToStatus(const std::string& statusStr);
 
-    // JSON serialization
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(User, userId, username, passwordHash, fullName, email, phoneNumber, role, status, otpSecretKey, isTemporaryPassword)
-};
\ No newline at end of file
+    // JSON serialization. otpEnabled is not stored; it is derived from the details on load.
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(User, userId, username, role, status, isTemporaryPassword)
+};
+
+// Cold part of an account: credentials and personal data, only read by login, OTP checks and
+// profile screens. users.json stores both parts of an account as one object.
+class UserDetails {
+public:
+    std::string passwordHash;       // Hashed password
+    std::string fullName;           // Full name of the user
+    std::string email;              // Unique email address
+    std::string phoneNumber;        // Phone number
+    std::string otpSecretKey;       // Secret key (Base32 encoded) for OTP generation
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(UserDetails, passwordHash, fullName, email, phoneNumber, otpSecretKey)
+};
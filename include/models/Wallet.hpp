@@ -4,19 +4,26 @@
 #include <string>
 #include <ctime>
 #include "nlohmann/json.hpp"
+#include "Money.hpp"
+#include "Identifier.hpp"
 
 using json = nlohmann::json;
 
 class Wallet {
 public:
-    std::string walletId;           // Unique identifier for the wallet
-    std::string userId;             // ID of the user who owns this wallet
-    double balance;                 // Current point balance in the wallet
+    Identifier walletId;            // Unique identifier for the wallet
+    Identifier userId;              // ID of the user who owns this wallet
+    Money balance;                  // Current point balance in the wallet
     time_t creationTimestamp;       // Timestamp of wallet creation
     time_t lastUpdateTimestamp;   // Timestamp of the last balance update
+    // Part of the balance reserved by pending transfers (see WalletService::reserveTransfer).
+    // Not stored: rebuilt from the Pending transactions on load.
+    Money held;
 
     // Default constructor
     Wallet();
+
+    Money available() const { return balance - held; }
 };
 
 // --- nlohmann/json serialization/deserialization for Wallet class ---
@@ -24,7 +31,7 @@ inline void to_json(json& j, const Wallet& w) {
     j = json{
         {"walletId", w.walletId},
         {"userId", w.userId},
-        {"balance", w.balance},
+        {"balanceMinor", w.balance.minorUnits()},
         {"creationTimestamp", w.creationTimestamp},
         {"lastUpdateTimestamp", w.lastUpdateTimestamp}
     };
@@ -33,7 +40,11 @@ inline void to_json(json& j, const Wallet& w) {
 inline void from_json(const json& j, Wallet& w) {
     j.at("walletId").get_to(w.walletId);
     j.at("userId").get_to(w.userId);
-    j.at("balance").get_to(w.balance);
+    if (j.contains("balanceMinor")) {
+        w.balance = Money::fromMinorUnits(j.at("balanceMinor").get<int64_t>());
+    } else {
+        w.balance = Money::fromDouble(j.at("balance").get<double>()); // Legacy floating-point files
+    }
     j.at("creationTimestamp").get_to(w.creationTimestamp);
     j.at("lastUpdateTimestamp").get_to(w.lastUpdateTimestamp);
 }
\ No newline at end of file
@@ -12,14 +12,17 @@
 class AdminService {
 private:
     std::vector<User>& users; // For direct listing if needed, though services should provide views
+    std::vector<UserDetails>& userDetails; // Parallel to users
+    DataIndex& index;
     AuthService& authService;
     UserService& userService;
     WalletService& walletService;
 
 public:
-    AdminService(std::vector<User>& u_ref, AuthService& as_ref, 
-                 UserService& us_ref, WalletService& ws_ref);
+    AdminService(std::vector<User>& u_ref, std::vector<UserDetails>& ud_ref, DataIndex& idx_ref,
+                 AuthService& as_ref, UserService& us_ref, WalletService& ws_ref);
 
+    // Copies only the hot part of each account (see User); UserService::getUserDetails has the rest
     std::vector<User> listAllUsers() const;
 
     bool adminCreateUserAccount(const std::string& username, const std::string& fullName,
@@ -40,6 +43,11 @@ public:
     bool adminDeactivateUser(const std::string& targetUserId, std::string& outMessage);
 
     bool adminDepositToUserWallet(const std::string& adminUserId, // For logging/audit
-                                  const std::string& targetUserId, double amount, 
+                                  const std::string& targetUserId, Money amount, 
                                   const std::string& reason, std::string& outMessage);
+    // Deposits from the master wallet to many users with one commit (e.g. a monthly reward run).
+    // targets holds (user ID, amount) pairs; the results are in the same order.
+    std::vector<PostingResult> adminBatchDepositToUserWallets(const std::string& adminUserId,
+                                                              const std::vector<std::pair<std::string, Money>>& targets,
+                                                              const std::string& reason);
 };
\ No newline at end of file
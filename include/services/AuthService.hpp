@@ -11,16 +11,20 @@
 // Forward declarations for utilities passed as references
 class FileHandler;
 class HashUtils;
+class DataIndex;
 
 class AuthService {
 private:
     std::vector<User>& users;
+    std::vector<UserDetails>& userDetails; // Parallel to users
+    DataIndex& index;
     FileHandler& fileHandler;
     OTPService& otpService;   // Member variable, needs full type
     HashUtils& hashUtils;     // Member variable, needs full type
 
 public:
-    AuthService(std::vector<User>& users_ref, FileHandler& fh_ref, OTPService& otp_ref, HashUtils& hu_ref);
+    AuthService(std::vector<User>& users_ref, std::vector<UserDetails>& details_ref, DataIndex& idx_ref,
+                FileHandler& fh_ref, OTPService& otp_ref, HashUtils& hu_ref);
 
     bool registerUser(const std::string& username, const std::string& password,
                       const std::string& fullName, const std::string& email,
@@ -40,7 +44,7 @@ public:
 
     std::optional<std::string> setupOtpForUser(const std::string& userId, std::string& outMessage);
     
-    bool updateUser(const User& userToUpdate, std::string& outMessage);
+    bool updateUser(const User& userToUpdate, const UserDetails& detailsToUpdate, std::string& outMessage);
     
     bool activateAccount(const std::string& username, std::string& outMessage);
     bool isUsernameExists(const std::string& username) const;
@@ -7,20 +7,26 @@
 #include "models/User.hpp"
 #include "services/OTPService.hpp" // For OTP verification during updates
 
-// Forward declaration for FileHandler
+// Forward declarations
 class FileHandler;
+class DataIndex;
 
 class UserService {
 private:
     std::vector<User>& users;
+    std::vector<UserDetails>& userDetails; // Parallel to users
+    DataIndex& index;
     FileHandler& fileHandler;
     OTPService& otpService;
 
 public:
-    UserService(std::vector<User>& users_ref, FileHandler& fh_ref, OTPService& otp_ref);
+    UserService(std::vector<User>& users_ref, std::vector<UserDetails>& details_ref, DataIndex& idx_ref,
+                FileHandler& fh_ref, OTPService& otp_ref);
 
     std::optional<User> getUserProfile(const std::string& userId) const;
     std::optional<User> getUserByUsername(const std::string& username) const;
+    // Credentials and contact details; only screens that show or edit them need these
+    std::optional<UserDetails> getUserDetails(const std::string& userId) const;
 
     bool updateUserProfile(const std::string& userId,
                            const std::string& newFullName,
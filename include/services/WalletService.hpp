@@ -1,7 +1,14 @@
 // include/services/WalletService.hpp
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <utility>
+#include <thread>
 #include <vector>
 #include <optional>
 #include "../models/User.hpp"
@@ -9,10 +16,48 @@
 #include "../models/Transaction.hpp"
 #include "../utils/FileHandler.hpp"
 #include "../utils/HashUtils.hpp"
+#include "../utils/IdempotencyCache.hpp"
+#include "../utils/TimerWheel.hpp"
 #include "../services/OTPService.hpp"
 #include "../Config.h"
 
+// Filters and paging for WalletService::getTransactionHistoryPage
+struct TransactionHistoryQuery {
+    size_t limit = AppConfig::HISTORY_PAGE_SIZE;
+    std::string cursor;                       // Opaque token from a previous page; empty for the first page
+    std::optional<time_t> fromTimestamp;      // Inclusive lower bound
+    std::optional<time_t> toTimestamp;        // Inclusive upper bound
+    std::optional<TransactionStatus> status;  // Only return transactions with this status
+    std::optional<TransactionReason> reason;  // Only return transactions with this description template
+};
+
+struct TransactionHistoryPage {
+    std::vector<Transaction> transactions;    // Newest first
+    std::string nextCursor;                   // Empty when this is the last page
+};
+
+// One entry of WalletService::postBatch
+struct WalletPosting {
+    std::string targetWalletId;
+    Money amount;
+    // Recorded as the source. Only debited when debitSource is set (a transfer between user wallets,
+    // never from a master wallet shard); otherwise the posting is a deposit like depositPoints.
+    std::string sourceWalletId = AppConfig::SYSTEM_WALLET_ID_FOR_DEPOSITS;
+    bool debitSource = false;
+    TransactionReason reason = TransactionReason::Deposit;
+    // First template argument (the note, the admin's reason or, for TransactionReason::Transfer, the sender's username)
+    std::string description;
+};
+
+struct PostingResult {
+    bool success = false;
+    std::string transactionId; // Empty if the posting was rejected before a transaction was recorded
+    std::string message;
+};
+
 class FileHandler; // Forward declaration
+class DataIndex;   // Forward declaration (shared user/wallet lookups)
+class TransactionArchive; // Forward declaration (memory-mapped history of old transactions)
 class HashUtils;   // Forward declaration (for generating transaction IDs)
 
 class WalletService {
@@ -20,14 +65,95 @@ private:
     std::vector<User>& users; // Needed to get user's OTP secret
     std::vector<Wallet>& wallets;
     std::vector<Transaction>& transactions;
+    DataIndex& index;
+    TransactionArchive& archive;
     FileHandler& fileHandler;
     OTPService& otpService;
     HashUtils& hashUtils; // For generating unique transaction IDs
 
+    // Every public member may be called from several threads at once. Locks are taken in this order:
+    // structureMutex, wallet stripes (lower stripe first), transactionLogMutex, archiveMutex, indexMutex.
+    // Shared for operations on existing wallets; exclusive while wallets are added or
+    // transactions are removed from memory, since either moves records other threads point at.
+    mutable std::shared_mutex structureMutex;
+    // Held while reading and changing a wallet's balance and until that change is committed
+    mutable std::array<std::mutex, AppConfig::WALLET_LOCK_STRIPES> walletStripes;
+    // Guards appends to the transaction vector and every balance write (so a commit copies consistent
+    // wallets). Only held for in-memory work, never for disk writes (except by exportToJson, an admin
+    // operation that must see one consistent state).
+    mutable std::mutex transactionLogMutex;
+    // Guards which archive segments are mapped while the archive is read under a shared structureMutex.
+    // Changing the archive takes structureMutex exclusively instead.
+    mutable std::mutex archiveMutex;
+    // DataIndex catches up with appended records during lookups, so lookups are serialized
+    mutable std::mutex indexMutex;
+
+    // Owner (userId) of the master wallet shards, see ensureMasterWalletShards
+    const Identifier masterWalletId;
+    std::vector<Identifier> masterShardIds; // Empty until the shards exist
+    std::atomic<size_t> masterShardCursor{0};
+
+    // Outcomes of recent requests by idempotency key
+    IdempotencyCache idempotencyCache;
+    // The outcome of an earlier request with this (caller-scoped) key: from the cache, or from the
+    // transaction it recorded, in memory or in the archive (searched through the postings of
+    // postedWalletId, a wallet every transaction of the key's scope involves). Otherwise reserves
+    // the key and returns nothing. A key that cannot be checked is rejected, never run again.
+    std::optional<IdempotencyCache::Outcome> findEarlierOutcome(const std::string& scopedKey,
+                                                                const std::string& transactionId,
+                                                                const std::string& fingerprint,
+                                                                const std::string& postedWalletId,
+                                                                IdempotencyCache::Reservation& outReservation);
+
+    // Deadlines of pending transfers, keyed by transaction ID
+    TimerWheel holdTimers;
+
+    // Looks up the sender and both wallets, checks ownership and the OTP code (structureMutex held
+    // shared). Only the short lookup holds a lock.
+    bool authorizeTransfer(const std::string& senderUserId, const std::string& senderWalletId,
+                           const std::string& receiverWalletId, const std::string& otpCode,
+                           Wallet*& outSenderWallet, Wallet*& outReceiverWallet,
+                           std::string& outSenderUsername, std::string& outMessage);
+    // Commits (moves the held amount) or cancels (releases it) a pending transfer. Only the owner of
+    // the source wallet may settle it; an empty callerUserId is the system (hold expiry).
+    bool settleHold(const std::string& transactionId, const std::string& callerUserId, bool commit,
+                    std::string& outMessage);
+
+    // Calls releaseExpiredHolds every AppConfig::HOLD_TIMER_GRANULARITY_SECONDS, so holds expire
+    // without any other request arriving. Started by restorePendingTransfers.
+    std::mutex holdExpiryMutex;
+    std::condition_variable holdExpiryWake;
+    bool holdExpiryStopping = false;
+    std::thread holdExpiryThread;
+    void holdExpiryLoop();
+
+    bool isMasterShard(const Wallet& wallet) const { return wallet.userId == masterWalletId; }
+    // The shard the next deposit from the master wallet is debited from (index lock held).
+    // Null without shards; such deposits then only record the master ID as their source.
+    Wallet* nextMasterShard();
+
+    size_t stripeIndexFor(const Identifier& walletId) const;
+    std::mutex& stripeFor(const Identifier& walletId) const;
+    // Locks the stripes of both wallets in stripe order; wallets sharing a stripe lock it once
+    std::pair<std::unique_lock<std::mutex>, std::unique_lock<std::mutex>>
+    lockWalletPair(const Identifier& first, const Identifier& second) const;
+
+    // Records that a wallet of `wallets` changed so the next commit writes it
+    void markDirty(const Wallet& wallet) { fileHandler.markWalletDirty(static_cast<size_t>(&wallet - wallets.data())); }
+    // Queues the dirty wallets and new transactions as one write-ahead log record
+    // (transactionLogMutex held). Wait for the returned ticket after releasing the lock.
+    uint64_t queueChanges();
+    // Renames the record of a commit that never reached the disk (transactionLogMutex held), so a
+    // retry with the same idempotency key can post under the ID derived from that key
+    void releaseTransactionId(Transaction& transaction, const std::string& prefix);
+    // Archives old transactions if too many are in memory. Call without holding any lock.
+    void archiveIfNeeded();
+
 public:
     WalletService(std::vector<User>& u_ref, std::vector<Wallet>& w_ref, 
-                  std::vector<Transaction>& t_ref, FileHandler& fh_ref, 
-                  OTPService& otp_ref, HashUtils& hu_ref);
+                  std::vector<Transaction>& t_ref, DataIndex& idx_ref, TransactionArchive& archive_ref,
+                  FileHandler& fh_ref, OTPService& otp_ref, HashUtils& hu_ref);
+    ~WalletService(); // Stops the hold expiry thread
 
     bool createWalletForUser(const std::string& userId, std::string& outMessage);
 
@@ -35,18 +161,81 @@ public:
     std::optional<Wallet> getWalletByWalletId(const std::string& walletId) const;
     std::optional<Wallet> getWalletByUsername(const std::string& username) const;
 
+    // A non-empty idempotencyKey (chosen by the client, unique per sender) makes retries safe:
+    // a repeated call with the same key returns the first call's result without transferring again
     bool transferPoints(const std::string& senderUserId, // To get OTP secret and verify ownership
                         const std::string& senderWalletId,
-                        const std::string& receiverWalletId, double amount,
-                        const std::string& otpCode, std::string& outMessage);
+                        const std::string& receiverWalletId, Money amount,
+                        const std::string& otpCode, std::string& outMessage,
+                        const std::string& idempotencyKey = "");
+
+    // Two-phase transfer for approval flows, with no lock held in between. reserveTransfer checks the
+    // sender like transferPoints and puts the amount on hold: it stays in the sender's balance but
+    // cannot be spent, and a Pending transaction records it. commitTransfer moves the held amount
+    // (Completed), cancelTransfer releases it (Cancelled); both only for the owner of the sender
+    // wallet. Holds not settled within AppConfig::PENDING_TRANSFER_TIMEOUT_SECONDS are cancelled by
+    // releaseExpiredHolds, at most AppConfig::HOLD_TIMER_GRANULARITY_SECONDS after the timeout.
+    bool reserveTransfer(const std::string& senderUserId, const std::string& senderWalletId,
+                         const std::string& receiverWalletId, Money amount, const std::string& otpCode,
+                         std::string& outTransactionId, std::string& outMessage);
+    bool commitTransfer(const std::string& callerUserId, const std::string& transactionId, std::string& outMessage);
+    bool cancelTransfer(const std::string& callerUserId, const std::string& transactionId, std::string& outMessage);
+    // Cancels the holds whose timeout has passed. Runs on a background thread and at the start of
+    // every transfer.
+    void releaseExpiredHolds();
+    // Rebuilds the holds from the Pending transactions and starts the hold expiry thread.
+    // Call at startup, after loading.
+    void restorePendingTransfers();
+
+    // Number of user wallets (the master wallet shards are not included)
+    size_t getUserWalletCount() const;
+    // Sum of all user wallet balances (the master wallet shards are not included).
+    // Exact, since balances are integer minor units.
+    Money getTotalBalance() const;
 
+    // Creates the missing master wallet shards (AppConfig::MASTER_WALLET_SHARDS). Call at startup.
+    // The master wallet issues points, so its shards may go negative; together they hold minus
+    // the points issued from it.
+    bool ensureMasterWalletShards();
+    // The logical master wallet balance: the sum of its shards
+    Money getMasterWalletBalance() const;
+
+    // Exports the users with every wallet and transaction (in memory and archived) as JSON files,
+    // while no transfer or hold expiry changes them (see FileHandler::exportToJson)
+    bool exportToJson(const std::string& directory, const std::vector<User>& users,
+                      const std::vector<UserDetails>& userDetails) const;
+
+    // History covers both in-memory and archived transactions
     std::vector<Transaction> getTransactionHistory(const std::string& walletId) const;
+    // Returns one page of a wallet's history without copying the rest of it
+    TransactionHistoryPage getTransactionHistoryPage(const std::string& walletId,
+                                                     const TransactionHistoryQuery& query) const;
     
-    bool depositPoints(const std::string& targetWalletId, double amount, 
+    // The description is stored as the arguments of reason's template (see TransactionReason).
+    // idempotencyKey works as for transferPoints, with keys unique per initiating user and target wallet.
+    bool depositPoints(const std::string& targetWalletId, Money amount, 
                        const std::string& description, const std::string& initiatedByUserId, // For logging/audit, could be "SYSTEM" or adminId
                        std::string& outMessage, 
-                       const std::string& sourceWalletId = AppConfig::SYSTEM_WALLET_ID_FOR_DEPOSITS);
+                       const std::string& sourceWalletId = AppConfig::SYSTEM_WALLET_ID_FOR_DEPOSITS,
+                       TransactionReason reason = TransactionReason::Deposit,
+                       const std::string& idempotencyKey = "");
+
+    // Applies many deposits and transfers with a single commit. Each posting is validated on its own
+    // and gets its own result (in order); the accepted ones reach the disk together or not at all.
+    // Transfers are checked against the balance left by the postings before them. There is no OTP
+    // check, so this is meant for trusted callers such as AdminService (payroll, reward runs).
+    std::vector<PostingResult> postBatch(const std::vector<WalletPosting>& postings,
+                                         const std::string& initiatedByUserId);
+
+    // Moves the oldest finalized transactions into new archive segments (one per time bucket)
+    // once more than AppConfig::HOT_TRANSACTION_LIMIT are held in memory
+    bool archiveOldTransactions();
+    // Merges the archive segments of past time buckets and retires those past the retention period
+    bool compactArchive();
+    // Drops in-memory transactions that already reached the archive, left behind when an
+    // archive run was interrupted before the transaction snapshot was rewritten. Call at startup.
+    void reconcileWithArchive();
 
-    bool depositToWallet(const std::string& userId, double amount, const std::string& reason,
+    bool depositToWallet(const std::string& userId, Money amount, const std::string& reason,
                        const std::string& sourceWalletId = AppConfig::SYSTEM_WALLET_ID_FOR_DEPOSITS);
 };
\ No newline at end of file
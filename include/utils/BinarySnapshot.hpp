@@ -0,0 +1,41 @@
+// include/utils/BinarySnapshot.hpp
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../models/User.hpp"
+#include "../models/Wallet.hpp"
+#include "../models/Transaction.hpp"
+
+// Versioned, checksummed binary snapshots of the data vectors.
+//
+// File layout (all integers little-endian):
+//   magic "RWSB" | u16 version | u16 record kind | u64 record count | u64 payload size | u32 CRC-32 of payload | u32 reserved
+//   payload: records back to back; strings are u32 length + bytes, timestamps and amounts are i64, enums u8.
+//
+// A snapshot is read with a single sequential read into one buffer and decoded straight into
+// a vector reserved for the record count, without building an intermediate JSON document.
+// Writes replace the file atomically (DurableFile::writeAtomically).
+class BinarySnapshot {
+public:
+    // Version 2 stores transaction descriptions as a template byte and arguments. Snapshots of
+    // another version are ignored and rewritten from the JSON files.
+    static constexpr uint16_t FORMAT_VERSION = 2;
+
+    // A user record holds both parts of the account (the vectors are parallel)
+    static bool write(const std::string& filePath, const std::vector<User>& users,
+                      const std::vector<UserDetails>& details);
+    static bool write(const std::string& filePath, const std::vector<Wallet>& wallets);
+    static bool write(const std::string& filePath, const std::vector<Transaction>& transactions);
+
+    // Each read returns false (leaving outRecords empty) if the file is missing, truncated,
+    // of another kind or version, or fails its checksum; outError then says why.
+    static bool read(const std::string& filePath, std::vector<User>& outRecords,
+                     std::vector<UserDetails>& outDetails, std::string& outError);
+    static bool read(const std::string& filePath, std::vector<Wallet>& outRecords, std::string& outError);
+    static bool read(const std::string& filePath, std::vector<Transaction>& outRecords, std::string& outError);
+
+    static uint32_t crc32(const char* data, size_t size);
+};
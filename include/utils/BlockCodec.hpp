@@ -0,0 +1,30 @@
+// include/utils/BlockCodec.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Codec ids are stored in archive segment headers, so existing values must never change
+enum class CompressionCodec : uint8_t {
+    None = 0,
+    BuiltinLz = 1, // LZ77 with a 64 KiB window (always available)
+    Zstd = 2       // Only when the build found libzstd (REWARD_SYSTEM_HAS_ZSTD)
+};
+
+// Whole-block compression for the cold archive tier.
+//
+// The built-in codec encodes sequences of literals and back-references:
+//   token u8 (literal count << 4 | match length - 4), optional length extension bytes (255 = more),
+//   literals, then u16 offset and optional match extension bytes. The final sequence has
+//   literals only. Decoding checks every length and offset, so damaged input fails cleanly.
+class BlockCodec {
+public:
+    // zstd when available, otherwise the built-in codec
+    static CompressionCodec preferred();
+    static bool isSupported(CompressionCodec codec);
+
+    static bool compress(CompressionCodec codec, const char* data, size_t size, std::string& out);
+    // Fails unless the input decodes to exactly rawSize bytes
+    static bool decompress(CompressionCodec codec, const char* data, size_t size, size_t rawSize, std::string& out);
+};
@@ -0,0 +1,90 @@
+// include/utils/DataIndex.hpp
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include "../models/User.hpp"
+#include "../models/Wallet.hpp"
+#include "../models/Transaction.hpp"
+
+// Hash indexes over the shared user, wallet and transaction vectors.
+// Entries store positions into the vectors, which only ever grow by push_back
+// (or shrink by pop_back on a rolled back insert). Records appended since the last
+// lookup are indexed lazily, a shrunken vector or a stale entry triggers a rebuild,
+// so callers only need to report mutations of indexed fields (see updateUserEmail).
+// users and userDetails are parallel: the details of users[i] are userDetails[i].
+class DataIndex {
+private:
+    std::vector<User>& users;
+    std::vector<UserDetails>& userDetails;
+    std::vector<Wallet>& wallets;
+    std::vector<Transaction>& transactions;
+
+    // Lookups on const services still need to catch up with appended records
+    mutable std::unordered_map<Identifier, size_t> userIdIndex;
+    mutable std::unordered_map<std::string, size_t> usernameIndex;
+    mutable std::unordered_map<std::string, size_t> emailIndex;
+    mutable std::unordered_map<Identifier, size_t> walletIdIndex;
+    mutable std::unordered_map<Identifier, size_t> walletByUserIdIndex; // Without the master wallet shards
+    // Posting lists: positions of every transaction a wallet took part in, ordered by timestamp
+    mutable std::unordered_map<Identifier, std::vector<size_t>> transactionsByWallet;
+    mutable std::unordered_map<Identifier, size_t> transactionIdIndex;
+    mutable size_t indexedUserCount = 0;
+    mutable size_t indexedWalletCount = 0;
+    mutable size_t indexedTransactionCount = 0;
+
+    void syncUsers() const;
+    void syncWallets() const;
+    void syncTransactions() const;
+    void rebuildUsersIndex() const;
+    void rebuildWalletsIndex() const;
+    void rebuildTransactionsIndex() const;
+    void addPosting(const Identifier& walletId, size_t position) const;
+
+    // keyAt(position) returns the indexed field of the user at that position
+    template <typename Key, typename KeyAt>
+    const User* lookupUser(std::unordered_map<Key, size_t>& index, const Key& key, KeyAt keyAt) const;
+    const Wallet* lookupWallet(std::unordered_map<Identifier, size_t>& index, const Identifier& key,
+                               Identifier Wallet::* field) const;
+
+public:
+    DataIndex(std::vector<User>& users_ref, std::vector<UserDetails>& details_ref,
+              std::vector<Wallet>& wallets_ref, std::vector<Transaction>& transactions_ref);
+
+    // Call after the vectors were replaced wholesale (e.g. reloaded from disk)
+    void rebuild();
+    // Rebuild one group of indexes. Each touches only its own vector and maps, so the three
+    // may run concurrently (as on startup) while nothing else uses the index.
+    void rebuildUsers();
+    void rebuildWallets();
+    // Also call after transactions were removed from the front of the vector (moved to the archive)
+    void rebuildTransactions();
+
+    // ID lookups never intern the key, so probing with arbitrary input does not grow the intern table
+    User* findUserById(std::string_view userId);
+    const User* findUserById(std::string_view userId) const;
+    User* findUserByUsername(const std::string& username);
+    const User* findUserByUsername(const std::string& username) const;
+    User* findUserByEmail(const std::string& email);
+    const User* findUserByEmail(const std::string& email) const;
+    // Details of an indexed user (or of a copy of one); null if the user is not in the vector
+    UserDetails* detailsOf(const User& user);
+    const UserDetails* detailsOf(const User& user) const;
+
+    Wallet* findWalletById(std::string_view walletId);
+    const Wallet* findWalletById(std::string_view walletId) const;
+    Wallet* findWalletByUserId(std::string_view userId);
+    const Wallet* findWalletByUserId(std::string_view userId) const;
+
+    // Positions in the transaction vector involving walletId, oldest first
+    const std::vector<size_t>& transactionPositionsForWallet(std::string_view walletId) const;
+    // In-memory transactions only; archived ones are not indexed by ID
+    Transaction* findTransactionById(std::string_view transactionId);
+    const Transaction* findTransactionById(std::string_view transactionId) const;
+
+    // Keeps the email index in sync after a user's email was changed in place
+    void updateUserEmail(const std::string& oldEmail, const User& user);
+};
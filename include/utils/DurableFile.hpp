@@ -0,0 +1,22 @@
+// include/utils/DurableFile.hpp
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+// Crash-safe file replacement helpers.
+class DurableFile {
+public:
+    // Writes the new contents into "<path>.tmp", syncs it to stable storage and renames it over
+    // path, so after a crash the file holds either the old or the new contents, never a mix.
+    // writeContents returns false to abort (the original file is then left untouched).
+    static bool writeAtomically(const std::string& path, const std::function<bool(std::ostream&)>& writeContents,
+                                std::string& outError);
+
+    // fsync of one file, and of the directory holding a file (which makes a rename or a newly
+    // created file durable). On Windows files are flushed with FlushFileBuffers and the directory
+    // needs no sync; on platforms with neither both return false.
+    static bool syncFile(const std::string& path);
+    static bool syncParentDirectory(const std::string& path);
+};
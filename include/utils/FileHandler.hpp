@@ -5,6 +5,13 @@
 #include <vector>
 #include <fstream>  // For std::ifstream, std::ofstream
 #include <iostream> // For error messages
+#include <functional> // For journal replay callbacks
+#include <unordered_map>
+#include <map>
+#include <optional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include "../models/User.hpp"
 #include "../models/Wallet.hpp"
@@ -14,27 +21,159 @@
 // Use a shorter alias for nlohmann::json
 using json = nlohmann::json;
 
+class TransactionArchive; // Forward declaration (archived transactions are included in exports)
+
+// How long a save blocks its caller
+enum class Durability {
+    Wait,    // Return once the data is on disk; the result reports whether the write succeeded
+    Enqueue  // Return once the write is queued; a failed write is logged and repaired by the next save
+};
+
 class FileHandler {
 private:
     std::string usersFilePath;
     std::string walletsFilePath;
     std::string transactionsFilePath;
+    std::string writeAheadLogPath;
+    // Per-file journals written by older versions; replayed once on load, then removed
+    std::string legacyWalletsJournalPath;
+    std::string legacyTransactionsJournalPath;
+    // Binary snapshots written next to the JSON files (see BinarySnapshot.hpp)
+    std::string usersBinaryPath;
+    std::string walletsBinaryPath;
+    std::string transactionsBinaryPath;
+
+    // Write-ahead log bookkeeping. It describes what has been queued (not necessarily written yet)
+    // and is guarded by queueMutex.
+    std::vector<size_t> dirtyWalletPositions;       // Wallets changed since the last commit (may repeat)
+    std::vector<Transaction> updatedTransactions;   // Logged transactions changed since the last commit
+    size_t persistedWalletCount = 0;                // Wallets queued or on disk
+    size_t persistedTransactionCount = 0;           // Transactions queued or on disk
+    size_t logEntries = 0;                          // Wallet and transaction entries in the log since the last checkpoint
+    size_t checkpointEntries = 0;                   // Wallets + transactions written by the last checkpoint
+
+    // Write-behind queue. Saves copy what has to be written into `pending` and a background thread
+    // writes it. Work is coalesced while it waits: a newer users snapshot replaces an older one,
+    // queued commits merge into one log record (wallets last-wins), and a checkpoint supersedes
+    // any commits queued before it.
+    enum PersistStream : unsigned { USERS_STREAM = 1, WALLET_DATA_STREAM = 2 };
+    struct PendingWrites {
+        std::optional<std::vector<User>> users;
+        std::optional<std::vector<UserDetails>> userDetails; // Queued together with users
+        // A checkpoint rewrites both snapshots and starts an empty write-ahead log
+        std::optional<std::vector<Wallet>> checkpointWallets;
+        std::optional<std::vector<Transaction>> checkpointTransactions;
+        // One log record appended after the checkpoint (if any)
+        std::vector<Wallet> walletUpdates;
+        std::unordered_map<Identifier, size_t> walletUpdateIndex;  // walletId -> position in walletUpdates
+        std::vector<Transaction> transactionAppends;
+        std::vector<Transaction> transactionUpdates;  // Replace earlier records with the same ID
+    };
+    std::mutex queueMutex;
+    std::condition_variable workQueued;
+    std::condition_variable batchWritten;
+    PendingWrites pending;
+    uint64_t queuedTicket = 0;     // Last ticket handed to a save
+    uint64_t writtenTicket = 0;    // Every save up to this ticket has been attempted
+    std::map<uint64_t, std::pair<uint64_t, unsigned>> failedBatches; // Last ticket -> (first ticket, failed streams)
+    // Set when writing wallet data failed: the log no longer holds every queued commit, so log
+    // appends fail until a checkpoint has rewritten the snapshots
+    bool logAppendsBlocked = false;
+    bool stopping = false;
+    std::thread writerThread;      // Declared last so it starts after everything it uses
+
+    // Hands out a ticket for work just added to `pending` (queueMutex held) and wakes the writer
+    uint64_t submitLocked();
+    // Blocks for Durability::Wait until the batch holding ticket was written
+    bool awaitWrite(uint64_t ticket, PersistStream stream, Durability durability);
+    void queueCheckpointLocked(const std::vector<Wallet>& wallets, const std::vector<Transaction>& transactions);
+    void writerLoop();
+    // Writes one batch in a fixed order (users, checkpoint, log record); returns the streams that failed.
+    // With appendsBlocked the log record is only written after a checkpoint in the same batch.
+    unsigned writeBatch(PendingWrites& batch, bool appendsBlocked);
 
     // Helper to create directories if they don't exist
     void ensureDirectoryExists(const std::string& filePath);
 
+    // Log helpers. Every record is framed as "<length> <compact json>\n" so a torn final write is
+    // detected on replay. A reset replaces the log atomically; appends are fsynced (SYNC_JOURNAL_APPENDS).
+    // A failed append is cut off again, so later appends never follow a torn record.
+    bool resetWriteAheadLog();
+    bool appendJournalRecords(const std::string& journalPath, const std::vector<json>& records);
+    // Applies every complete commit in the write-ahead log. Wallet states are last-wins and
+    // transactions already present are skipped, so replaying over a newer snapshot is harmless.
+    // Returns false if the log is missing, unreadable or has a torn tail (earlier commits are still applied).
+    bool replayWriteAheadLog(std::vector<Wallet>& wallets, std::vector<Transaction>& transactions,
+                             size_t& outApplied, size_t& outEntries);
+    // Replays an old per-file journal whose header holds the number of snapshot records it extends.
+    // Returns false if the journal was stale or had a torn tail.
+    bool replayJournal(const std::string& journalPath, size_t expectedBaseCount,
+                       const std::function<void(const json&)>& applyRecord, size_t& outApplied);
+
+    // Snapshot loaders; set outNeedsCheckpoint when the files on disk should be rewritten
+    bool loadWalletsSnapshot(std::vector<Wallet>& wallets, bool& outNeedsCheckpoint);
+    bool loadTransactionsSnapshot(std::vector<Transaction>& transactions, bool& outNeedsCheckpoint);
+
+    // Loads a binary snapshot if one exists, is valid and is not older than the JSON file.
+    // Parallel vectors receive the other parts of each record (see BinarySnapshot).
+    template <typename T, typename... Parallel>
+    bool loadBinarySnapshot(const std::string& binaryPath, const std::string& jsonPath, std::vector<T>& records,
+                            std::vector<Parallel>&... parallel);
+
+    // No-op returning true while binary snapshots are disabled
+    template <typename T, typename... Parallel>
+    bool writeBinarySnapshot(const std::string& binaryPath, const std::vector<T>& records,
+                             const std::vector<Parallel>&... parallel);
+
+    bool writeUsersJson(const std::vector<User>& users, const std::vector<UserDetails>& details);
+    bool writeWalletsJson(const std::vector<Wallet>& wallets);
+    bool writeTransactionsJson(const std::vector<Transaction>& transactions);
+    // Full snapshot: the JSON file (if enabled) followed by the binary one
+    bool writeWalletsSnapshot(const std::vector<Wallet>& wallets);
+    bool writeTransactionsSnapshot(const std::vector<Transaction>& transactions);
+
 public:
     FileHandler(const std::string& dataDir = "data/"); // Constructor with default data directory
+    ~FileHandler(); // Writes everything still queued, then stops the writer thread
+    FileHandler(const FileHandler&) = delete;
+    FileHandler& operator=(const FileHandler&) = delete;
+
+    // Loading must finish before the first save is queued.
+
+    // User data. users.json keeps both parts of an account in one object; in memory they are
+    // split into parallel vectors (details[i] belongs to users[i]).
+    bool loadUsers(std::vector<User>& users, std::vector<UserDetails>& details);
+    bool saveUsers(const std::vector<User>& users, const std::vector<UserDetails>& details,
+                   Durability durability = Durability::Wait);
 
-    // User data
-    bool loadUsers(std::vector<User>& users);
-    bool saveUsers(const std::vector<User>& users);
+    // Wallet data: wallets.json and transactions.json plus the write-ahead log holding every
+    // commit since the last checkpoint. Replays the log, so a crash never loses a completed commit.
+    bool loadWalletData(std::vector<Wallet>& wallets, std::vector<Transaction>& transactions);
+    // Records that the wallet at this position of the vector passed to the next commit changed,
+    // so that commit writes it without scanning every wallet
+    void markWalletDirty(size_t position);
+    // Records that a transaction added by an earlier commit changed (e.g. a pending transfer was
+    // settled); the next commit writes this copy of it
+    void markTransactionUpdated(const Transaction& transaction);
+    // Writes the dirty wallets and the transactions added since the last commit as one log
+    // record, so a transfer's debit, credit and transaction record are recovered together or not at all.
+    bool commitWalletData(const std::vector<Wallet>& wallets, const std::vector<Transaction>& transactions,
+                          Durability durability = Durability::Wait);
+    // commitWalletData in two steps: queue the record and get its ticket, then wait for it.
+    // Lets a caller copy the vectors under its own lock and release that lock before waiting.
+    uint64_t queueWalletData(const std::vector<Wallet>& wallets, const std::vector<Transaction>& transactions);
+    bool awaitWalletData(uint64_t ticket);
+    // Rewrites both snapshots from memory and starts an empty log (waits for the write).
+    // Required after wallets or transactions were removed from memory.
+    bool checkpoint(const std::vector<Wallet>& wallets, const std::vector<Transaction>& transactions);
 
-    // Wallet data
-    bool loadWallets(std::vector<Wallet>& wallets);
-    bool saveWallets(const std::vector<Wallet>& wallets);
+    // Blocks until every save queued so far has been written (or has failed)
+    void flush();
 
-    // Transaction data
-    bool loadTransactions(std::vector<Transaction>& transactions);
-    bool saveTransactions(const std::vector<Transaction>& transactions);
+    // Writes pretty-printed users.json, wallets.json and transactions.json into directory for
+    // export and debugging. Archived transactions (if an archive is given) precede in-memory ones.
+    bool exportToJson(const std::string& directory, const std::vector<User>& users,
+                      const std::vector<UserDetails>& userDetails, const std::vector<Wallet>& wallets,
+                      const std::vector<Transaction>& transactions,
+                      const TransactionArchive* archive = nullptr);
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+// include/utils/IdempotencyCache.hpp
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Remembers the outcome of recent requests by their client-supplied idempotency key, so a retry
+// returns the first outcome instead of running the request again. At most `capacity` keys are
+// kept, each for `ttl`; callers check older keys elsewhere (WalletService looks up the transaction
+// whose ID transactionIdFor derived from the key). Thread-safe.
+class IdempotencyCache {
+public:
+    struct Outcome {
+        bool success = false;
+        std::string message;
+        std::string transactionId;
+        std::string fingerprint; // What the request did; a retry with other parameters is rejected
+    };
+
+    // Held by the request that runs under a key. Other requests with the key wait until it is
+    // completed; if it goes out of scope first, the key is released and the next one runs.
+    class Reservation {
+    public:
+        Reservation() = default;
+        Reservation(IdempotencyCache* cache, std::string key) : cache(cache), key(std::move(key)) {}
+        Reservation(Reservation&& other) noexcept;
+        Reservation& operator=(Reservation&& other) noexcept;
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+        ~Reservation();
+
+        bool active() const { return cache != nullptr; }
+        void complete(Outcome outcome);
+
+    private:
+        IdempotencyCache* cache = nullptr;
+        std::string key;
+    };
+
+    IdempotencyCache(size_t capacity, std::chrono::seconds ttl);
+
+    // Returns the stored outcome for key, waiting while another request still holds it.
+    // Otherwise reserves key for the caller (outReservation) and returns nothing.
+    std::optional<Outcome> claim(const std::string& key, Reservation& outReservation);
+
+    // Transaction ID recorded by a request with this key: prefix + 12 hex digits of a hash that is
+    // stable across runs, so a retry after a restart maps to the same transaction
+    static std::string transactionIdFor(const std::string& prefix, const std::string& key);
+
+private:
+    struct Entry {
+        std::optional<Outcome> outcome; // Empty while the request is running
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    std::mutex mutex;
+    std::condition_variable requestDone;
+    size_t capacity;
+    std::chrono::seconds ttl;
+    std::unordered_map<std::string, Entry> entries;
+    // Keys in claim order, which is also expiry order. A key claimed again after being dropped
+    // appears twice; the stale copy is recognized by its expiry time.
+    std::deque<std::pair<std::string, std::chrono::steady_clock::time_point>> order;
+
+    void complete(const std::string& key, Outcome outcome);
+    void release(const std::string& key);
+    // Drops expired keys and, above capacity, the oldest finished ones (mutex held)
+    void evictLocked(std::chrono::steady_clock::time_point now);
+};
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <regex> 
+#include "../models/Money.hpp"
 
 class InputValidator {
 public:
@@ -14,6 +15,7 @@ public:
     static bool isValidPositiveAmount(double amount);
     static bool isValidInteger(const std::string& input, int& outValue);
     static bool isValidDouble(const std::string& input, double& outValue);
+    static bool isValidAmount(const std::string& input, Money& outValue);
 
 private:
     static std::string trim(const std::string& str);
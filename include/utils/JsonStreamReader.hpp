@@ -0,0 +1,20 @@
+// include/utils/JsonStreamReader.hpp
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <string>
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+// Streams a top-level JSON array through nlohmann's SAX interface and hands each element
+// to a callback as soon as it is complete. Only one element is materialized at a time,
+// so peak memory while loading no longer includes a DOM of the whole file.
+class JsonStreamReader {
+public:
+    // Calls onElement for every element of the array (the callback may move from it).
+    // A top-level null or empty input is treated as an empty array. Returns false on a
+    // syntax error or a non-array document; elements before the error were already delivered.
+    static bool readArray(std::istream& in, const std::function<void(json&)>& onElement, std::string& outError);
+};
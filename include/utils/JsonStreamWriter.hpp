@@ -0,0 +1,49 @@
+// include/utils/JsonStreamWriter.hpp
+#pragma once
+
+#include <iomanip>
+#include <ostream>
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+// Writes a JSON array straight to a stream one element at a time, so saving never holds
+// a DOM of the whole vector or a string of the whole document. Compact output puts one
+// element per line; pretty output prints each element with four-space indentation (for exports).
+class JsonStreamWriter {
+public:
+    JsonStreamWriter(std::ostream& out_ref, bool prettyPrint) : out(out_ref), pretty(prettyPrint) {
+        out << '[';
+    }
+
+    template <typename T>
+    void add(const T& element) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        const json j = element; // Only this element is converted at a time
+        if (pretty) {
+            out << std::setw(4) << j;
+        } else {
+            out << j;
+        }
+    }
+
+    template <typename Range>
+    void addAll(const Range& elements) {
+        for (const auto& element : elements) {
+            add(element);
+        }
+    }
+
+    // Closes the array; returns false if any write failed
+    bool finish() {
+        out << (first ? "]" : "\n]");
+        out.flush();
+        return out.good();
+    }
+
+private:
+    std::ostream& out;
+    bool pretty;
+    bool first = true;
+};
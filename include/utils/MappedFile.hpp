@@ -0,0 +1,31 @@
+// include/utils/MappedFile.hpp
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is mmap'ed and on Windows mapped
+// with MapViewOfFile, so its pages are shared with the OS page cache and only faulted in when
+// touched; elsewhere it falls back to reading the file into a private buffer. Move-only.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filePath);
+    void close();
+
+    const char* data() const { return mapped ? mapped : buffer.data(); }
+    size_t size() const { return length; }
+    bool isOpen() const { return mapped != nullptr || !buffer.empty(); }
+
+private:
+    const char* mapped = nullptr; // mmap'ed region, if any
+    std::vector<char> buffer;     // Fallback copy when mapping is unavailable
+    size_t length = 0;
+};
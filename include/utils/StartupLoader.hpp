@@ -0,0 +1,48 @@
+// include/utils/StartupLoader.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../models/User.hpp"
+#include "../models/Wallet.hpp"
+#include "../models/Transaction.hpp"
+
+class FileHandler;        // Forward declaration
+class DataIndex;          // Forward declaration
+class TransactionArchive; // Forward declaration
+
+// Loads the stores on startup. Users, wallet data (wallets, transactions and the write-ahead log)
+// and the transaction archive are read on separate threads, then each store's indexes are
+// built in parallel. Every store is loaded exactly once.
+class StartupLoader {
+public:
+    struct StageTiming {
+        std::string stage;
+        double milliseconds = 0.0;
+    };
+
+    struct Result {
+        bool usersLoaded = false;
+        bool walletDataLoaded = false;
+        bool archiveOpened = true;           // True when the archive is disabled
+        std::vector<StageTiming> timings;    // In completion order, "total" last
+    };
+
+    StartupLoader(FileHandler& fh_ref, DataIndex& idx_ref, TransactionArchive& archive_ref,
+                  std::vector<User>& u_ref, std::vector<UserDetails>& ud_ref,
+                  std::vector<Wallet>& w_ref, std::vector<Transaction>& t_ref);
+
+    // Must run before any service reads the vectors or queues a save. Stages that failed leave
+    // whatever they could load; the timings are also logged.
+    Result run();
+
+private:
+    FileHandler& fileHandler;
+    DataIndex& index;
+    TransactionArchive& archive;
+    std::vector<User>& users;
+    std::vector<UserDetails>& userDetails;
+    std::vector<Wallet>& wallets;
+    std::vector<Transaction>& transactions;
+};
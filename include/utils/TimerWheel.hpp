@@ -0,0 +1,34 @@
+// include/utils/TimerWheel.hpp
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <mutex>
+#include <vector>
+#include "../models/Identifier.hpp"
+
+// Hashed timing wheel: deadlines are rounded up to ticks of `granularity` seconds and kept in
+// slot (tick % slot count), so scheduling is O(1) and advancing only visits the slots of the
+// ticks that passed. A deadline more than one turn away stays in its slot until its turn comes;
+// one that has already passed expires on the next advance.
+// Timers are never removed early; callers ignore IDs that no longer need to expire. Thread-safe.
+class TimerWheel {
+public:
+    TimerWheel(size_t slotCount, time_t granularity, time_t now);
+
+    void schedule(const Identifier& id, time_t deadline);
+    // IDs whose deadline is at or before now, in no particular order
+    std::vector<Identifier> advance(time_t now);
+
+private:
+    struct Timer {
+        Identifier id;
+        time_t tick;
+    };
+
+    std::mutex mutex;
+    std::vector<std::vector<Timer>> slots;
+    std::vector<Identifier> overdue; // Scheduled with a deadline that had already passed
+    time_t granularity;
+    time_t processedTick; // Every timer up to this tick has expired
+};
@@ -0,0 +1,180 @@
+// include/utils/TransactionArchive.hpp
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../models/Transaction.hpp"
+#include "BlockCodec.hpp"
+#include "MappedFile.hpp"
+
+// One immutable archive segment file, mapped into memory:
+//   header (72 bytes; 64 in version 1 segments)
+//   records      fixed 56 bytes each, ordered by timestamp; strings are (offset, length) into the heap
+//   wallet table 16 bytes per wallet (id, first posting, posting count), sorted by wallet id
+//   postings     u32 record numbers per wallet, oldest first
+//   string heap  every distinct string once
+//
+// Compressed (cold) segments, version 3, keep the index uncompressed and pack the records:
+//   header (96 bytes, adds the codec, block table offset, block data offset and block size)
+//   timestamps   i64 per record, so time lookups never decompress anything
+//   block table  40 bytes per block (oldest and newest timestamp, offset, packed and raw size, CRC-32)
+//   wallet table, postings and string heap (wallet ids only) as above
+//   block data   each block decompresses to its records followed by their own string heap
+class ArchiveSegment {
+public:
+    // Record numbers of one wallet's transactions, oldest first; a view into the mapping
+    class Postings {
+    public:
+        size_t size() const { return count; }
+        uint32_t operator[](size_t i) const;
+
+    private:
+        friend class ArchiveSegment;
+        const char* data = nullptr;
+        size_t count = 0;
+    };
+
+    // Validates the file and reads its metadata, leaving the data mapped until unload()
+    bool open(const std::string& filePath, uint64_t sequence, bool verifyChecksum, std::string& outError);
+    // Maps the data again after unload(); false if the file vanished or no longer matches
+    bool load() const;
+    void unload() const;
+    bool isLoaded() const { return file.isOpen(); }
+    // Mapping plus decompressed blocks
+    size_t mappedBytes() const { return file.size() + decodedBytes; }
+
+    // Metadata, available while unloaded
+    const std::string& path() const { return filePath; }
+    uint64_t sequence() const { return sequenceNumber; }
+    // Oldest segment merged into this one by compaction; its own sequence if it was never merged
+    uint64_t firstMergedSequence() const { return firstSequence; }
+    size_t recordCount() const { return records; }
+    bool isCompressed() const { return compressed; }
+    // Range of the record timestamps (records are ordered by timestamp)
+    time_t oldestTimestamp() const { return oldest; }
+    time_t newestTimestamp() const { return newest; }
+    // Transaction appended last (in journal order) when the segment was written
+    std::string_view lastAppendedTransactionId() const { return lastAppendedId; }
+
+    // Data access; an unloaded segment reads as empty. The views' strings point into the
+    // mapping (or a decompressed block) and stay valid while the segment is loaded.
+    TransactionView record(size_t recordNumber) const;
+    // Timestamp of a record without decompressing its block
+    time_t timestampAt(size_t recordNumber) const;
+    Postings postingsForWallet(const std::string& walletId) const;
+
+private:
+    friend class TransactionArchive;
+
+    std::string filePath;
+    uint64_t sequenceNumber = 0;
+    uint64_t firstSequence = 0;
+    size_t records = 0;
+    size_t walletCount = 0;
+    size_t postingCount = 0;
+    time_t oldest = 0;
+    time_t newest = 0;
+    std::string lastAppendedId;
+    bool compressed = false;
+    CompressionCodec codec = CompressionCodec::None;
+    size_t blockCount = 0;
+    size_t blockRecords = 0;
+    mutable uint64_t lastUse = 0; // TransactionArchive's use clock when last acquired
+
+    // Mapping state; rebuilt by load()
+    mutable MappedFile file;
+    mutable const char* recordBase = nullptr;    // Uncompressed segments
+    mutable const char* timestampBase = nullptr; // Compressed segments
+    mutable const char* blockTable = nullptr;
+    mutable const char* blockData = nullptr;
+    mutable size_t blockDataSize = 0;
+    // Blocks decompressed since the segment was loaded (node-based, so the strings never move)
+    mutable std::unordered_map<size_t, std::string> decodedBlocks;
+    mutable size_t decodedBytes = 0;
+    mutable const char* walletBase = nullptr;
+    mutable const char* postingBase = nullptr;
+    mutable const char* heap = nullptr;
+    mutable size_t heapSize = 0;
+
+    // Fields read from the header by map()
+    struct Header {
+        size_t records = 0;
+        size_t walletCount = 0;
+        size_t postingCount = 0;
+        uint64_t firstSequence = 0;
+        uint32_t lastIdOffset = 0;
+        uint32_t lastIdLength = 0;
+        bool compressed = false;
+        CompressionCodec codec = CompressionCodec::None;
+        size_t blockCount = 0;
+        size_t blockRecords = 0;
+    };
+    // Maps the file and checks its header against the section table
+    bool map(bool verifyChecksum, Header& outHeader, std::string& outError) const;
+    std::string_view heapString(uint32_t offset, uint32_t length) const;
+    const std::string* decodeBlock(size_t block) const;
+};
+
+// Directory of archive segments holding finalized transactions that were moved out of
+// the in-memory transaction vector. Segments are never modified once written.
+//
+// Segments are bucketed by time (see AppConfig::ARCHIVE_BUCKET_BY_DAY): each one holds
+// transactions of a single month or day, so a time-range query only touches the segments whose
+// range overlaps it. Compaction replaces the segments of a bucket that has passed with one merged
+// segment and moves segments past the retention period into the retired directory.
+class TransactionArchive {
+public:
+    TransactionArchive(const std::string& directoryPath, const std::string& retiredDirectoryPath);
+
+    // Maps every segment in the directory, oldest first. Finishes a merge that was interrupted
+    // after its merged segment was written.
+    bool open();
+    // Writes transactions [first, first + count) (in journal order) as a new segment and maps it.
+    // The caller keeps one segment to one time bucket.
+    bool appendSegment(const std::vector<Transaction>& transactions, size_t first, size_t count);
+    // Merges the segments of every bucket before the one holding 'now', compresses segments older
+    // than AppConfig::COLD_ARCHIVE_AFTER_DAYS and retires segments whose newest transaction is
+    // older than AppConfig::ARCHIVE_RETENTION_DAYS (never the newest segment). Returns false if a
+    // rewrite or a move failed (the archive stays consistent).
+    bool compact(time_t now);
+
+    // Segment metadata, oldest first; use acquire() before reading records or postings
+    const std::vector<ArchiveSegment>& segments() const { return loadedSegments; }
+    size_t transactionCount() const;
+
+    // Maps the segment at position on first use and marks it most recently used (nullptr if it
+    // cannot be mapped). Views taken from it stay valid until the next releaseCold().
+    const ArchiveSegment* acquire(size_t position) const;
+    // Unmaps least recently used segments while more than AppConfig::ARCHIVE_MAPPED_BYTES_BUDGET
+    // bytes are mapped. Call only while no views into segments are held.
+    void releaseCold() const;
+    size_t mappedBytes() const;
+
+    // UTC bucket of a timestamp: yyyymm, or yyyymmdd when bucketing by day
+    static uint32_t timeBucket(time_t timestamp);
+
+private:
+    std::string directory;
+    std::string retiredDirectory;
+    std::vector<ArchiveSegment> loadedSegments;
+    uint64_t nextSequence = 1;
+    mutable uint64_t useClock = 0;
+    bool allSegmentsOpened = true; // Merges are skipped otherwise (see compact)
+
+    std::string segmentPath(uint64_t sequence, uint32_t bucket) const;
+    // Applies AppConfig::LAZY_ARCHIVE_LOADING to a segment that was just opened
+    void afterOpen(ArchiveSegment& segment) const;
+    // Writes records (already in timestamp order) as a segment file and maps it into outSegment
+    bool writeSegment(const std::vector<TransactionView>& records, std::string_view lastAppendedId,
+                      uint64_t sequence, uint64_t firstMergedSequence, bool compressed, ArchiveSegment& outSegment);
+    // Replaces the segments at the given positions (oldest first, one bucket) with one segment
+    // that takes over the newest one's sequence
+    bool mergeSegments(const std::vector<size_t>& positions, bool compressed);
+    // Rewrites an uncompressed segment in compressed blocks
+    bool compressSegment(size_t position);
+    bool retireSegment(ArchiveSegment& segment);
+};
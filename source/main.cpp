@@ -19,6 +19,9 @@
 #include "../include/utils/Logger.hpp"
 #include "../include/utils/TimeUtils.hpp"
 #include "../include/utils/DataInitializer.hpp"
+#include "../include/utils/DataIndex.hpp"
+#include "../include/utils/TransactionArchive.hpp"
+#include "../include/utils/StartupLoader.hpp"
 
 // Services
 #include "../include/services/OTPService.hpp"   // <<< ENSURE THESE ARE PRESENT AND CORRECT
@@ -31,6 +34,7 @@
 
 // Global data or application state
 std::vector<User> g_users;
+std::vector<UserDetails> g_userDetails; // Credentials and contact details, parallel to g_users
 std::vector<Wallet> g_wallets;
 std::vector<Transaction> g_transactions;
 std::optional<User> g_currentUser;
@@ -45,7 +49,7 @@ void displayAdminMenu(const User& admin); // User type is known
 
 // Prototypes for handler functions - types like AuthService, WalletService should now be known
 void handleRegistration(AuthService& authService, WalletService& walletService);
-void handleLogin(AuthService& authService);
+void handleLogin(AuthService& authService, UserService& userService);
 void handleUserActions(UserService& userService, AuthService& authService, WalletService& walletService, OTPService& otpService, int choice);
 void handleAdminActions(AdminService& adminService, UserService& userService, AuthService& authService, WalletService& walletService, OTPService& otpService, int choice);
 
@@ -53,6 +57,7 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
 std::string getStringInput(const std::string& prompt, bool allowEmpty = false);
 int getIntInput(const std::string& prompt);
 double getDoubleInput(const std::string& prompt);
+Money getMoneyInput(const std::string& prompt); // 'b' returns zero
 void clearScreen();
 void pauseScreen();
 
@@ -66,10 +71,14 @@ int main() {
     FileHandler fileHandler;
     HashUtils hashUtils;
     OTPService otpService;
-    AuthService authService(g_users, fileHandler, otpService, hashUtils);
-    UserService userService(g_users, fileHandler, otpService);
-    WalletService walletService(g_users, g_wallets, g_transactions, fileHandler, otpService, hashUtils);
-    AdminService adminService(g_users, authService, userService, walletService);
+    DataIndex dataIndex(g_users, g_userDetails, g_wallets, g_transactions);
+    TransactionArchive transactionArchive(std::string(AppConfig::DATA_DIRECTORY) + AppConfig::ARCHIVE_SUBDIRECTORY,
+                                          std::string(AppConfig::DATA_DIRECTORY) + AppConfig::BACKUP_SUBDIRECTORY +
+                                              AppConfig::ARCHIVE_SUBDIRECTORY);
+    AuthService authService(g_users, g_userDetails, dataIndex, fileHandler, otpService, hashUtils);
+    UserService userService(g_users, g_userDetails, dataIndex, fileHandler, otpService);
+    WalletService walletService(g_users, g_wallets, g_transactions, dataIndex, transactionArchive, fileHandler, otpService, hashUtils);
+    AdminService adminService(g_users, g_userDetails, dataIndex, authService, userService, walletService);
 
     // 3. Khởi tạo các file dữ liệu nếu chưa tồn tại
     LOG_INFO("Kiem tra va khoi tao du lieu...");
@@ -80,20 +89,31 @@ int main() {
 
     // 4. Tải dữ liệu ban đầu
     LOG_INFO("Dang tai du lieu...");
-    if (!fileHandler.loadUsers(g_users)) {
+    StartupLoader startupLoader(fileHandler, dataIndex, transactionArchive, g_users, g_userDetails, g_wallets,
+                                g_transactions);
+    const StartupLoader::Result loaded = startupLoader.run();
+    if (!loaded.usersLoaded) {
         LOG_ERROR("Khong the tai du lieu nguoi dung. Co the file bi loi hoac khong ton tai.");
     } else {
         LOG_INFO("Tai " + std::to_string(g_users.size()) + " nguoi dung thanh cong.");
     }
-    if (!fileHandler.loadWallets(g_wallets)) {
-        LOG_ERROR("Khong the tai du lieu vi. Co the file bi loi hoac khong ton tai.");
+    if (!loaded.walletDataLoaded) {
+        LOG_ERROR("Khong the tai du lieu vi va giao dich. Co the file bi loi hoac khong ton tai.");
     } else {
-        LOG_INFO("Tai " + std::to_string(g_wallets.size()) + " vi thanh cong.");
+        LOG_INFO("Tai " + std::to_string(g_wallets.size()) + " vi va " +
+                 std::to_string(g_transactions.size()) + " giao dich thanh cong.");
     }
-    if (!fileHandler.loadTransactions(g_transactions)) {
-        LOG_ERROR("Khong the tai du lieu giao dich. Co the file bi loi hoac khong ton tai.");
-    } else {
-        LOG_INFO("Tai " + std::to_string(g_transactions.size()) + " giao dich thanh cong.");
+    if (AppConfig::USE_TRANSACTION_ARCHIVE) {
+        if (!loaded.archiveOpened) {
+            LOG_ERROR("Mot so phan luu tru giao dich khong the mo. Lich su giao dich co the khong day du.");
+        }
+        walletService.reconcileWithArchive();
+        walletService.archiveOldTransactions(); // A large legacy log is moved out of memory right away
+        walletService.compactArchive();
+    }
+    if (loaded.walletDataLoaded) {
+        walletService.ensureMasterWalletShards(); // Deposits from the master wallet are spread over these
+        walletService.restorePendingTransfers();
     }
 
 
@@ -117,13 +137,11 @@ int main() {
             LOG_INFO("Tao tai khoan Admin thanh cong. Ten dang nhap: admin, Mat khau tam thoi: " + tempPass);
             LOG_INFO("Vui long doi mat khau sau khi dang nhap lan dau.");
             // Admin cũng cần ví
-            for(const auto& u : g_users){
-                if(u.username == "admin"){
-                    std::string walletMsg;
-                    walletService.createWalletForUser(u.userId, walletMsg);
-                    LOG_INFO(walletMsg);
-                    break;
-                }
+            auto adminUserOpt = authService.findUserByUsername("admin");
+            if (adminUserOpt) {
+                std::string walletMsg;
+                walletService.createWalletForUser(adminUserOpt.value()->userId.str(), walletMsg);
+                LOG_INFO(walletMsg);
             }
         } else {
             LOG_ERROR("Tao tai khoan Admin mac dinh that bai: " + adminMsg);
@@ -147,7 +165,7 @@ int main() {
                     handleRegistration(authService, walletService);
                     break;
                 case 2: // Đăng nhập
-                    handleLogin(authService);
+                    handleLogin(authService, userService);
                     // Kiểm tra nếu đăng nhập thành công và là mật khẩu tạm
                     if (g_currentUser.has_value() && g_currentUser.value().isTemporaryPassword) {
                         std::cout << "Ban dang su dung mat khau tam thoi. Vui long doi mat khau moi." << std::endl;
@@ -195,6 +213,7 @@ int main() {
         }
     }
 
+    fileHandler.flush(); // Writes still queued in the background (e.g. profile edits)
     LOG_INFO("Ung dung ket thuc.");
     return 0;
 }
@@ -255,6 +274,21 @@ double getDoubleInput(const std::string& prompt) {
     }
 }
 
+Money getMoneyInput(const std::string& prompt) {
+    std::string input;
+    Money value;
+    while (true) {
+        input = getStringInput(prompt);
+        if (input == "b") {
+            return Money(); // Zero: callers treat it as going back to the menu
+        }
+        if (InputValidator::isValidAmount(input, value)) {
+            return value;
+        }
+        std::cout << "So diem khong hop le (toi da 2 chu so thap phan). Vui long nhap lai." << std::endl;
+    }
+}
+
 void displayMainMenu() {
     clearScreen();
     std::cout << "===== HE THONG VI DIEM THUONG =====" << std::endl;
@@ -330,16 +364,10 @@ void handleRegistration(AuthService& authService, WalletService& walletService)
     if (authService.registerUser(username, password, fullName, email, phone, UserRole::RegularUser, msg)) {
         std::cout << msg << std::endl;
         // Tự động tạo ví cho người dùng mới
-        User newUser; // Cần tìm lại user vừa tạo để lấy ID
-        for(const auto& u : g_users){
-            if(u.username == username){
-                newUser = u;
-                break;
-            }
-        }
-        if(!newUser.userId.empty()){
+        auto newUserOpt = authService.findUserByUsername(username); // Cần tìm lại user vừa tạo để lấy ID
+        if(newUserOpt){
             std::string walletMsg;
-            walletService.createWalletForUser(newUser.userId, walletMsg);
+            walletService.createWalletForUser(newUserOpt.value()->userId.str(), walletMsg);
         }
     } else {
         std::cout << "Dang ky that bai: " << msg << std::endl;
@@ -347,7 +375,7 @@ void handleRegistration(AuthService& authService, WalletService& walletService)
     pauseScreen();
 }
 
-void handleLogin(AuthService& authService) {
+void handleLogin(AuthService& authService, UserService& userService) {
     clearScreen();
     std::cout << "--- Dang Nhap ---" << std::endl;
     std::cout << "Nhan 'b' de quay lai menu chinh" << std::endl;
@@ -368,7 +396,8 @@ void handleLogin(AuthService& authService) {
     if (userOpt) {
         g_currentUser = userOpt.value();
         LOG_INFO("User " + username + " logged in with role: " + User::roleToString(g_currentUser.value().role));
-        std::cout << msg << " Chao mung, " << g_currentUser.value().fullName << "!" << std::endl;
+        const auto detailsOpt = userService.getUserDetails(g_currentUser.value().userId.str());
+        std::cout << msg << " Chao mung, " << (detailsOpt ? detailsOpt->fullName : username) << "!" << std::endl;
     } else {
         std::cout << "Dang nhap that bai: " << msg << std::endl;
     }
@@ -399,14 +428,15 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
         case 1: { // Xem thông tin
             clearScreen();
             std::cout << "--- Thong Tin Ca Nhan ---" << std::endl;
+            const UserDetails details = userService.getUserDetails(user.userId.str()).value_or(UserDetails());
             std::cout << "ID: " << user.userId << std::endl;
             std::cout << "Ten dang nhap: " << user.username << std::endl;
-            std::cout << "Ho ten: " << user.fullName << std::endl;
-            std::cout << "Email: " << user.email << std::endl;
-            std::cout << "So dien thoai: " << user.phoneNumber << std::endl;
+            std::cout << "Ho ten: " << details.fullName << std::endl;
+            std::cout << "Email: " << details.email << std::endl;
+            std::cout << "So dien thoai: " << details.phoneNumber << std::endl;
             std::cout << "Vai tro: " << User::roleToString(user.role) << std::endl;
             std::cout << "Trang thai: " << User::statusToString(user.status) << std::endl;
-            std::cout << "OTP da thiet lap: " << (user.otpSecretKey.empty() ? "Chua" : "Roi") << std::endl;
+            std::cout << "OTP da thiet lap: " << (user.otpEnabled ? "Roi" : "Chua") << std::endl;
             pauseScreen();
             break;
         }
@@ -432,12 +462,13 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
                 break;
             }
             
-            if (newFullName.empty()) newFullName = user.fullName;
-            if (newEmail.empty()) newEmail = user.email;
-            if (newPhone.empty()) newPhone = user.phoneNumber;
+            const UserDetails details = userService.getUserDetails(user.userId.str()).value_or(UserDetails());
+            if (newFullName.empty()) newFullName = details.fullName;
+            if (newEmail.empty()) newEmail = details.email;
+            if (newPhone.empty()) newPhone = details.phoneNumber;
 
             otpCode = "";
-            if (!user.otpSecretKey.empty()) { // Nếu đã thiết lập OTP, yêu cầu OTP
+            if (user.otpEnabled) { // Nếu đã thiết lập OTP, yêu cầu OTP
                 otpCode = getStringInput("Nhap ma OTP (neu da thiet lap, Go 'b' de quay lai menu): ", true);
                 if (otpCode == "b") {
                     std::cout << "Quay lai menu truoc..." << std::endl;
@@ -446,9 +477,9 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
                 }
             }
 
-            if (userService.updateUserProfile(user.userId, newFullName, newEmail, newPhone, otpCode, msg)) {
+            if (userService.updateUserProfile(user.userId.str(), newFullName, newEmail, newPhone, otpCode, msg)) {
                 std::cout << msg << std::endl;
-                auto updatedUserOpt = userService.getUserProfile(user.userId);
+                auto updatedUserOpt = userService.getUserProfile(user.userId.str());
                 if(updatedUserOpt) g_currentUser = updatedUserOpt.value();
             } else {
                 std::cout << "That bai: " << msg << std::endl;
@@ -474,7 +505,7 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
             std::string otpCode = "";
             std::string msg;
             
-            if (!user.otpSecretKey.empty()) {
+            if (user.otpEnabled) {
                 otpCode = getStringInput("Nhap ma OTP (Go 'b' de quay lai menu): ");
                 if (otpCode == "b") {
                     std::cout << "Quay lai menu truoc..." << std::endl;
@@ -483,7 +514,7 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
                 }
             }
             
-            if (authService.changePassword(user.userId, oldPass, newPass, otpCode, msg)) {
+            if (authService.changePassword(user.userId.str(), oldPass, newPass, otpCode, msg)) {
                 std::cout << msg << std::endl;
             } else {
                 std::cout << "Loi: " << msg << std::endl;
@@ -494,7 +525,7 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
         case 4: { // Thiết lập OTP
             clearScreen();
             std::cout << "--- Thiet Lap/Xem OTP ---" << std::endl;
-            if (user.otpSecretKey.empty()) {
+            if (!user.otpEnabled) {
                 std::cout << "Ban chua thiet lap OTP. Ban co muon thiet lap khong? (y/n, Go 'b' de quay lai menu): ";
                 std::string choiceOtp = getStringInput("");
                 if (choiceOtp == "b") {
@@ -503,7 +534,7 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
                     break;
                 }
                 if (choiceOtp == "y" || choiceOtp == "Y") {
-                    std::optional<std::string> secretKeyOpt = authService.setupOtpForUser(user.userId, msg);
+                    std::optional<std::string> secretKeyOpt = authService.setupOtpForUser(user.userId.str(), msg);
                     if (secretKeyOpt) {
                         std::cout << msg << std::endl;
                         std::cout << "Khoa bi mat cua ban (Base32): " << secretKeyOpt.value() << std::endl;
@@ -511,7 +542,7 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
                         std::cout << "URI (cho QR code, sao chep va dan vao trinh tao QR): " << std::endl;
                         std::cout << otpService.generateOtpUri(user.username, secretKeyOpt.value()) << std::endl;
                         // Cập nhật g_currentUser
-                        auto updatedUserOpt = userService.getUserProfile(user.userId);
+                        auto updatedUserOpt = userService.getUserProfile(user.userId.str());
                         if(updatedUserOpt) g_currentUser = updatedUserOpt.value();
                     } else {
                         std::cout << "That bai: " << msg << std::endl;
@@ -519,9 +550,10 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
                 }
             } else {
                 std::cout << "OTP da duoc thiet lap." << std::endl;
-                std::cout << "Khoa bi mat cua ban (Base32): " << user.otpSecretKey << std::endl;
+                const UserDetails details = userService.getUserDetails(user.userId.str()).value_or(UserDetails());
+                std::cout << "Khoa bi mat cua ban (Base32): " << details.otpSecretKey << std::endl;
                 std::cout << "URI (cho QR code, sao chep va dan vao trinh tao QR): " << std::endl;
-                std::cout << otpService.generateOtpUri(user.username, user.otpSecretKey) << std::endl;
+                std::cout << otpService.generateOtpUri(user.username, details.otpSecretKey) << std::endl;
             }
             pauseScreen();
             break;
@@ -529,9 +561,13 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
         case 5: { // Xem số dư ví
             clearScreen();
             std::cout << "--- So Du Vi ---" << std::endl;
-            auto walletOpt = walletService.getWalletByUserId(user.userId);
+            auto walletOpt = walletService.getWalletByUserId(user.userId.str());
             if (walletOpt) {
-                std::cout << "So du hien tai: " << std::fixed << std::setprecision(2) << walletOpt.value().balance << " diem" << std::endl;
+                std::cout << "So du hien tai: " << walletOpt.value().balance.toString() << " diem" << std::endl;
+                if (walletOpt.value().held.isPositive()) {
+                    std::cout << "Dang giu cho giao dich cho xu ly: " << walletOpt.value().held.toString()
+                              << " diem (kha dung: " << walletOpt.value().available().toString() << " diem)" << std::endl;
+                }
             } else {
                 std::cout << "Khong tim thay thong tin vi. Vui long lien he ho tro." << std::endl;
             }
@@ -541,7 +577,7 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
         case 6: { // Chuyển điểm
             clearScreen();
             std::cout << "--- Chuyen Diem ---" << std::endl;
-            auto senderWalletOpt = walletService.getWalletByUserId(user.userId);
+            auto senderWalletOpt = walletService.getWalletByUserId(user.userId.str());
             if (!senderWalletOpt) {
                 std::cout << "Loi: Khong tim thay vi cua ban." << std::endl;
                 pauseScreen();
@@ -561,15 +597,15 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
                 break;
             }
             
-            double amount = getDoubleInput("Nhap so diem muon chuyen (hoac 0 de quay lai): ");
-            if (amount == 0) {
+            Money amount = getMoneyInput("Nhap so diem muon chuyen (hoac 0 de quay lai): ");
+            if (amount.isZero()) {
                 std::cout << "Quay lai menu truoc..." << std::endl;
                 pauseScreen();
                 break;
             }
             
             otpCode = "";
-            if (!user.otpSecretKey.empty()) {
+            if (user.otpEnabled) {
                  otpCode = getStringInput("Nhap ma OTP cua ban (hoac 'b' de quay lai): ");
                  if (otpCode == "b") {
                     std::cout << "Quay lai menu truoc..." << std::endl;
@@ -578,8 +614,8 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
                  }
             }
 
-            if (walletService.transferPoints(user.userId, senderWalletOpt.value().walletId, 
-                                          receiverWalletOpt.value().walletId, amount, otpCode, msg)) {
+            if (walletService.transferPoints(user.userId.str(), senderWalletOpt.value().walletId.str(), 
+                                          receiverWalletOpt.value().walletId.str(), amount, otpCode, msg)) {
                 std::cout << "Thanh cong: " << msg << std::endl;
             } else {
                 std::cout << "That bai: " << msg << std::endl;
@@ -590,25 +626,40 @@ void handleUserActions(UserService& userService, AuthService& authService, Walle
         case 7: { // Xem lịch sử giao dịch
             clearScreen();
             std::cout << "--- Lich Su Giao Dich ---" << std::endl;
-            auto walletOpt = walletService.getWalletByUserId(user.userId);
+            auto walletOpt = walletService.getWalletByUserId(user.userId.str());
             if (walletOpt) {
-                std::vector<Transaction> history = walletService.getTransactionHistory(walletOpt.value().walletId);
-                if (history.empty()) {
-                    std::cout << "Khong co giao dich nao." << std::endl;
-                } else {
-                    for (const auto& tx : history) {
+                TransactionHistoryQuery query;
+                int pageNumber = 1;
+                while (true) {
+                    TransactionHistoryPage page = walletService.getTransactionHistoryPage(walletOpt.value().walletId.str(), query);
+                    if (page.transactions.empty()) {
+                        if (pageNumber == 1) std::cout << "Khong co giao dich nao." << std::endl;
+                        break;
+                    }
+                    std::cout << "=== Trang " << pageNumber << " ===" << std::endl;
+                    for (const auto& tx : page.transactions) {
                         std::cout << "---------------------------" << std::endl;
                         std::cout << "ID Giao Dich: " << tx.transactionId << std::endl;
                         std::cout << "Thoi gian: " << TimeUtils::formatTimestamp(tx.timestamp) << std::endl;
                         std::cout << "Tu Vi: " << tx.sourceWalletId << std::endl;
                         std::cout << "Den Vi: " << tx.targetWalletId << std::endl;
-                        std::cout << "So diem: " << std::fixed << std::setprecision(2) << tx.amount << std::endl;
+                        std::cout << "So diem: " << tx.amount.toString() << std::endl;
                         std::cout << "Trang thai: " << Transaction::statusToString(tx.status) << std::endl;
-                        if (!tx.description.empty()) {
-                            std::cout << "Mo ta: " << tx.description << std::endl;
+                        const std::string description = tx.description();
+                        if (!description.empty()) {
+                            std::cout << "Mo ta: " << description << std::endl;
                         }
                     }
                     std::cout << "---------------------------" << std::endl;
+                    if (page.nextCursor.empty()) {
+                        break;
+                    }
+                    std::string more = getStringInput("Nhap 'n' de xem trang tiep theo, Enter de quay lai: ", true);
+                    if (more != "n" && more != "N") {
+                        break;
+                    }
+                    query.cursor = page.nextCursor;
+                    ++pageNumber;
                 }
             } else {
                 std::cout << "Khong tim thay thong tin vi." << std::endl;
@@ -650,6 +701,9 @@ void displayAdminMenu(const User& admin) {
     std::cout << "15. Vo hieu hoa tai khoan nguoi dung" << std::endl;
     std::cout << "--- Quan Ly Vi ---" << std::endl;
     std::cout << "21. Nap diem vao vi nguoi dung" << std::endl;
+    std::cout << "22. Thong ke tong so diem trong he thong" << std::endl;
+    std::cout << "--- Du Lieu ---" << std::endl;
+    std::cout << "31. Xuat du lieu ra JSON (sao luu)" << std::endl;
     // Thêm các chức năng admin khác nếu cần
     std::cout << "9. Dang xuat" << std::endl;
     std::cout << "0. Thoat ung dung" << std::endl;
@@ -664,14 +718,15 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
         case 1: { // Xem thông tin cá nhân Admin
             clearScreen();
             std::cout << "--- Thong Tin Ca Nhan (Admin) ---" << std::endl;
+            const UserDetails details = userService.getUserDetails(admin.userId.str()).value_or(UserDetails());
             std::cout << "ID: " << admin.userId << std::endl;
             std::cout << "Ten dang nhap: " << admin.username << std::endl;
-            std::cout << "Ho ten: " << admin.fullName << std::endl;
-            std::cout << "Email: " << admin.email << std::endl;
-            std::cout << "So dien thoai: " << admin.phoneNumber << std::endl;
+            std::cout << "Ho ten: " << details.fullName << std::endl;
+            std::cout << "Email: " << details.email << std::endl;
+            std::cout << "So dien thoai: " << details.phoneNumber << std::endl;
             std::cout << "Vai tro: " << User::roleToString(admin.role) << std::endl;
             std::cout << "Trang thai: " << User::statusToString(admin.status) << std::endl;
-            std::cout << "OTP da thiet lap: " << (admin.otpSecretKey.empty() ? "Chua" : "Roi") << std::endl;
+            std::cout << "OTP da thiet lap: " << (admin.otpEnabled ? "Roi" : "Chua") << std::endl;
             pauseScreen();
             break;
         }
@@ -697,12 +752,13 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 break;
             }
             
-            if (newFullName.empty()) newFullName = admin.fullName;
-            if (newEmail.empty()) newEmail = admin.email;
-            if (newPhone.empty()) newPhone = admin.phoneNumber;
+            const UserDetails details = userService.getUserDetails(admin.userId.str()).value_or(UserDetails());
+            if (newFullName.empty()) newFullName = details.fullName;
+            if (newEmail.empty()) newEmail = details.email;
+            if (newPhone.empty()) newPhone = details.phoneNumber;
 
             otpCode = "";
-            if (!admin.otpSecretKey.empty()) {
+            if (admin.otpEnabled) {
                 otpCode = getStringInput("Nhap ma OTP (Go 'b' de quay lai menu): ");
                 if (otpCode == "b") {
                     std::cout << "Quay lai menu truoc..." << std::endl;
@@ -711,9 +767,9 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 }
             }
 
-            if (userService.updateUserProfile(admin.userId, newFullName, newEmail, newPhone, otpCode, msg)) {
+            if (userService.updateUserProfile(admin.userId.str(), newFullName, newEmail, newPhone, otpCode, msg)) {
                 std::cout << msg << std::endl;
-                auto updatedUserOpt = userService.getUserProfile(admin.userId);
+                auto updatedUserOpt = userService.getUserProfile(admin.userId.str());
                 if(updatedUserOpt) g_currentUser = updatedUserOpt.value();
             } else {
                 std::cout << "That bai: " << msg << std::endl;
@@ -738,7 +794,7 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
             }
             std::string otpCode = "";
             
-            if (!admin.otpSecretKey.empty()) {
+            if (admin.otpEnabled) {
                 otpCode = getStringInput("Nhap ma OTP (Go 'b' de quay lai menu): ");
                 if (otpCode == "b") {
                     std::cout << "Quay lai menu truoc..." << std::endl;
@@ -747,7 +803,7 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 }
             }
             
-            if (authService.changePassword(admin.userId, oldPass, newPass, otpCode, msg)) {
+            if (authService.changePassword(admin.userId.str(), oldPass, newPass, otpCode, msg)) {
                 std::cout << msg << std::endl;
             } else {
                 std::cout << "Loi: " << msg << std::endl;
@@ -758,7 +814,7 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
         case 4: { // Thiết lập OTP Admin
             clearScreen();
             std::cout << "--- Thiet Lap/Xem OTP (Admin) ---" << std::endl;
-            if (admin.otpSecretKey.empty()) {
+            if (!admin.otpEnabled) {
                 std::cout << "Ban chua thiet lap OTP. Ban co muon thiet lap khong? (y/n, Go 'b' de quay lai menu): ";
                 std::string choiceOtp = getStringInput("");
                 if (choiceOtp == "b") {
@@ -767,14 +823,14 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                     break;
                 }
                 if (choiceOtp == "y" || choiceOtp == "Y") {
-                    std::optional<std::string> secretKeyOpt = authService.setupOtpForUser(admin.userId, msg);
+                    std::optional<std::string> secretKeyOpt = authService.setupOtpForUser(admin.userId.str(), msg);
                     if (secretKeyOpt) {
                         std::cout << msg << std::endl;
                         std::cout << "Khoa bi mat cua ban (Base32): " << secretKeyOpt.value() << std::endl;
                         std::cout << "Hay them khoa nay vao ung dung Authenticator cua ban." << std::endl;
                         std::cout << "URI (cho QR code, sao chep va dan vao trinh tao QR): " << std::endl;
                         std::cout << otpService.generateOtpUri(admin.username, secretKeyOpt.value()) << std::endl;
-                        auto updatedUserOpt = userService.getUserProfile(admin.userId);
+                        auto updatedUserOpt = userService.getUserProfile(admin.userId.str());
                         if(updatedUserOpt) g_currentUser = updatedUserOpt.value();
                     } else {
                         std::cout << "That bai: " << msg << std::endl;
@@ -782,9 +838,10 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 }
             } else {
                 std::cout << "OTP da duoc thiet lap." << std::endl;
-                std::cout << "Khoa bi mat cua ban (Base32): " << admin.otpSecretKey << std::endl;
+                const UserDetails details = userService.getUserDetails(admin.userId.str()).value_or(UserDetails());
+                std::cout << "Khoa bi mat cua ban (Base32): " << details.otpSecretKey << std::endl;
                 std::cout << "URI (cho QR code, sao chep va dan vao trinh tao QR): " << std::endl;
-                std::cout << otpService.generateOtpUri(admin.username, admin.otpSecretKey) << std::endl;
+                std::cout << otpService.generateOtpUri(admin.username, details.otpSecretKey) << std::endl;
             }
             pauseScreen();
             break;
@@ -797,8 +854,11 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 std::cout << "Khong co nguoi dung nao trong he thong." << std::endl;
             } else {
                 for (const auto& u : allUsers) {
+                    // Details are looked up only for the rows printed
+                    const std::optional<UserDetails> details = userService.getUserDetails(u.userId.str());
                     std::cout << "ID: " << u.userId << ", Username: " << u.username
-                              << ", Ten: " << u.fullName << ", Email: " << u.email
+                              << ", Ten: " << (details ? details->fullName : "N/A")
+                              << ", Email: " << (details ? details->email : "N/A")
                               << ", Role: " << User::roleToString(u.role)
                               << ", Status: " << User::statusToString(u.status) << std::endl;
                 }
@@ -837,11 +897,11 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 std::cout << "Thanh cong: " << msg << std::endl;
                 std::cout << "Mat khau tam thoi cho " << username << " la: " << tempPass << std::endl;
                 // Tự động tạo ví
-                 User newUser; 
-                for(const auto& u : g_users){ if(u.username == username){ newUser = u; break;}}
-                if(!newUser.userId.empty()){
+                auto newUserOpt = authService.findUserByUsername(username);
+                if(newUserOpt){
+                    User newUser = *newUserOpt.value();
                     std::string walletMsg;
-                    if(walletService.createWalletForUser(newUser.userId, walletMsg)){ std::cout << walletMsg << std::endl; }
+                    if(walletService.createWalletForUser(newUser.userId.str(), walletMsg)){ std::cout << walletMsg << std::endl; }
                     else { LOG_ERROR("Tao vi that bai cho user " + newUser.username + ": " + walletMsg); std::cout << "Loi tao vi: " << walletMsg << std::endl; }
                 }
             } else {
@@ -866,7 +926,8 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 break;
             }
             User targetUser = targetUserOpt.value();
-            std::cout << "Cap nhat cho: " << targetUser.username << " (" << targetUser.fullName << ")" << std::endl;
+            const UserDetails targetDetails = userService.getUserDetails(targetUser.userId.str()).value_or(UserDetails());
+            std::cout << "Cap nhat cho: " << targetUser.username << " (" << targetDetails.fullName << ")" << std::endl;
             std::string newFullName = getStringInput("Ho ten moi (de trong de bo qua): ", true);
             std::string newEmail = getStringInput("Email moi (de trong de bo qua): ", true);
             std::string newPhone = getStringInput("So dien thoai moi (de trong de bo qua): ", true);
@@ -887,16 +948,16 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 }
             }
 
-            if (newFullName.empty()) newFullName = targetUser.fullName;
-            if (newEmail.empty()) newEmail = targetUser.email;
-            if (newPhone.empty()) newPhone = targetUser.phoneNumber;
+            if (newFullName.empty()) newFullName = targetDetails.fullName;
+            if (newEmail.empty()) newEmail = targetDetails.email;
+            if (newPhone.empty()) newPhone = targetDetails.phoneNumber;
 
             otpCode = "";
-            if (!targetUser.otpSecretKey.empty()) { // Nếu người dùng CÓ OTP
+            if (targetUser.otpEnabled) { // Nếu người dùng CÓ OTP
                 otpCode = getStringInput("Nhap ma OTP cua nguoi dung '" + targetUser.username + "' (do ho cung cap): ", true);
             }
 
-            if(adminService.adminUpdateUserProfile(admin.userId, targetUser.userId, newFullName, newEmail, newPhone, newStatus, otpCode, msg)){
+            if(adminService.adminUpdateUserProfile(admin.userId.str(), targetUser.userId.str(), newFullName, newEmail, newPhone, newStatus, otpCode, msg)){
                 std::cout << "Thanh cong: " << msg << std::endl;
             } else {
                 std::cout << "That bai: " << msg << std::endl;
@@ -934,7 +995,7 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 pauseScreen();
                 break;
             }
-            if(adminService.adminDeactivateUser(targetUserOpt.value().userId, msg)){
+            if(adminService.adminDeactivateUser(targetUserOpt.value().userId.str(), msg)){
                 std::cout << msg << std::endl;
             } else {
                 std::cout << "That bai: " << msg << std::endl;
@@ -957,8 +1018,8 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 pauseScreen();
                 break;
             }
-            double amount = getDoubleInput("Nhap so tien (Go 'b' de quay lai menu): ");
-            if (amount == 0) {
+            Money amount = getMoneyInput("Nhap so tien (Go 'b' de quay lai menu): ");
+            if (amount.isZero()) {
                 std::cout << "Quay lai menu truoc..." << std::endl;
                 pauseScreen();
                 break;
@@ -970,13 +1031,12 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
                 break;
             }
             std::string msg;
-            if (adminService.adminDepositToUserWallet(admin.userId, targetUserOpt.value().userId, amount, reason, msg)) {
+            if (adminService.adminDepositToUserWallet(admin.userId.str(), targetUserOpt.value().userId.str(), amount, reason, msg)) {
                 std::cout << "Nap tien thanh cong: " << msg << std::endl;
                 // Show updated balance
-                auto walletOpt = walletService.getWalletByUserId(targetUserOpt.value().userId);
+                auto walletOpt = walletService.getWalletByUserId(targetUserOpt.value().userId.str());
                 if (walletOpt) {
-                    std::cout << "So du moi cua nguoi dung: " << std::fixed << std::setprecision(2) 
-                              << walletOpt.value().balance << " diem" << std::endl;
+                    std::cout << "So du moi cua nguoi dung: " << walletOpt.value().balance.toString() << " diem" << std::endl;
                 }
             } else {
                 std::cout << "Nap tien that bai: " << msg << std::endl;
@@ -984,6 +1044,28 @@ void handleAdminActions(AdminService& adminService, UserService& userService, Au
             pauseScreen();
             break;
         }
+        case 22: { // Thống kê tổng số điểm
+            clearScreen();
+            std::cout << "--- Thong Ke Tong So Diem ---" << std::endl;
+            std::cout << "So vi: " << walletService.getUserWalletCount() << std::endl;
+            std::cout << "Tong so diem trong cac vi: " << walletService.getTotalBalance().toString() << " diem" << std::endl;
+            std::cout << "Tong so diem da phat tu vi tong: " << (-walletService.getMasterWalletBalance()).toString() << " diem" << std::endl;
+            pauseScreen();
+            break;
+        }
+        case 31: { // Xuất dữ liệu ra JSON
+            clearScreen();
+            std::cout << "--- Xuat Du Lieu Ra JSON ---" << std::endl;
+            const std::string exportDir = std::string(AppConfig::DATA_DIRECTORY) + AppConfig::BACKUP_SUBDIRECTORY +
+                "export-" + TimeUtils::formatTimestamp(TimeUtils::getCurrentTimestamp(), "%Y%m%d-%H%M%S") + "/";
+            if (walletService.exportToJson(exportDir, g_users, g_userDetails)) {
+                std::cout << "Da xuat du lieu vao thu muc: " << exportDir << std::endl;
+            } else {
+                std::cout << "Xuat du lieu that bai. Xem log de biet chi tiet." << std::endl;
+            }
+            pauseScreen();
+            break;
+        }
         case 9: // Đăng xuất
             LOG_INFO("Admin " + admin.username + " dang xuat.");
             g_currentUser.reset();
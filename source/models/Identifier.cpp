@@ -0,0 +1,83 @@
+// src/models/Identifier.cpp
+#include "../include/models/Identifier.hpp"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    // Interned IDs are never removed. Only IDs longer than Identifier::INLINE_CAPACITY end up
+    // here (one per user plus a few special wallets), so the table stays small.
+    struct InternTable {
+        std::mutex mutex;
+        std::deque<std::string> names;                          // Handle -> text; elements never move
+        std::unordered_map<std::string_view, uint32_t> handles; // Keys view into names
+    };
+
+    InternTable& internTable() {
+        static InternTable table;
+        return table;
+    }
+}
+
+Identifier::Identifier(std::string_view text) : words{0, 0} {
+    if (fitsInline(text)) {
+        setInline(text);
+        return;
+    }
+    InternTable& table = internTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.handles.find(text);
+    if (it == table.handles.end()) {
+        table.names.emplace_back(text);
+        it = table.handles.emplace(table.names.back(), static_cast<uint32_t>(table.names.size() - 1)).first;
+    }
+    setHandle(it->second);
+}
+
+Identifier Identifier::find(std::string_view text) {
+    Identifier id;
+    if (fitsInline(text)) {
+        id.setInline(text);
+        return id;
+    }
+    InternTable& table = internTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.handles.find(text);
+    if (it != table.handles.end()) {
+        id.setHandle(it->second);
+    }
+    return id;
+}
+
+std::string_view Identifier::view() const {
+    if (!isInterned()) {
+        return std::string_view(bytes(), strnlen(bytes(), INLINE_CAPACITY));
+    }
+    uint32_t handle = 0;
+    std::memcpy(&handle, bytes(), sizeof(handle));
+    InternTable& table = internTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return table.names[handle]; // The element outlives the lock; only the deque's map may change
+}
+
+bool Identifier::fitsInline(std::string_view text) {
+    if (text.size() > INLINE_CAPACITY) {
+        return false;
+    }
+    for (char c : text) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (byte == 0 || byte >= INTERNED_MARKER) {
+            return false; // Zero padding and the marker must stay unambiguous
+        }
+    }
+    return true;
+}
+
+void Identifier::setInline(std::string_view text) {
+    std::memcpy(words, text.data(), text.size());
+}
+
+void Identifier::setHandle(uint32_t handle) {
+    std::memcpy(words, &handle, sizeof(handle));
+    reinterpret_cast<char*>(words)[INLINE_CAPACITY - 1] = static_cast<char>(INTERNED_MARKER);
+}
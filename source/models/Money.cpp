@@ -0,0 +1,68 @@
+// src/models/Money.cpp
+#include "../include/models/Money.hpp"
+#include <cmath>
+#include <cctype>
+#include <limits>
+
+Money Money::fromDouble(double points) {
+    return Money(static_cast<int64_t>(std::llround(points * MINOR_UNITS_PER_POINT)));
+}
+
+bool Money::parse(const std::string& text, Money& outValue) {
+    size_t pos = 0;
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+    size_t end = text.size();
+    while (end > pos && std::isspace(static_cast<unsigned char>(text[end - 1]))) --end;
+
+    bool negative = false;
+    if (pos < end && (text[pos] == '+' || text[pos] == '-')) {
+        negative = text[pos] == '-';
+        ++pos;
+    }
+
+    const int64_t maxWhole = std::numeric_limits<int64_t>::max() / MINOR_UNITS_PER_POINT - 1;
+    int64_t whole = 0;
+    size_t wholeDigits = 0;
+    while (pos < end && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+        whole = whole * 10 + (text[pos] - '0');
+        if (whole > maxWhole) {
+            return false;
+        }
+        ++wholeDigits;
+        ++pos;
+    }
+
+    int64_t fraction = 0;
+    size_t fractionDigits = 0;
+    if (pos < end && text[pos] == '.') {
+        ++pos;
+        while (pos < end && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+            if (++fractionDigits > 2) {
+                return false; // Finer than one minor unit
+            }
+            fraction = fraction * 10 + (text[pos] - '0');
+            ++pos;
+        }
+        if (fractionDigits == 1) {
+            fraction *= 10;
+        }
+    }
+
+    if (pos != end || (wholeDigits == 0 && fractionDigits == 0)) {
+        return false;
+    }
+    const int64_t minorUnits = whole * MINOR_UNITS_PER_POINT + fraction;
+    outValue = Money(negative ? -minorUnits : minorUnits);
+    return true;
+}
+
+std::string Money::toString() const {
+    const uint64_t magnitude = minor < 0 ? 0 - static_cast<uint64_t>(minor) : static_cast<uint64_t>(minor);
+    const uint64_t fraction = magnitude % MINOR_UNITS_PER_POINT;
+    std::string result = minor < 0 ? "-" : "";
+    result += std::to_string(magnitude / MINOR_UNITS_PER_POINT);
+    result += '.';
+    result += static_cast<char>('0' + fraction / 10);
+    result += static_cast<char>('0' + fraction % 10);
+    return result;
+}
@@ -4,7 +4,8 @@
 
 // Default constructor
 Transaction::Transaction() :
-    amount(0.0), 
+    amount(), 
+    reason(TransactionReason::Note),
     timestamp(time(nullptr)), 
     status(TransactionStatus::Pending) {}
 
@@ -25,4 +26,87 @@ TransactionStatus Transaction::stringToStatus(const std::string& statusStr) {
     else if (statusStr == "Failed") return TransactionStatus::Failed;
     else if (statusStr == "Cancelled") return TransactionStatus::Cancelled;
     else throw std::runtime_error("Invalid TransactionStatus string value: " + statusStr);
-}
\ No newline at end of file
+}
+
+void Transaction::setReason(TransactionReason reason_val, std::initializer_list<std::string_view> args) {
+    reason = reason_val;
+    reasonArgs.clear();
+    bool first = true;
+    for (std::string_view arg : args) {
+        if (!first) {
+            reasonArgs.push_back(REASON_ARG_SEPARATOR);
+        }
+        reasonArgs.append(arg);
+        first = false;
+    }
+}
+
+std::string Transaction::description() const {
+    return renderDescription(reason, reasonArgs, sourceWalletId.view(), targetWalletId.view());
+}
+
+std::string Transaction::renderDescription(TransactionReason reason, std::string_view args,
+                                           std::string_view sourceWalletId, std::string_view targetWalletId) {
+    // Missing arguments render as empty text rather than failing
+    auto arg = [args](size_t n) {
+        size_t begin = 0;
+        for (; n > 0; --n) {
+            begin = args.find(REASON_ARG_SEPARATOR, begin);
+            if (begin == std::string_view::npos) {
+                return std::string_view();
+            }
+            ++begin;
+        }
+        return args.substr(begin, args.find(REASON_ARG_SEPARATOR, begin) - begin);
+    };
+
+    std::string text;
+    switch (reason) {
+        case TransactionReason::Transfer:
+            text.append("Chuyen tu ").append(arg(0)).append(" (vi: ").append(sourceWalletId)
+                .append(") den vi: ").append(targetWalletId);
+            break;
+        case TransactionReason::Deposit:
+            text.append(arg(0)).append(" (Initiated by: ").append(arg(1)).append(")");
+            break;
+        case TransactionReason::AdminDeposit:
+            text.append("Admin chuyen khoan (").append(arg(1)).append("): voi ly do:").append(arg(0))
+                .append(" (Initiated by: ").append(arg(1)).append(")");
+            break;
+        case TransactionReason::Note:
+        default:
+            text.append(args);
+            break;
+    }
+    return text;
+}
+
+TransactionView TransactionView::of(const Transaction& tx) {
+    TransactionView view;
+    view.transactionId = tx.transactionId.view();
+    view.sourceWalletId = tx.sourceWalletId.view();
+    view.targetWalletId = tx.targetWalletId.view();
+    view.reasonArgs = tx.reasonArgs;
+    view.amount = tx.amount;
+    view.timestamp = tx.timestamp;
+    view.status = tx.status;
+    view.reason = tx.reason;
+    return view;
+}
+
+Transaction TransactionView::toTransaction() const {
+    Transaction tx;
+    tx.transactionId = Identifier(transactionId);
+    tx.sourceWalletId = Identifier(sourceWalletId);
+    tx.targetWalletId = Identifier(targetWalletId);
+    tx.amount = amount;
+    tx.reason = reason;
+    tx.reasonArgs = std::string(reasonArgs);
+    tx.timestamp = timestamp;
+    tx.status = status;
+    return tx;
+}
+
+std::string TransactionView::description() const {
+    return Transaction::renderDescription(reason, reasonArgs, sourceWalletId, targetWalletId);
+}
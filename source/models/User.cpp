@@ -6,14 +6,10 @@
 User::User() :
     userId(""),
     username(""),
-    passwordHash(""),
-    fullName(""),
-    email(""),
-    phoneNumber(""),
     role(UserRole::RegularUser),
     status(AccountStatus::NotActivated),
-    otpSecretKey(""),
-    isTemporaryPassword(false) {}
+    isTemporaryPassword(false),
+    otpEnabled(false) {}
 
 // Static utility function implementations
 std::string User::roleToString(UserRole role) {
@@ -5,6 +5,7 @@
 Wallet::Wallet() :
     walletId(""),
     userId(""),
-    balance(0.0),
+    balance(),
     creationTimestamp(0),
-    lastUpdateTimestamp(0) {}
\ No newline at end of file
+    lastUpdateTimestamp(0),
+    held() {}
\ No newline at end of file
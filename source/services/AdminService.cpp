@@ -3,10 +3,12 @@
 #include "utils/Logger.hpp"
 #include "Config.h"
 #include "utils/InputValidator.hpp"
+#include "utils/DataIndex.hpp"
 
-AdminService::AdminService(std::vector<User>& u_ref, AuthService& as_ref,
-                           UserService& us_ref, WalletService& ws_ref)
-    : users(u_ref), authService(as_ref), userService(us_ref), walletService(ws_ref) {}
+AdminService::AdminService(std::vector<User>& u_ref, std::vector<UserDetails>& ud_ref, DataIndex& idx_ref,
+                           AuthService& as_ref, UserService& us_ref, WalletService& ws_ref)
+    : users(u_ref), userDetails(ud_ref), index(idx_ref), authService(as_ref), userService(us_ref),
+      walletService(ws_ref) {}
 
 std::vector<User> AdminService::listAllUsers() const {
     LOG_INFO("Admin len danh sach tat ca nguoi dung.");
@@ -32,13 +34,12 @@ bool AdminService::adminCreateUserAccount(const std::string& username, const std
         return false; // Account creation failed
     }
     
-    // Find the new user ID - efficient search with early exit
+    // Find the new user ID through the username index
     std::string newUserId;
-    auto it = std::find_if(users.begin(), users.end(), 
-                           [&username](const User& u) { return u.username == username; });
+    auto newUserOpt = authService.findUserByUsername(username);
     
-    if (it != users.end()) {
-        newUserId = it->userId;
+    if (newUserOpt) {
+        newUserId = newUserOpt.value()->userId.str();
         
         // Auto-create wallet for the new user
         std::string walletMsg;
@@ -65,21 +66,22 @@ bool AdminService::adminUpdateUserProfile(const std::string& adminUserId, const
     LOG_INFO("Admin '" + adminUserId + "' dang cap nhat thong tin nguoi dung co ID '" + targetUserId + "'.");
 
     // Find the user directly in the main vector instead of calling getUserProfile first
-    auto it_target = std::find_if(users.begin(), users.end(), 
-                                 [&targetUserId](const User& u) { return u.userId == targetUserId; });
+    auto targetOpt = authService.findUserById(targetUserId);
     
-    if (it_target == users.end()) {
+    if (!targetOpt) {
         outMessage = "Khong tim thay tai khoan can cap nhat.";
         return false;
     }
+    User* it_target = targetOpt.value();
+    UserDetails& targetDetails = *index.detailsOf(*it_target);
     
     // OTP Verification if target user has OTP enabled
-    if (!it_target->otpSecretKey.empty()) {
+    if (it_target->otpEnabled) {
         if (targetUserOtpCode.empty()) {
             outMessage = "Can nhap ma OTP cua nguoi dung de xac nhan thay doi.";
             return false;
         }
-        if (!authService.getOtpService().verifyOtp(it_target->otpSecretKey, targetUserOtpCode)) {
+        if (!authService.getOtpService().verifyOtp(targetDetails.otpSecretKey, targetUserOtpCode)) {
             outMessage = "Ma OTP cua nguoi dung khong hop le.";
             return false;
         }
@@ -89,22 +91,23 @@ bool AdminService::adminUpdateUserProfile(const std::string& adminUserId, const
     bool changed = false;
     
     // Update fields - only modified fields trigger saves
-    if (!newFullName.empty() && it_target->fullName != newFullName) {
-        it_target->fullName = newFullName;
+    if (!newFullName.empty() && targetDetails.fullName != newFullName) {
+        targetDetails.fullName = newFullName;
         changed = true;
     }
     
-    if (!newPhoneNumber.empty() && it_target->phoneNumber != newPhoneNumber) {
-        it_target->phoneNumber = newPhoneNumber;
+    if (!newPhoneNumber.empty() && targetDetails.phoneNumber != newPhoneNumber) {
+        targetDetails.phoneNumber = newPhoneNumber;
         changed = true;
     }
     
-    if (it_target->status != newStatus) {
+    const bool statusChanged = it_target->status != newStatus;
+    if (statusChanged) {
         it_target->status = newStatus;
         changed = true;
     }
 
-    if (!newEmail.empty() && it_target->email != newEmail) {
+    if (!newEmail.empty() && targetDetails.email != newEmail) {
         // Validate email format
         if (!InputValidator::isValidEmail(newEmail)) {
             outMessage = "Dinh dang email moi khong hop le.";
@@ -112,19 +115,18 @@ bool AdminService::adminUpdateUserProfile(const std::string& adminUserId, const
             return false;
         }
         
-        // Check if email is already in use by another account (efficient with early exit)
-        bool emailExists = std::any_of(users.begin(), users.end(), 
-            [&newEmail, &targetUserId](const User& u) {
-                return u.email == newEmail && u.userId != targetUserId;
-            });
+        // Check if email is already in use by another account
+        const User* emailOwner = index.findUserByEmail(newEmail);
             
-        if (emailExists) {
+        if (emailOwner && emailOwner->userId.view() != targetUserId) {
             outMessage = "Email moi da duoc su dung boi mot tai khoan khac.";
             LOG_WARNING("Admin cap nhat thong tin nguoi dung '" + it_target->username + "' that bai: " + outMessage);
             return false;
         }
         
-        it_target->email = newEmail;
+        const std::string oldEmail = targetDetails.email;
+        targetDetails.email = newEmail;
+        index.updateUserEmail(oldEmail, *it_target);
         changed = true;
     }
 
@@ -134,8 +136,10 @@ bool AdminService::adminUpdateUserProfile(const std::string& adminUserId, const
         return true; // Success but no changes
     }
 
-    // Only save if changes were made
-    if (authService.getFileHandler().saveUsers(users)) {
+    // Only save if changes were made. Name/email edits do not need to wait for the disk; a status
+    // change (locking or deactivating an account) must not be lost to a crash, so it waits.
+    const Durability durability = statusChanged ? Durability::Wait : Durability::Enqueue;
+    if (authService.getFileHandler().saveUsers(users, userDetails, durability)) {
         outMessage = "Admin da cap nhat thong tin nguoi dung " + it_target->username + " thanh cong.";
         LOG_INFO(outMessage);
         return true;
@@ -157,8 +161,8 @@ bool AdminService::adminDeactivateUser(const std::string& targetUserId, std::str
 }
 
 bool AdminService::adminDepositToUserWallet(const std::string& adminUserId, const std::string& targetUserId,
-                                            double amount, const std::string& reason, std::string& outMessage) {
-    LOG_INFO("Admin '" + adminUserId + "' dang chuyen khoan " + std::to_string(amount) + 
+                                            Money amount, const std::string& reason, std::string& outMessage) {
+    LOG_INFO("Admin '" + adminUserId + "' dang chuyen khoan " + amount.toString() + 
              " cho tai khoan cua nguoi dung '" + targetUserId + "' voi ly do: " + reason);
 
     // Get wallet directly instead of getting user profile first
@@ -166,10 +170,7 @@ bool AdminService::adminDepositToUserWallet(const std::string& adminUserId, cons
     
     if (!targetWalletOpt) {
         // Check if user exists to provide better error message
-        auto userExists = std::any_of(users.begin(), users.end(),
-                                     [&targetUserId](const User& u) { return u.userId == targetUserId; });
-        
-        if (!userExists) {
+        if (!index.findUserById(targetUserId)) {
             outMessage = "Tai khoan cua nguoi dung khong tim thay. Vui long kiem tra lai.";
         } else {
             outMessage = "Nguoi dung khong co vi. Vui long tao vi truoc.";
@@ -179,10 +180,39 @@ bool AdminService::adminDepositToUserWallet(const std::string& adminUserId, cons
         return false;
     }
 
-    std::string description = "Admin chuyen khoan (" + adminUserId + "): " + "voi ly do:" + reason;
-    
-    // Use std::move to avoid copying the description string
-    return walletService.depositPoints(targetWalletOpt.value().walletId, amount, 
-                                      std::move(description), adminUserId, 
-                                      outMessage, AppConfig::MASTER_WALLET_ID);
-}
\ No newline at end of file
+    return walletService.depositPoints(targetWalletOpt.value().walletId.str(), amount, 
+                                      reason, adminUserId, 
+                                      outMessage, AppConfig::MASTER_WALLET_ID, TransactionReason::AdminDeposit);
+}
+
+std::vector<PostingResult> AdminService::adminBatchDepositToUserWallets(const std::string& adminUserId,
+        const std::vector<std::pair<std::string, Money>>& targets, const std::string& reason) {
+    LOG_INFO("Admin '" + adminUserId + "' dang chuyen khoan cho " + std::to_string(targets.size()) +
+             " tai khoan voi ly do: " + reason);
+
+    std::vector<PostingResult> results(targets.size());
+    std::vector<WalletPosting> postings;
+    std::vector<size_t> postingTarget; // postings[k] belongs to targets[postingTarget[k]]
+    postings.reserve(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        auto targetWalletOpt = walletService.getWalletByUserId(targets[i].first);
+        if (!targetWalletOpt) {
+            results[i].message = "Nguoi dung " + targets[i].first + " khong co vi hoac khong ton tai.";
+            continue;
+        }
+        WalletPosting posting;
+        posting.targetWalletId = targetWalletOpt->walletId.str();
+        posting.amount = targets[i].second;
+        posting.sourceWalletId = AppConfig::MASTER_WALLET_ID;
+        posting.reason = TransactionReason::AdminDeposit;
+        posting.description = reason;
+        postings.push_back(std::move(posting));
+        postingTarget.push_back(i);
+    }
+
+    std::vector<PostingResult> posted = walletService.postBatch(postings, adminUserId);
+    for (size_t k = 0; k < posted.size(); ++k) {
+        results[postingTarget[k]] = std::move(posted[k]);
+    }
+    return results;
+}
@@ -1,6 +1,7 @@
 // src/services/AuthService.cpp
 #include "../include/services/AuthService.hpp"
 #include "../include/utils/FileHandler.hpp"
+#include "../include/utils/DataIndex.hpp"
 #include "../include/utils/HashUtils.hpp"
 #include "../include/utils/Logger.hpp"
 #include "../include/utils/TimeUtils.hpp"
@@ -8,14 +9,11 @@
 #include <algorithm>
 #include <ctime>
 
-AuthService::AuthService(std::vector<User>& users_ref, FileHandler& fh_ref, OTPService& otp_ref, HashUtils& hu_ref)
-    : users(users_ref), fileHandler(fh_ref), otpService(otp_ref), hashUtils(hu_ref) {
-    // Load users from file when service is initialized
-    if (!fileHandler.loadUsers(users)) {
-        LOG_ERROR("Failed to load users from file during AuthService initialization");
-    } else {
-        LOG_INFO("Loaded " + std::to_string(users.size()) + " users from file");
-    }
+AuthService::AuthService(std::vector<User>& users_ref, std::vector<UserDetails>& details_ref, DataIndex& idx_ref,
+                         FileHandler& fh_ref, OTPService& otp_ref, HashUtils& hu_ref)
+    : users(users_ref), userDetails(details_ref), index(idx_ref), fileHandler(fh_ref), otpService(otp_ref),
+      hashUtils(hu_ref) {
+    // Users are loaded once on startup (see StartupLoader), not per service
 }
 
 bool AuthService::registerUser(const std::string& username, const std::string& password,
@@ -43,25 +41,27 @@ bool AuthService::registerUser(const std::string& username, const std::string& p
     User newUser;
     newUser.userId = hashUtils.generateUUID();
     newUser.username = username;
-    
-    // Generate salt and hash password
-    const std::string salt = hashUtils.generateSalt(16);
-    newUser.passwordHash = salt + hashUtils.hashPassword(password, salt);
-    
-    newUser.fullName = fullName;
-    newUser.email = email;
-    newUser.phoneNumber = phoneNumber;
     newUser.role = role;
     newUser.status = AccountStatus::Active;
     newUser.isTemporaryPassword = false;
 
+    UserDetails newDetails;
+    // Generate salt and hash password
+    const std::string salt = hashUtils.generateSalt(16);
+    newDetails.passwordHash = salt + hashUtils.hashPassword(password, salt);
+    newDetails.fullName = fullName;
+    newDetails.email = email;
+    newDetails.phoneNumber = phoneNumber;
+
     LOG_INFO("Creating new user '" + username + "' with role: " + User::roleToString(role));
 
     // Add to users list
     users.push_back(std::move(newUser));
+    userDetails.push_back(std::move(newDetails));
     
-    if (!fileHandler.saveUsers(users)) {
+    if (!fileHandler.saveUsers(users, userDetails)) {
         users.pop_back(); // Remove the user if save failed
+        userDetails.pop_back();
         outMessage = "Failed to save user data. Please try again.";
         return false;
     }
@@ -72,10 +72,8 @@ bool AuthService::registerUser(const std::string& username, const std::string& p
 
 std::optional<User> AuthService::loginUser(const std::string& username, const std::string& password, std::string& outMessage) {
     // Find user by username
-    auto it = std::find_if(users.begin(), users.end(),
-                    [&username](const User& u) { return u.username == username; });
-    
-    if (it == users.end()) {
+    User* it = index.findUserByUsername(username);
+    if (!it) {
         outMessage = "Khong tim thay tai khoan.";
         return std::nullopt;
     }
@@ -87,14 +85,15 @@ std::optional<User> AuthService::loginUser(const std::string& username, const st
     }
 
     // Verify password
-    if (it->passwordHash.length() < 16) {
+    const UserDetails& details = *index.detailsOf(*it);
+    if (details.passwordHash.length() < 16) {
         LOG_ERROR("Corrupted password hash for user: " + username);
         outMessage = "Loi he thong. Vui long lien he quan tri vien.";
         return std::nullopt;
     }
 
-    const std::string salt = it->passwordHash.substr(0, 16);
-    const std::string storedHash = it->passwordHash.substr(16);
+    const std::string salt = details.passwordHash.substr(0, 16);
+    const std::string storedHash = details.passwordHash.substr(16);
     const std::string inputHash = hashUtils.hashPassword(password, salt);
 
     if (inputHash != storedHash) {
@@ -108,36 +107,35 @@ std::optional<User> AuthService::loginUser(const std::string& username, const st
 
 bool AuthService::changePassword(const std::string& currentUserId, const std::string& oldPassword,
                                const std::string& newPassword, const std::string& otpCode, std::string& outMessage) {
-    auto it = std::find_if(users.begin(), users.end(),
-                         [&currentUserId](const User& u) { return u.userId == currentUserId; });
-
-    if (it == users.end()) {
+    User* it = index.findUserById(currentUserId);
+    if (!it) {
         outMessage = "Khong tim thay tai khoan.";
         return false;
     }
+    UserDetails& details = *index.detailsOf(*it);
 
     // OTP Verification if user has OTP enabled
-    if (!it->otpSecretKey.empty()) {
+    if (it->otpEnabled) {
         if (otpCode.empty()) {
             outMessage = "Ban can nhap ma OTP de xac nhan thay doi mat khau.";
             return false;
         }
-        if (!otpService.verifyOtp(it->otpSecretKey, otpCode)) {
+        if (!otpService.verifyOtp(details.otpSecretKey, otpCode)) {
             outMessage = "Ma OTP khong hop le.";
             return false;
         }
     }
 
     // Validate password hash structure
-    if (it->passwordHash.length() < 16) {
+    if (details.passwordHash.length() < 16) {
         LOG_ERROR("Corrupted password hash for user ID: " + currentUserId);
         outMessage = "Loi he thong. Vui long lien he quan tri vien.";
         return false;
     }
 
     // Extract salt from the stored password hash
-    const std::string salt = it->passwordHash.substr(0, 16); // First 16 characters are the salt
-    const std::string storedHash = it->passwordHash.substr(16); // Rest is the actual hash
+    const std::string salt = details.passwordHash.substr(0, 16); // First 16 characters are the salt
+    const std::string storedHash = details.passwordHash.substr(16); // Rest is the actual hash
     
     // Hash the input password with the salt
     const std::string inputHash = hashUtils.hashPassword(oldPassword, salt);
@@ -154,11 +152,11 @@ bool AuthService::changePassword(const std::string& currentUserId, const std::st
 
     // Generate new salt and hash for the new password
     const std::string newSalt = hashUtils.generateSalt(16);
-    it->passwordHash = newSalt + hashUtils.hashPassword(newPassword, newSalt);
+    details.passwordHash = newSalt + hashUtils.hashPassword(newPassword, newSalt);
     it->isTemporaryPassword = false;
     
     // Save changes to file
-    if (!fileHandler.saveUsers(users)) {
+    if (!fileHandler.saveUsers(users, userDetails)) {
         outMessage = "Khong the luu mat khau moi. Vui long thu lai.";
         return false;
     }
@@ -190,24 +188,26 @@ std::string AuthService::createAccountWithTemporaryPassword(const std::string& u
     User newUser;
     newUser.userId = hashUtils.generateUUID();
     newUser.username = username;
-    
-    // Generate salt and hash password
-    const std::string salt = hashUtils.generateSalt(16);
-    newUser.passwordHash = salt + hashUtils.hashPassword(tempPassword, salt);
-    
-    newUser.fullName = fullName;
-    newUser.email = email;
-    newUser.phoneNumber = phoneNumber;
     newUser.role = role;
     newUser.status = AccountStatus::Active;
     newUser.isTemporaryPassword = true;
 
+    UserDetails newDetails;
+    // Generate salt and hash password
+    const std::string salt = hashUtils.generateSalt(16);
+    newDetails.passwordHash = salt + hashUtils.hashPassword(tempPassword, salt);
+    newDetails.fullName = fullName;
+    newDetails.email = email;
+    newDetails.phoneNumber = phoneNumber;
+
     // Add to users list
     users.push_back(std::move(newUser));
+    userDetails.push_back(std::move(newDetails));
     
     // Save changes to file
-    if (!fileHandler.saveUsers(users)) {
+    if (!fileHandler.saveUsers(users, userDetails)) {
         users.pop_back(); // Remove the user if save failed
+        userDetails.pop_back();
         outMessage = "Khong the tao tai khoan. Vui long thu lai.";
         return "";
     }
@@ -217,10 +217,8 @@ std::string AuthService::createAccountWithTemporaryPassword(const std::string& u
 }
 
 bool AuthService::forceTemporaryPasswordChange(User& userToUpdate, const std::string& newPassword, std::string& outMessage) {
-    auto it = std::find_if(users.begin(), users.end(),
-                         [&userToUpdate](const User& u) { return u.userId == userToUpdate.userId; });
-
-    if (it == users.end()) {
+    User* it = index.findUserById(userToUpdate.userId.view());
+    if (!it) {
         outMessage = "Khong tim thay tai khoan.";
         return false;
     }
@@ -237,42 +235,44 @@ bool AuthService::forceTemporaryPasswordChange(User& userToUpdate, const std::st
 
     // Generate new salt and hash for the new password
     const std::string newSalt = hashUtils.generateSalt(16);
-    it->passwordHash = newSalt + hashUtils.hashPassword(newPassword, newSalt);
+    index.detailsOf(*it)->passwordHash = newSalt + hashUtils.hashPassword(newPassword, newSalt);
     it->isTemporaryPassword = false;
     
     // Save changes to file
-    if (!fileHandler.saveUsers(users)) {
+    if (!fileHandler.saveUsers(users, userDetails)) {
         outMessage = "Khong the luu mat khau moi. Vui long thu lai.";
         return false;
     }
     
     // Update the reference to match in-memory state
-    userToUpdate.passwordHash = it->passwordHash;
     userToUpdate.isTemporaryPassword = false;
     
     outMessage = "Mat khau da duoc thay doi thanh cong.";
     return true;
 }
 
-bool AuthService::updateUser(const User& userToUpdate, std::string& outMessage) {
-    auto it = std::find_if(users.begin(), users.end(),
-                         [&userToUpdate](const User& u) { return u.userId == userToUpdate.userId; });
-
-    if (it == users.end()) {
+bool AuthService::updateUser(const User& userToUpdate, const UserDetails& detailsToUpdate, std::string& outMessage) {
+    User* it = index.findUserById(userToUpdate.userId.view());
+    if (!it) {
         outMessage = "Khong tim thay tai khoan.";
         return false;
     }
+    UserDetails& details = *index.detailsOf(*it);
 
     // Update user fields
-    it->fullName = userToUpdate.fullName;
-    it->email = userToUpdate.email;
-    it->phoneNumber = userToUpdate.phoneNumber;
+    const std::string oldEmail = details.email;
+    details.fullName = detailsToUpdate.fullName;
+    details.email = detailsToUpdate.email;
+    details.phoneNumber = detailsToUpdate.phoneNumber;
     it->role = userToUpdate.role;
     it->status = userToUpdate.status;
     it->isTemporaryPassword = userToUpdate.isTemporaryPassword;
+    if (oldEmail != details.email) {
+        index.updateUserEmail(oldEmail, *it);
+    }
     
     // Save changes to file
-    if (!fileHandler.saveUsers(users)) {
+    if (!fileHandler.saveUsers(users, userDetails)) {
         outMessage = "Khong the cap nhat thong tin nguoi dung. Vui long thu lai.";
         return false;
     }
@@ -282,42 +282,40 @@ bool AuthService::updateUser(const User& userToUpdate, std::string& outMessage)
 }
 
 std::optional<std::string> AuthService::setupOtpForUser(const std::string& userId, std::string& outMessage) {
-    auto it = std::find_if(users.begin(), users.end(), [&userId](const User& u) {
-        return u.userId == userId;
-    });
-
-    if (it == users.end()) {
+    User* it = index.findUserById(userId);
+    if (!it) {
         outMessage = "Khong tim thay tai khoan.";
         LOG_WARNING(outMessage + " User ID: " + userId);
         return std::nullopt;
     }
 
-    if (!it->otpSecretKey.empty()) {
+    if (it->otpEnabled) {
         outMessage = "OTP da duoc thiet lap cho tai khoan nay. De thay doi, vui long tat OTP (chua thuc hien).";
         LOG_INFO("OTP thiet lap thu cho tai khoan '" + it->username + "' nhung OTP da ton tai.");
         return std::nullopt; // Indicate no new setup was performed
     }
 
     const std::string newSecret = otpService.generateNewOtpSecretKey();
-    it->otpSecretKey = newSecret;
+    UserDetails& details = *index.detailsOf(*it);
+    details.otpSecretKey = newSecret;
+    it->otpEnabled = true;
 
-    if (fileHandler.saveUsers(users)) {
+    if (fileHandler.saveUsers(users, userDetails)) {
         outMessage = "OTP thiet lap thanh cong. Vui long luu lai OTP.";
         LOG_INFO("OTP thiet lap thanh cong cho tai khoan '" + it->username + "'.");
         return newSecret;
     } else {
         outMessage = "Loi khi luu OTP.";
         LOG_ERROR(outMessage + " Tai khoan: " + it->username);
-        it->otpSecretKey = ""; // Rollback in-memory change
+        details.otpSecretKey = ""; // Rollback in-memory change
+        it->otpEnabled = false;
         return std::nullopt;
     }
 }
 
 bool AuthService::activateAccount(const std::string& username, std::string& outMessage) {
-    auto it = std::find_if(users.begin(), users.end(),
-                         [&username](const User& u) { return u.username == username; });
-
-    if (it == users.end()) {
+    User* it = index.findUserByUsername(username);
+    if (!it) {
         outMessage = "That bai: Khong tim thay tai khoan.";
         return false;
     }
@@ -328,7 +326,7 @@ bool AuthService::activateAccount(const std::string& username, std::string& outM
     }
 
     it->status = AccountStatus::Active;
-    if (fileHandler.saveUsers(users)) {
+    if (fileHandler.saveUsers(users, userDetails)) {
         outMessage = "Thanh cong: Kich hoat tai khoan thanh cong.";
         return true;
     } else {
@@ -338,29 +336,24 @@ bool AuthService::activateAccount(const std::string& username, std::string& outM
 }
 
 bool AuthService::isUsernameExists(const std::string& username) const {
-    return std::find_if(users.cbegin(), users.cend(),
-        [&username](const User& u) { return u.username == username; }) != users.cend();
+    return index.findUserByUsername(username) != nullptr;
 }
 
 // Added helper methods for common operations
 std::optional<User*> AuthService::findUserById(const std::string& userId) {
-    auto it = std::find_if(users.begin(), users.end(),
-                         [&userId](const User& u) { return u.userId == userId; });
-    
-    if (it == users.end()) {
+    User* user = index.findUserById(userId);
+    if (!user) {
         return std::nullopt;
     }
     
-    return &(*it); // Return pointer to the user in the vector
+    return user; // Pointer to the user in the vector
 }
 
 std::optional<User*> AuthService::findUserByUsername(const std::string& username) {
-    auto it = std::find_if(users.begin(), users.end(),
-                         [&username](const User& u) { return u.username == username; });
-    
-    if (it == users.end()) {
+    User* user = index.findUserByUsername(username);
+    if (!user) {
         return std::nullopt;
     }
     
-    return &(*it); // Return pointer to the user in the vector
+    return user; // Pointer to the user in the vector
 }
\ No newline at end of file
@@ -1,26 +1,16 @@
 #include "services/UserService.hpp"
 #include "utils/FileHandler.hpp"
+#include "utils/DataIndex.hpp"
 #include "utils/Logger.hpp"
 #include "utils/InputValidator.hpp"
 #include <algorithm>
 #include <string>
 
-UserService::UserService(std::vector<User>& users_ref, FileHandler& fh_ref, OTPService& otp_ref)
-    : users(users_ref), fileHandler(fh_ref), otpService(otp_ref) {}
+UserService::UserService(std::vector<User>& users_ref, std::vector<UserDetails>& details_ref, DataIndex& idx_ref,
+                         FileHandler& fh_ref, OTPService& otp_ref)
+    : users(users_ref), userDetails(details_ref), index(idx_ref), fileHandler(fh_ref), otpService(otp_ref) {}
 
 namespace {
-    // Helper function to find user by ID
-    auto findUserById(std::vector<User>& users, const std::string& userId) {
-        return std::find_if(users.begin(), users.end(), 
-            [&userId](const User& u) { return u.userId == userId; });
-    }
-
-    // Helper function to find user by ID (const version)
-    auto findUserByIdConst(const std::vector<User>& users, const std::string& userId) {
-        return std::find_if(users.cbegin(), users.cend(), 
-            [&userId](const User& u) { return u.userId == userId; });
-    }
-
     // Helper function for sanitizing input strings
     std::string sanitizeInput(const std::string& input) {
         std::string sanitized = input;
@@ -37,9 +27,9 @@ std::optional<User> UserService::getUserProfile(const std::string& userId) const
         return std::nullopt;
     }
 
-    auto it = findUserByIdConst(users, userId);
-    if (it != users.cend()) {
-        return *it;
+    const User* user = static_cast<const DataIndex&>(index).findUserById(userId);
+    if (user) {
+        return *user;
     }
     LOG_WARNING("User profile not found for User ID: " + userId);
     return std::nullopt;
@@ -51,15 +41,24 @@ std::optional<User> UserService::getUserByUsername(const std::string& username)
         return std::nullopt;
     }
 
-    auto it = std::find_if(users.cbegin(), users.cend(), 
-        [&username](const User& u) { return u.username == username; });
-    if (it != users.cend()) {
-        return *it;
+    const User* user = static_cast<const DataIndex&>(index).findUserByUsername(username);
+    if (user) {
+        return *user;
     }
     LOG_WARNING("User profile not found for username: " + username);
     return std::nullopt;
 }
 
+std::optional<UserDetails> UserService::getUserDetails(const std::string& userId) const {
+    const DataIndex& lookup = index;
+    const User* user = lookup.findUserById(userId);
+    if (user) {
+        return *lookup.detailsOf(*user);
+    }
+    LOG_WARNING("User details not found for User ID: " + userId);
+    return std::nullopt;
+}
+
 bool UserService::updateUserProfile(const std::string& userId,
                                   const std::string& newFullName,
                                   const std::string& newEmail,
@@ -72,18 +71,19 @@ bool UserService::updateUserProfile(const std::string& userId,
         return false;
     }
 
-    auto it = findUserById(users, userId);
-    if (it == users.end()) {
+    User* it = index.findUserById(userId);
+    if (!it) {
         outMessage = "User account not found.";
         LOG_WARNING("Profile update failed for non-existent user ID: " + userId);
         return false;
     }
 
+    UserDetails& details = *index.detailsOf(*it);
     // Store original user data for potential rollback
-    User originalUser = *it;
+    const UserDetails originalDetails = details;
 
     // OTP Verification
-    if (!it->otpSecretKey.empty() && !otpService.verifyOtp(it->otpSecretKey, otpCode)) {
+    if (it->otpEnabled && !otpService.verifyOtp(details.otpSecretKey, otpCode)) {
         outMessage = "Invalid OTP code.";
         LOG_WARNING("Profile update failed for user '" + it->username + "': Invalid OTP");
         return false;
@@ -91,28 +91,26 @@ bool UserService::updateUserProfile(const std::string& userId,
 
     // Validate and update email
     const std::string sanitizedEmail = sanitizeInput(newEmail);
-    if (!sanitizedEmail.empty() && it->email != sanitizedEmail) {
+    if (!sanitizedEmail.empty() && details.email != sanitizedEmail) {
         if (!InputValidator::isValidEmail(sanitizedEmail)) {
             outMessage = "Invalid email format.";
             LOG_WARNING("Profile update failed for user '" + it->username + "': " + outMessage);
             return false;
         }
-        auto email_exists = std::find_if(users.cbegin(), users.cend(),
-            [&sanitizedEmail, &userId](const User& u) {
-                return u.email == sanitizedEmail && u.userId != userId;
-            });
-        if (email_exists != users.cend()) {
+        const User* emailOwner = index.findUserByEmail(sanitizedEmail);
+        if (emailOwner && emailOwner->userId.view() != userId) {
             outMessage = "Email address already in use.";
             LOG_WARNING("Profile update failed for user '" + it->username + "': " + outMessage);
             return false;
         }
-        it->email = sanitizedEmail;
+        details.email = sanitizedEmail;
+        index.updateUserEmail(originalDetails.email, *it);
     }
 
     // Update full name
     const std::string sanitizedFullName = sanitizeInput(newFullName);
     if (!sanitizedFullName.empty()) {
-        it->fullName = sanitizedFullName;
+        details.fullName = sanitizedFullName;
     }
 
     // Validate and update phone number
@@ -123,17 +121,22 @@ bool UserService::updateUserProfile(const std::string& userId,
             LOG_WARNING("Profile update failed for user '" + it->username + "': " + outMessage);
             return false;
         }
-        it->phoneNumber = sanitizedPhoneNumber;
+        details.phoneNumber = sanitizedPhoneNumber;
     }
 
-    if (fileHandler.saveUsers(users)) {
+    // Profile edits are not critical; the write happens in the background
+    if (fileHandler.saveUsers(users, userDetails, Durability::Enqueue)) {
         outMessage = "User profile updated successfully.";
         LOG_INFO("Profile updated for user '" + it->username + "'.");
         return true;
     }
 
     // Rollback changes
-    *it = originalUser;
+    const std::string attemptedEmail = details.email;
+    details = originalDetails;
+    if (attemptedEmail != originalDetails.email) {
+        index.updateUserEmail(attemptedEmail, *it);
+    }
     outMessage = "Failed to save updated user profile.";
     LOG_ERROR(outMessage + " User: " + it->username);
     return false;
@@ -146,8 +149,8 @@ bool UserService::activateUserAccount(const std::string& userId, std::string& ou
         return false;
     }
 
-    auto it = findUserById(users, userId);
-    if (it == users.end()) {
+    User* it = index.findUserById(userId);
+    if (!it) {
         outMessage = "User not found for activation.";
         LOG_WARNING(outMessage + " User ID: " + userId);
         return false;
@@ -160,7 +163,7 @@ bool UserService::activateUserAccount(const std::string& userId, std::string& ou
     }
 
     it->status = AccountStatus::Active;
-    if (fileHandler.saveUsers(users)) {
+    if (fileHandler.saveUsers(users, userDetails)) {
         outMessage = "Account activated successfully.";
         LOG_INFO("Account activated for user '" + it->username + "'.");
         return true;
@@ -179,8 +182,8 @@ bool UserService::deactivateUserAccount(const std::string& userId, std::string&
         return false;
     }
 
-    auto it = findUserById(users, userId);
-    if (it == users.end()) {
+    User* it = index.findUserById(userId);
+    if (!it) {
         outMessage = "User not found for deactivation.";
         LOG_WARNING(outMessage + " User ID: " + userId);
         return false;
@@ -194,7 +197,7 @@ bool UserService::deactivateUserAccount(const std::string& userId, std::string&
 
     auto previousStatus = it->status; // Store previous status for rollback
     it->status = AccountStatus::Inactive;
-    if (fileHandler.saveUsers(users)) {
+    if (fileHandler.saveUsers(users, userDetails)) {
         outMessage = "Account deactivated successfully.";
         LOG_INFO("Account deactivated for user '" + it->username + "'.");
         return true;
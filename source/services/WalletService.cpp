@@ -1,31 +1,138 @@
 // src/services/WalletService.cpp
 #include "services/WalletService.hpp"
 #include "utils/FileHandler.hpp"
+#include "utils/DataIndex.hpp"
+#include "utils/TransactionArchive.hpp"
 #include "utils/HashUtils.hpp"
 #include "utils/Logger.hpp"
 #include "utils/TimeUtils.hpp"    
 #include "Config.h"                
 #include <algorithm>
+#include <chrono>
 #include <ctime>
+#include <functional>
 #include <iomanip>                 
+#include <limits>
 #include <sstream>              
+#include <unordered_map>
 
 WalletService::WalletService(std::vector<User>& u_ref, std::vector<Wallet>& w_ref, 
-                             std::vector<Transaction>& t_ref, FileHandler& fh_ref, 
-                             OTPService& otp_ref, HashUtils& hu_ref)
-    : users(u_ref), wallets(w_ref), transactions(t_ref), 
-      fileHandler(fh_ref), otpService(otp_ref), hashUtils(hu_ref) {}
+                             std::vector<Transaction>& t_ref, DataIndex& idx_ref, TransactionArchive& archive_ref,
+                             FileHandler& fh_ref, OTPService& otp_ref, HashUtils& hu_ref)
+    : users(u_ref), wallets(w_ref), transactions(t_ref), index(idx_ref), archive(archive_ref),
+      fileHandler(fh_ref), otpService(otp_ref), hashUtils(hu_ref), masterWalletId(AppConfig::MASTER_WALLET_ID),
+      idempotencyCache(AppConfig::IDEMPOTENCY_CACHE_CAPACITY, std::chrono::seconds(AppConfig::IDEMPOTENCY_KEY_TTL_SECONDS)),
+      holdTimers(AppConfig::HOLD_TIMER_SLOTS, AppConfig::HOLD_TIMER_GRANULARITY_SECONDS, TimeUtils::getCurrentTimestamp()) {}
+
+WalletService::~WalletService() {
+    {
+        std::lock_guard<std::mutex> lock(holdExpiryMutex);
+        holdExpiryStopping = true;
+    }
+    holdExpiryWake.notify_one();
+    if (holdExpiryThread.joinable()) {
+        holdExpiryThread.join();
+    }
+}
+
+std::optional<IdempotencyCache::Outcome> WalletService::findEarlierOutcome(const std::string& scopedKey,
+                                                                           const std::string& transactionId,
+                                                                           const std::string& fingerprint,
+                                                                           const std::string& postedWalletId,
+                                                                           IdempotencyCache::Reservation& outReservation) {
+    // Claimed before any lock is taken: the claim may wait for a request that needs those locks
+    std::optional<IdempotencyCache::Outcome> earlier = idempotencyCache.claim(scopedKey, outReservation);
+    if (!earlier) {
+        // Dropped from the cache (or never in it): look for the transaction it recorded
+        std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        std::optional<TransactionView> recorded;
+        {
+            std::lock_guard<std::mutex> indexLock(indexMutex);
+            if (const Transaction* tx = static_cast<const DataIndex&>(index).findTransactionById(transactionId)) {
+                recorded = TransactionView::of(*tx);
+            }
+        }
+        // Archived transactions are found through the wallet's postings, newest segment first.
+        // Segments retired after AppConfig::ARCHIVE_RETENTION_DAYS are not searched.
+        if (!recorded && AppConfig::USE_TRANSACTION_ARCHIVE) {
+            std::lock_guard<std::mutex> archiveLock(archiveMutex);
+            archive.releaseCold();
+            for (size_t s = archive.segments().size(); s-- > 0 && !recorded;) {
+                const ArchiveSegment* segment = archive.acquire(s);
+                if (!segment) {
+                    LOG_ERROR("Idempotency key cannot be checked, archive segment unreadable: " +
+                              archive.segments()[s].path());
+                    IdempotencyCache::Outcome unresolved; // The reservation is released, a later retry may succeed
+                    unresolved.message = "Khong the kiem tra khoa idempotency luc nay. Vui long thu lai sau.";
+                    return unresolved;
+                }
+                const ArchiveSegment::Postings postings = segment->postingsForWallet(postedWalletId);
+                for (size_t i = postings.size(); i-- > 0;) {
+                    const TransactionView view = segment->record(postings[i]);
+                    if (view.transactionId == transactionId) {
+                        recorded = view;
+                        break;
+                    }
+                }
+            }
+        }
+        if (!recorded) {
+            return std::nullopt;
+        }
+        IdempotencyCache::Outcome outcome;
+        outcome.success = recorded->status == TransactionStatus::Completed;
+        outcome.message = outcome.success ? "Giao dich da duoc thuc hien truoc do."
+                                          : "Giao dich truoc do khong thanh cong.";
+        outcome.transactionId = transactionId;
+        outcome.fingerprint = std::string(recorded->targetWalletId) + ":" + std::to_string(recorded->amount.minorUnits());
+        outReservation.complete(outcome);
+        earlier = std::move(outcome);
+    }
+    if (earlier->fingerprint != fingerprint) {
+        IdempotencyCache::Outcome conflict;
+        conflict.message = "Khoa idempotency da duoc dung cho mot giao dich khac.";
+        conflict.transactionId = earlier->transactionId;
+        return conflict;
+    }
+    return earlier;
+}
+
+size_t WalletService::stripeIndexFor(const Identifier& walletId) const {
+    return std::hash<Identifier>{}(walletId) % walletStripes.size();
+}
+
+std::mutex& WalletService::stripeFor(const Identifier& walletId) const {
+    return walletStripes[stripeIndexFor(walletId)];
+}
+
+std::pair<std::unique_lock<std::mutex>, std::unique_lock<std::mutex>>
+WalletService::lockWalletPair(const Identifier& first, const Identifier& second) const {
+    std::mutex* lower = &stripeFor(first);
+    std::mutex* upper = &stripeFor(second);
+    if (lower == upper) {
+        return {std::unique_lock<std::mutex>(*lower), std::unique_lock<std::mutex>()};
+    }
+    // Stripes live in one array, so address order is stripe order: two transfers between
+    // the same wallets in opposite directions cannot each hold the lock the other needs
+    if (upper < lower) {
+        std::swap(lower, upper);
+    }
+    std::unique_lock<std::mutex> lowerLock(*lower);
+    std::unique_lock<std::mutex> upperLock(*upper);
+    return {std::move(lowerLock), std::move(upperLock)};
+}
 
 bool WalletService::createWalletForUser(const std::string& userId, std::string& outMessage) {
-    auto user_it = std::find_if(users.cbegin(), users.cend(), [&](const User& u){ return u.userId == userId; });
-    if (user_it == users.cend()){
+    // push_back may reallocate the vector other threads hold wallet pointers into
+    std::unique_lock<std::shared_mutex> structureLock(structureMutex);
+    const User* user_it = index.findUserById(userId);
+    if (!user_it){
         outMessage = "Nguoi dung khong tim thay, khong the tao vi.";
         return false;
     }
 
-    auto wallet_exists = std::find_if(wallets.cbegin(), wallets.cend(), 
-                                      [&](const Wallet& w) { return w.userId == userId; });
-    if (wallet_exists != wallets.cend()) {
+    if (index.findWalletByUserId(userId)) {
         outMessage = "Vi da ton tai cho nguoi dung " + user_it->username + ".";
         return true; // Not an error, wallet exists.
     }
@@ -37,9 +144,11 @@ bool WalletService::createWalletForUser(const std::string& userId, std::string&
     newWallet.creationTimestamp = TimeUtils::getCurrentTimestamp();
     newWallet.lastUpdateTimestamp = newWallet.creationTimestamp;
 
+    // push_back may reallocate; keep the username for the messages below
+    const std::string username = user_it->username;
     wallets.push_back(newWallet);
-    if (fileHandler.saveWallets(wallets)) {
-        outMessage = "Da tao thanh cong vi moi cho nguoi dung " + user_it->username + ". ID vi: " + newWallet.walletId;
+    if (fileHandler.commitWalletData(wallets, transactions)) {
+        outMessage = "Da tao thanh cong vi moi cho nguoi dung " + username + ". ID vi: " + newWallet.walletId;
         return true;
     } else {
         outMessage = "Loi khi luu du lieu vi moi.";
@@ -49,46 +158,128 @@ bool WalletService::createWalletForUser(const std::string& userId, std::string&
 }
 
 std::optional<Wallet> WalletService::getWalletByUserId(const std::string& userId) const {
-    auto it = std::find_if(wallets.cbegin(), wallets.cend(), 
-                           [&](const Wallet& w) { return w.userId == userId; });
-    if (it != wallets.cend()) {
-        return *it;
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    const Wallet* wallet = nullptr;
+    {
+        std::lock_guard<std::mutex> indexLock(indexMutex);
+        wallet = static_cast<const DataIndex&>(index).findWalletByUserId(userId);
+    }
+    if (wallet) {
+        std::lock_guard<std::mutex> walletLock(stripeFor(wallet->walletId)); // Not mid-transfer
+        return *wallet;
     }
     return std::nullopt;
 }
 
 std::optional<Wallet> WalletService::getWalletByWalletId(const std::string& walletId) const {
-     auto it = std::find_if(wallets.cbegin(), wallets.cend(), 
-                            [&](const Wallet& w) { return w.walletId == walletId; });
-    if (it != wallets.cend()) {
-        return *it;
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    const Wallet* wallet = nullptr;
+    {
+        std::lock_guard<std::mutex> indexLock(indexMutex);
+        wallet = static_cast<const DataIndex&>(index).findWalletById(walletId);
+    }
+    if (wallet) {
+        std::lock_guard<std::mutex> walletLock(stripeFor(wallet->walletId));
+        return *wallet;
     }
     return std::nullopt;
 }
 
 std::optional<Wallet> WalletService::getWalletByUsername(const std::string& username) const {
-    // First find the user by username
-    auto user_it = std::find_if(users.cbegin(), users.cend(),
-                               [&](const User& u) { return u.username == username; });
-    if (user_it == users.cend()) {
-        return std::nullopt;
-    }
-    
-    // Then find the wallet for that user
-    auto wallet_it = std::find_if(wallets.cbegin(), wallets.cend(),
-                                 [&](const Wallet& w) { return w.userId == user_it->userId; });
-    if (wallet_it != wallets.cend()) {
-        return *wallet_it;
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    const Wallet* wallet = nullptr;
+    {
+        std::lock_guard<std::mutex> indexLock(indexMutex);
+        const DataIndex& lookup = index;
+        // First find the user by username
+        const User* user = lookup.findUserByUsername(username);
+        if (!user) {
+            return std::nullopt;
+        }
+
+        // Then find the wallet for that user
+        wallet = lookup.findWalletByUserId(user->userId.view());
+    }
+    if (wallet) {
+        std::lock_guard<std::mutex> walletLock(stripeFor(wallet->walletId));
+        return *wallet;
     }
     return std::nullopt;
 }
 
+bool WalletService::authorizeTransfer(const std::string& senderUserId, const std::string& senderWalletId,
+                                      const std::string& receiverWalletId, const std::string& otpCode,
+                                      Wallet*& outSenderWallet, Wallet*& outReceiverWallet,
+                                      std::string& outSenderUsername, std::string& outMessage) {
+    // Everything needed from the user and wallet records is looked up in one short section;
+    // the OTP check below runs without the index lock
+    bool senderOtpEnabled = false;
+    std::string senderOtpSecret;
+    {
+        std::lock_guard<std::mutex> indexLock(indexMutex);
+        const User* senderUserIt = index.findUserById(senderUserId);
+        if (!senderUserIt) {
+            outMessage = "Nguoi gui khong tim thay."; // This should ideally not happen if senderUserId is from a logged-in session
+            LOG_ERROR("Chuyen tien that bai: " + outMessage + " ID nguoi gui: " + senderUserId);
+            return false;
+        }
+        outSenderUsername = senderUserIt->username;
+        senderOtpEnabled = senderUserIt->otpEnabled;
+        if (senderOtpEnabled) {
+            senderOtpSecret = index.detailsOf(*senderUserIt)->otpSecretKey;
+        }
+
+        // Pointers into the g_wallets vector so balances are modified in place
+        outSenderWallet = index.findWalletById(senderWalletId);
+        outReceiverWallet = index.findWalletById(receiverWalletId);
+
+        if (!outSenderWallet) {
+            outMessage = "Vi cua nguoi gui (ID: " + senderWalletId + ") khong tim thay.";
+            LOG_WARNING("Chuyen tien that bai: " + outMessage);
+            return false;
+        }
+        if (outSenderWallet->userId != senderUserIt->userId) {
+            outMessage = "Vi cua nguoi gui khong phai cua ban.";
+            LOG_ERROR("Chuyen tien that bai: User '" + outSenderUsername + "' (ID: " + senderUserId +
+                      ") dang su dung vi '" + senderWalletId + "' khong phai cua ban.");
+            return false;
+        }
+        if (!outReceiverWallet) {
+            outMessage = "Vi nguoi nhan (ID: " + receiverWalletId + ") khong tim thay.";
+            LOG_WARNING("Chuyen tien that bai: " + outMessage);
+            return false;
+        }
+        // The shards only hold the master wallet's issued points; users cannot pay into them
+        if (isMasterShard(*outReceiverWallet)) {
+            outMessage = "Khong the chuyen diem den vi tong.";
+            LOG_WARNING("Chuyen tien that bai: User '" + outSenderUsername + "' chuyen den vi tong " + receiverWalletId);
+            return false;
+        }
+    }
+
+    // OTP Verification if sender has OTP enabled
+    if (senderOtpEnabled) {
+        if (otpCode.empty()) {
+            outMessage = "Ma OTP la bat buoc cho chuyen tien.";
+            LOG_WARNING("Chuyen tien that bai: nguoi dung '" + outSenderUsername + "': Thieu ma OTP.");
+            return false;
+        }
+        if (!otpService.verifyOtp(senderOtpSecret, otpCode)) {
+            outMessage = "Ma OTP khong hop le.";
+            LOG_WARNING("Chuyen tien that bai: User '" + outSenderUsername + "': Ma OTP khong hop le.");
+            return false;
+        }
+    }
+    return true;
+}
+
 bool WalletService::transferPoints(const std::string& senderUserId, const std::string& senderWalletId,
-                                   const std::string& receiverWalletId, double amount,
-                                   const std::string& otpCode, std::string& outMessage) {
-    if (amount <= 0) {
+                                   const std::string& receiverWalletId, Money amount,
+                                   const std::string& otpCode, std::string& outMessage,
+                                   const std::string& idempotencyKey) {
+    if (!amount.isPositive()) {
         outMessage = "So tien chuyen phai la so duong.";
-        LOG_WARNING("Chuyen tien that bai: " + outMessage + " So tien: " + std::to_string(amount));
+        LOG_WARNING("Chuyen tien that bai: " + outMessage + " So tien: " + amount.toString());
         return false;
     }
     if (senderWalletId == receiverWalletId) {
@@ -96,147 +287,815 @@ bool WalletService::transferPoints(const std::string& senderUserId, const std::s
         LOG_WARNING("Chuyen tien that bai: ID vi cua nguoi gui va nguoi nhan giong nhau: " + senderWalletId);
         return false;
     }
+    releaseExpiredHolds(); // Expired holds no longer count against the available balance
+
+    // A retry gets the first outcome; the key is released again if this call records nothing
+    // or its commit fails
+    IdempotencyCache::Reservation reservation;
+    std::string transactionId;
+    std::string fingerprint;
+    if (!idempotencyKey.empty()) {
+        const std::string scopedKey = "transfer:" + senderUserId + ":" + idempotencyKey;
+        transactionId = IdempotencyCache::transactionIdFor("TXN-", scopedKey);
+        fingerprint = receiverWalletId + ":" + std::to_string(amount.minorUnits());
+        // Every transfer of this user is posted to the sender wallet, whatever its target
+        if (auto earlier = findEarlierOutcome(scopedKey, transactionId, fingerprint, senderWalletId, reservation)) {
+            outMessage = earlier->message;
+            LOG_INFO("Chuyen tien lap lai voi khoa idempotency '" + idempotencyKey + "', TxID: " + earlier->transactionId);
+            return earlier->success;
+        }
+    }
 
-    auto senderUserIt = std::find_if(users.cbegin(), users.cend(), 
-                                     [&](const User& u) { return u.userId == senderUserId; });
-    if (senderUserIt == users.cend()) {
-        outMessage = "Nguoi gui khong tim thay."; // This should ideally not happen if senderUserId is from a logged-in session
-        LOG_ERROR("Chuyen tien that bai: " + outMessage + " ID nguoi gui: " + senderUserId);
+    // Held until the transfer is committed, so the wallet pointers below stay valid
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+
+    std::string senderUsername;
+    Wallet* pSenderWallet = nullptr;
+    Wallet* pReceiverWallet = nullptr;
+    if (!authorizeTransfer(senderUserId, senderWalletId, receiverWalletId, otpCode,
+                           pSenderWallet, pReceiverWallet, senderUsername, outMessage)) {
         return false;
     }
 
-    // OTP Verification if sender has OTP enabled
-    if (!senderUserIt->otpSecretKey.empty()) {
-        if (otpCode.empty()) {
-            outMessage = "Ma OTP la bat buoc cho chuyen tien.";
-            LOG_WARNING("Chuyen tien that bai: nguoi dung '" + senderUserIt->username + "': Thieu ma OTP.");
-            return false;
+    Transaction tx;
+    tx.transactionId = transactionId.empty() ? "TXN-" + hashUtils.generateUUID().substr(0,12) : transactionId;
+    tx.sourceWalletId = pSenderWallet->walletId;
+    tx.targetWalletId = pReceiverWallet->walletId;
+    tx.amount = amount;
+    tx.setReason(TransactionReason::Transfer, {senderUsername});
+
+    // Transfers touching other wallets proceed in parallel; the two stripes are held until the
+    // commit is on disk, so nobody builds on a balance that might still be rolled back
+    auto walletLocks = lockWalletPair(pSenderWallet->walletId, pReceiverWallet->walletId);
+
+    // Points on hold for pending transfers cannot be spent
+    if (pSenderWallet->available() < amount) {
+        outMessage = "So du khong du. Hien co: " + pSenderWallet->available().toString() + ", can chuyen: " + amount.toString();
+        tx.status = TransactionStatus::Failed;
+        uint64_t ticket = 0;
+        {
+            std::lock_guard<std::mutex> logLock(transactionLogMutex);
+            // Stamped when appended, so the transaction log stays in timestamp order
+            tx.timestamp = TimeUtils::getCurrentTimestamp();
+            transactions.push_back(tx);
+            ticket = queueChanges();
         }
-        if (!otpService.verifyOtp(senderUserIt->otpSecretKey, otpCode)) {
-            outMessage = "Ma OTP khong hop le.";
-            LOG_WARNING("Chuyen tien that bai: User '" + senderUserIt->username + "': Ma OTP khong hop le.");
-            return false;
+        walletLocks = {};
+        if (!fileHandler.awaitWalletData(ticket)) {
+             LOG_ERROR("Failed to save transaction log for failed (insufficient funds) TxID: " + tx.transactionId);
         }
+        reservation.complete({false, outMessage, tx.transactionId.str(), fingerprint});
+        LOG_WARNING("Chuyen tien that bai cho user '" + senderUsername + "': " + outMessage);
+        structureLock.unlock();
+        archiveIfNeeded();
+        return false;
     }
 
-    Wallet* pSenderWallet = nullptr;
-    Wallet* pReceiverWallet = nullptr;
-    // Find wallets by reference to modify them directly in the g_wallets vector
-    for (Wallet& w : wallets) { // Use non-const reference
-        if (w.walletId == senderWalletId) pSenderWallet = &w;
-        if (w.walletId == receiverWalletId) pReceiverWallet = &w;
+    // Perform transfer (in-memory first)
+    Money originalSenderBalance = pSenderWallet->balance; // For potential rollback
+    Money originalReceiverBalance = pReceiverWallet->balance; // For potential rollback
+    size_t txPosition = 0; // Stable while structureLock is held: nothing is removed from the front
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        pSenderWallet->balance -= amount;
+        pReceiverWallet->balance += amount;
+        time_t updateTime = TimeUtils::getCurrentTimestamp(); // Use a single timestamp for consistency
+        pSenderWallet->lastUpdateTimestamp = updateTime;
+        pReceiverWallet->lastUpdateTimestamp = updateTime;
+        markDirty(*pSenderWallet);
+        markDirty(*pReceiverWallet);
+        tx.status = TransactionStatus::Completed;
+        tx.timestamp = updateTime;
+        txPosition = transactions.size();
+        transactions.push_back(tx);
+        ticket = queueChanges();
+    }
+
+    // Debit, credit and the transaction record are one write-ahead log record:
+    // after a crash either all three are recovered or none of them.
+    // Concurrent transfers wait here together and share one log append and fsync.
+    if (fileHandler.awaitWalletData(ticket)) {
+        walletLocks = {};
+        structureLock.unlock();
+        outMessage = "Points transferred successfully!";
+        reservation.complete({true, outMessage, tx.transactionId.str(), fingerprint});
+        LOG_INFO(outMessage + " TxID: " + tx.transactionId + ", Amount: " + amount.toString() +
+                 " from " + senderWalletId + " to " + receiverWalletId);
+        archiveIfNeeded();
+        return true;
     }
 
-    if (!pSenderWallet) {
-        outMessage = "Vi cua nguoi gui (ID: " + senderWalletId + ") khong tim thay.";
-        LOG_WARNING("Chuyen tien that bai: " + outMessage);
+    // Nothing of the transfer reached the disk; undo it in memory and record the failure
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        pSenderWallet->balance = originalSenderBalance;
+        pReceiverWallet->balance = originalReceiverBalance;
+        markDirty(*pSenderWallet);
+        markDirty(*pReceiverWallet);
+        // pSenderWallet->lastUpdateTimestamp = originalSenderLastUpdate; // Need to store this too for perfect rollback?
+        // pReceiverWallet->lastUpdateTimestamp = originalReceiverLastUpdate;
+        transactions[txPosition].status = TransactionStatus::Failed; // Log the system error that prevented the transfer
+        if (!transactionId.empty()) {
+            releaseTransactionId(transactions[txPosition], "TXN-");
+        }
+        ticket = queueChanges();
+    }
+    walletLocks = {};
+    // A write error is not an answer to the request: the reservation is released (not completed)
+    // so a retry with the same key tries the transfer again
+    outMessage = "Failed to save wallet updates. Transfer has been rolled back.";
+    if (!fileHandler.awaitWalletData(ticket)) {
+        LOG_ERROR("Failed to save transaction log for system error rollback (TxID: " + tx.transactionId + ")");
+    }
+    LOG_ERROR("Transfer failed for user '" + senderUsername + "': " + outMessage);
+    return false;
+}
+
+bool WalletService::reserveTransfer(const std::string& senderUserId, const std::string& senderWalletId,
+                                    const std::string& receiverWalletId, Money amount, const std::string& otpCode,
+                                    std::string& outTransactionId, std::string& outMessage) {
+    if (!amount.isPositive()) {
+        outMessage = "So tien chuyen phai la so duong.";
+        LOG_WARNING("Giu diem that bai: " + outMessage + " So tien: " + amount.toString());
         return false;
     }
-    if (pSenderWallet->userId != senderUserId) {
-        outMessage = "Vi cua nguoi gui khong phai cua ban.";
-        LOG_ERROR("Chuyen tien that bai: User '" + senderUserIt->username + "' (ID: " + senderUserId +
-                  ") dang su dung vi '" + senderWalletId + "' khong phai cua ban.");
+    if (senderWalletId == receiverWalletId) {
+        outMessage = "Khong the chuyen diem den cung mot vi.";
+        LOG_WARNING("Giu diem that bai: ID vi cua nguoi gui va nguoi nhan giong nhau: " + senderWalletId);
         return false;
     }
-    if (!pReceiverWallet) {
-        outMessage = "Vi nguoi nhan (ID: " + receiverWalletId + ") khong tim thay.";
-        LOG_WARNING("Chuyen tien that bai: " + outMessage);
+    releaseExpiredHolds();
+
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    std::string senderUsername;
+    Wallet* pSenderWallet = nullptr;
+    Wallet* pReceiverWallet = nullptr;
+    if (!authorizeTransfer(senderUserId, senderWalletId, receiverWalletId, otpCode,
+                           pSenderWallet, pReceiverWallet, senderUsername, outMessage)) {
         return false;
     }
 
     Transaction tx;
     tx.transactionId = "TXN-" + hashUtils.generateUUID().substr(0,12);
-    tx.sourceWalletId = senderWalletId;
-    tx.targetWalletId = receiverWalletId;
+    tx.sourceWalletId = pSenderWallet->walletId;
+    tx.targetWalletId = pReceiverWallet->walletId;
     tx.amount = amount;
-    tx.timestamp = TimeUtils::getCurrentTimestamp();
-    std::stringstream desc_ss;
-    desc_ss << "Chuyen tu " << senderUserIt->username << " (vi: " << senderWalletId 
-            << ") den vi: " << receiverWalletId;
-    tx.description = desc_ss.str();
-
-    if (pSenderWallet->balance < amount) {
-        outMessage = "So du khong du. Hien co: " + std::to_string(pSenderWallet->balance) + ", can chuyen: " + std::to_string(amount);
-        tx.status = TransactionStatus::Failed;
+    tx.setReason(TransactionReason::Transfer, {senderUsername});
+    tx.status = TransactionStatus::Pending;
+
+    // Only the sender changes; the receiver is not touched until the commit
+    std::unique_lock<std::mutex> walletLock(stripeFor(pSenderWallet->walletId));
+    if (pSenderWallet->available() < amount) {
+        outMessage = "So du khong du. Hien co: " + pSenderWallet->available().toString() + ", can giu: " + amount.toString();
+        LOG_WARNING("Giu diem that bai cho user '" + senderUsername + "': " + outMessage);
+        return false;
+    }
+
+    size_t txPosition = 0;
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        pSenderWallet->held += amount; // The balance itself is unchanged, so the wallet is not written
+        tx.timestamp = TimeUtils::getCurrentTimestamp(); // See transferPoints
+        txPosition = transactions.size();
         transactions.push_back(tx);
-        if(!fileHandler.saveTransactions(transactions)) {
-             LOG_ERROR("Failed to save transaction log for failed (insufficient funds) TxID: " + tx.transactionId);
+        ticket = queueChanges();
+    }
+
+    if (fileHandler.awaitWalletData(ticket)) {
+        holdTimers.schedule(tx.transactionId, tx.timestamp + AppConfig::PENDING_TRANSFER_TIMEOUT_SECONDS);
+        outTransactionId = tx.transactionId.str();
+        outMessage = "Da giu " + amount.toString() + " diem cho giao dich " + outTransactionId + ".";
+        LOG_INFO(outMessage + " Tu " + senderWalletId + " den " + receiverWalletId);
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        pSenderWallet->held -= amount;
+        transactions[txPosition].status = TransactionStatus::Failed;
+        fileHandler.markTransactionUpdated(transactions[txPosition]);
+        ticket = queueChanges();
+    }
+    walletLock.unlock();
+    outMessage = "Failed to save the hold. Nothing has been reserved.";
+    if (!fileHandler.awaitWalletData(ticket)) {
+        LOG_ERROR("Failed to save transaction log for failed hold (TxID: " + tx.transactionId + ")");
+    }
+    LOG_ERROR("Hold failed for user '" + senderUsername + "': " + outMessage);
+    return false;
+}
+
+bool WalletService::commitTransfer(const std::string& callerUserId, const std::string& transactionId,
+                                   std::string& outMessage) {
+    if (callerUserId.empty()) {
+        outMessage = "Ban khong co quyen xu ly giao dich nay.";
+        return false;
+    }
+    releaseExpiredHolds(); // An expired hold can no longer be committed
+    return settleHold(transactionId, callerUserId, true, outMessage);
+}
+
+bool WalletService::cancelTransfer(const std::string& callerUserId, const std::string& transactionId,
+                                   std::string& outMessage) {
+    if (callerUserId.empty()) {
+        outMessage = "Ban khong co quyen xu ly giao dich nay.";
+        return false;
+    }
+    releaseExpiredHolds();
+    return settleHold(transactionId, callerUserId, false, outMessage);
+}
+
+bool WalletService::settleHold(const std::string& transactionId, const std::string& callerUserId, bool commit,
+                               std::string& outMessage) {
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+
+    // Pending transactions are never archived, so a pending one is always found in memory
+    Transaction pending;
+    Wallet* pSourceWallet = nullptr;
+    Wallet* pTargetWallet = nullptr;
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        std::lock_guard<std::mutex> indexLock(indexMutex);
+        const Transaction* tx = static_cast<const DataIndex&>(index).findTransactionById(transactionId);
+        if (!tx || tx->status != TransactionStatus::Pending) {
+            outMessage = "Giao dich " + transactionId + " khong ton tai hoac khong con cho xu ly.";
+            LOG_WARNING((commit ? "Xac nhan" : "Huy") + std::string(" giao dich that bai: ") + outMessage);
+            return false;
         }
-        LOG_WARNING("Chuyen tien that bai cho user '" + senderUserIt->username + "': " + outMessage);
+        pending = *tx;
+        pSourceWallet = index.findWalletById(pending.sourceWalletId.view());
+        pTargetWallet = index.findWalletById(pending.targetWalletId.view());
+    }
+    if (!pSourceWallet || !pTargetWallet) {
+        outMessage = "Vi cua giao dich " + transactionId + " khong tim thay.";
+        LOG_ERROR("Settling hold failed: " + outMessage);
+        return false;
+    }
+    // Wallet owners never change, so the check needs no wallet lock
+    if (!callerUserId.empty() && pSourceWallet->userId.view() != callerUserId) {
+        outMessage = "Ban khong co quyen xu ly giao dich nay.";
+        LOG_WARNING("User ID " + callerUserId + " tried to settle TxID " + transactionId +
+                    " from wallet " + pSourceWallet->walletId + " they do not own");
         return false;
     }
 
-    // Perform transfer (in-memory first)
-    double originalSenderBalance = pSenderWallet->balance; // For potential rollback
-    double originalReceiverBalance = pReceiverWallet->balance; // For potential rollback
+    auto walletLocks = lockWalletPair(pSourceWallet->walletId,
+                                      commit ? pTargetWallet->walletId : pSourceWallet->walletId);
+    const Money amount = pending.amount;
+    const Money originalSourceBalance = pSourceWallet->balance; // For potential rollback
+    const Money originalTargetBalance = pTargetWallet->balance;
+    Transaction* tx = nullptr;
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        {
+            std::lock_guard<std::mutex> indexLock(indexMutex);
+            tx = index.findTransactionById(transactionId);
+        }
+        if (!tx || tx->status != TransactionStatus::Pending) {
+            outMessage = "Giao dich " + transactionId + " da duoc xu ly.";
+            return false; // Settled by another thread since the lookup above
+        }
+        pSourceWallet->held -= amount;
+        if (commit) {
+            // The hold guaranteed these points, so the balance cannot go negative
+            pSourceWallet->balance -= amount;
+            pTargetWallet->balance += amount;
+            const time_t updateTime = TimeUtils::getCurrentTimestamp();
+            pSourceWallet->lastUpdateTimestamp = updateTime;
+            pTargetWallet->lastUpdateTimestamp = updateTime;
+            markDirty(*pSourceWallet);
+            markDirty(*pTargetWallet);
+        }
+        // The original timestamp is kept: history and the archive are ordered by it
+        tx->status = commit ? TransactionStatus::Completed : TransactionStatus::Cancelled;
+        fileHandler.markTransactionUpdated(*tx);
+        ticket = queueChanges();
+    }
 
-    pSenderWallet->balance -= amount;
-    pReceiverWallet->balance += amount;
-    time_t updateTime = TimeUtils::getCurrentTimestamp(); // Use a single timestamp for consistency
-    pSenderWallet->lastUpdateTimestamp = updateTime;
-    pReceiverWallet->lastUpdateTimestamp = updateTime;
+    // Like a transfer, the balances and the new status are one write-ahead log record
+    if (fileHandler.awaitWalletData(ticket)) {
+        walletLocks = {};
+        structureLock.unlock();
+        outMessage = commit ? "Points transferred successfully!" : "Da huy giao dich, diem da duoc tra lai.";
+        LOG_INFO(outMessage + " TxID: " + transactionId + ", Amount: " + amount.toString());
+        if (commit) {
+            archiveIfNeeded(); // The hold may have been the first transaction that could not be archived
+        }
+        return true;
+    }
 
-    if (fileHandler.saveWallets(wallets)) { // Step 1: Save updated wallets
-        tx.status = TransactionStatus::Completed;
-        transactions.push_back(tx);
-        if (fileHandler.saveTransactions(transactions)) { // Step 2: Save successful transaction
-            outMessage = "Points transferred successfully!";
-            LOG_INFO(outMessage + " TxID: " + tx.transactionId + ", Amount: " + std::to_string(amount) +
-                     " from " + senderWalletId + " to " + receiverWalletId);
-            return true;
-        } else {
-            outMessage = "Transfer processed and wallet balances updated, but failed to record transaction log. Please contact support with TxID: " + tx.transactionId;
-            LOG_ERROR("CRITICAL INCONSISTENCY: Wallets updated for TxID " + tx.transactionId +
-                      " but transaction log FAILED to save. Sender new balance: " + std::to_string(pSenderWallet->balance) +
-                      ", Receiver new balance: " + std::to_string(pReceiverWallet->balance));
-        
-            return true;
+    // Nothing reached the disk; the transfer is pending again
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        pSourceWallet->held += amount;
+        if (commit) {
+            pSourceWallet->balance = originalSourceBalance;
+            pTargetWallet->balance = originalTargetBalance;
+            markDirty(*pSourceWallet);
+            markDirty(*pTargetWallet);
         }
-    } else {
-        pSenderWallet->balance = originalSenderBalance;
-        pReceiverWallet->balance = originalReceiverBalance;
-        // pSenderWallet->lastUpdateTimestamp = originalSenderLastUpdate; // Need to store this too for perfect rollback?
-        // pReceiverWallet->lastUpdateTimestamp = originalReceiverLastUpdate;
+        tx->status = TransactionStatus::Pending;
+        fileHandler.markTransactionUpdated(*tx);
+        ticket = queueChanges();
+    }
+    walletLocks = {};
+    outMessage = "Failed to save wallet updates. The transfer is still pending.";
+    if (!fileHandler.awaitWalletData(ticket)) {
+        LOG_ERROR("Failed to save transaction log after rolling back the settlement of TxID: " + transactionId);
+    }
+    LOG_ERROR("Settling TxID " + transactionId + " failed: " + outMessage);
+    return false;
+}
 
-        outMessage = "Failed to save wallet updates. Transfer has been rolled back.";
-        tx.status = TransactionStatus::Failed;
-        transactions.push_back(tx); // Log the system error that prevented the transfer
-        if(!fileHandler.saveTransactions(transactions)){
-            LOG_ERROR("Failed to save transaction log for system error rollback (TxID: " + tx.transactionId + ")");
+void WalletService::releaseExpiredHolds() {
+    const time_t now = TimeUtils::getCurrentTimestamp();
+    for (const Identifier& transactionId : holdTimers.advance(now)) {
+        std::string message;
+        if (settleHold(transactionId.str(), "", false, message)) {
+            LOG_INFO("Pending transfer " + transactionId.str() + " expired and was cancelled");
+            continue;
+        }
+        // Holds settled meanwhile are no longer pending and are skipped. One that is still pending
+        // (the cancellation could not be saved) has lost its timer and is tried again on a later tick.
+        bool stillPending = false;
+        {
+            std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+            std::lock_guard<std::mutex> logLock(transactionLogMutex);
+            std::lock_guard<std::mutex> indexLock(indexMutex);
+            const Transaction* tx = static_cast<const DataIndex&>(index).findTransactionById(transactionId.view());
+            stillPending = tx && tx->status == TransactionStatus::Pending;
+        }
+        if (stillPending) {
+            holdTimers.schedule(transactionId, now + AppConfig::HOLD_TIMER_GRANULARITY_SECONDS);
+            LOG_WARNING("Expired pending transfer " + transactionId.str() + " could not be cancelled (" + message +
+                        "), retrying later");
+        }
+    }
+}
+
+void WalletService::restorePendingTransfers() {
+    std::unique_lock<std::shared_mutex> structureLock(structureMutex);
+    size_t restored = 0;
+    for (const Transaction& tx : transactions) {
+        if (tx.status != TransactionStatus::Pending) {
+            continue;
+        }
+        Wallet* source = index.findWalletById(tx.sourceWalletId.view());
+        if (!source) {
+            LOG_WARNING("Pending transaction " + tx.transactionId + " refers to a missing wallet");
+            continue;
+        }
+        source->held += tx.amount;
+        holdTimers.schedule(tx.transactionId, tx.timestamp + AppConfig::PENDING_TRANSFER_TIMEOUT_SECONDS);
+        ++restored;
+    }
+    if (restored > 0) {
+        LOG_INFO("Restored " + std::to_string(restored) + " pending transfers");
+    }
+    if (!holdExpiryThread.joinable()) {
+        holdExpiryThread = std::thread(&WalletService::holdExpiryLoop, this);
+    }
+}
+
+void WalletService::holdExpiryLoop() {
+    std::unique_lock<std::mutex> lock(holdExpiryMutex);
+    while (!holdExpiryWake.wait_for(lock, std::chrono::seconds(AppConfig::HOLD_TIMER_GRANULARITY_SECONDS),
+                                    [this] { return holdExpiryStopping; })) {
+        lock.unlock();
+        releaseExpiredHolds();
+        lock.lock();
+    }
+}
+
+bool WalletService::exportToJson(const std::string& directory, const std::vector<User>& users,
+                                 const std::vector<UserDetails>& userDetails) const {
+    // Balances and appends need the log lock, and the export maps archive segments
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    std::lock_guard<std::mutex> logLock(transactionLogMutex);
+    std::lock_guard<std::mutex> archiveLock(archiveMutex);
+    return fileHandler.exportToJson(directory, users, userDetails, wallets, transactions, &archive);
+}
+
+size_t WalletService::getUserWalletCount() const {
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    return static_cast<size_t>(std::count_if(wallets.begin(), wallets.end(),
+                                             [this](const Wallet& w) { return !isMasterShard(w); }));
+}
+
+Money WalletService::getTotalBalance() const {
+    // Plain integer reduction over the balances; no rounding drift regardless of wallet count.
+    // Balances only change under transactionLogMutex, so this sees no half-applied transfer.
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    std::lock_guard<std::mutex> logLock(transactionLogMutex);
+    int64_t totalMinorUnits = 0;
+    for (const auto& w : wallets) {
+        if (!isMasterShard(w)) {
+            totalMinorUnits += w.balance.minorUnits();
+        }
+    }
+    return Money::fromMinorUnits(totalMinorUnits);
+}
+
+Wallet* WalletService::nextMasterShard() {
+    if (masterShardIds.empty()) {
+        return nullptr;
+    }
+    const size_t shard = masterShardCursor.fetch_add(1, std::memory_order_relaxed) % masterShardIds.size();
+    return index.findWalletById(masterShardIds[shard].view());
+}
+
+bool WalletService::ensureMasterWalletShards() {
+    std::unique_lock<std::shared_mutex> structureLock(structureMutex);
+    masterShardIds.clear();
+    const size_t existingWallets = wallets.size();
+    const time_t now = TimeUtils::getCurrentTimestamp();
+    for (size_t s = 0; s < AppConfig::MASTER_WALLET_SHARDS; ++s) {
+        std::ostringstream shardId;
+        shardId << AppConfig::MASTER_WALLET_ID << "-S" << std::setw(2) << std::setfill('0') << s;
+        if (!index.findWalletById(shardId.str())) {
+            Wallet shard;
+            shard.walletId = shardId.str();
+            shard.userId = masterWalletId;
+            shard.creationTimestamp = now;
+            shard.lastUpdateTimestamp = now;
+            wallets.push_back(shard);
         }
-        LOG_ERROR("Transfer failed for user '" + senderUserIt->username + "': " + outMessage);
+        masterShardIds.push_back(Identifier(shardId.str()));
+    }
+    if (wallets.size() == existingWallets) {
+        return true;
+    }
+    if (!fileHandler.commitWalletData(wallets, transactions)) {
+        LOG_ERROR("Failed to save the master wallet shards; deposits from the master wallet are not debited");
+        wallets.resize(existingWallets); // Rollback
+        masterShardIds.clear();
         return false;
     }
+    LOG_INFO("Created " + std::to_string(wallets.size() - existingWallets) + " master wallet shards");
+    return true;
 }
 
-std::vector<Transaction> WalletService::getTransactionHistory(const std::string& walletId) const {
-    std::vector<Transaction> history;
-    for (const auto& tx : transactions) {
-        if (tx.sourceWalletId == walletId || tx.targetWalletId == walletId) {
-            history.push_back(tx);
+Money WalletService::getMasterWalletBalance() const {
+    // Every shard ever created counts, including those beyond a since lowered shard count
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    std::lock_guard<std::mutex> logLock(transactionLogMutex);
+    int64_t totalMinorUnits = 0;
+    for (const auto& w : wallets) {
+        if (isMasterShard(w)) {
+            totalMinorUnits += w.balance.minorUnits();
         }
     }
-    // Sort by timestamp, newest first
-    std::sort(history.begin(), history.end(), [](const Transaction& a, const Transaction& b) {
-        return a.timestamp > b.timestamp;
-    });
+    return Money::fromMinorUnits(totalMinorUnits);
+}
+
+std::vector<Transaction> WalletService::getTransactionHistory(const std::string& walletId) const {
+    TransactionHistoryQuery query;
+    query.limit = std::numeric_limits<size_t>::max();
+    std::vector<Transaction> history = getTransactionHistoryPage(walletId, query).transactions;
     LOG_DEBUG("Retrieved " + std::to_string(history.size()) + " transactions for Wallet ID: " + walletId);
     return history;
 }
 
-bool WalletService::depositPoints(const std::string& targetWalletId, double amount, 
+namespace {
+    // Cursor format is "<timestamp>:<transactionId>"; callers treat it as opaque
+    std::string encodeHistoryCursor(const Transaction& tx) {
+        return std::to_string(static_cast<long long>(tx.timestamp)) + ":" + tx.transactionId;
+    }
+
+    bool decodeHistoryCursor(const std::string& cursor, time_t& outTimestamp, std::string& outTransactionId) {
+        const size_t separator = cursor.find(':');
+        if (separator == std::string::npos || separator == 0) {
+            return false;
+        }
+        try {
+            size_t parsed = 0;
+            outTimestamp = static_cast<time_t>(std::stoll(cursor.substr(0, separator), &parsed));
+            if (parsed != separator) {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+        outTransactionId = cursor.substr(separator + 1);
+        return !outTransactionId.empty();
+    }
+
+    // One time-ordered run of a wallet's postings, oldest first: the in-memory posting list
+    // or the postings of one archive segment. Entries before 'end' are still to be returned.
+    struct HistorySource {
+        std::function<TransactionView(size_t)> viewAt;
+        // Separate from viewAt so searching by time never decompresses an archive block
+        std::function<time_t(size_t)> timestampAt;
+        size_t size = 0;
+        size_t end = 0;
+
+        // First entry with a timestamp above ts (inclusive == false) or at/above ts (inclusive == true)
+        size_t boundFor(time_t ts, bool inclusive) const {
+            size_t low = 0;
+            size_t high = size;
+            while (low < high) {
+                const size_t mid = low + (high - low) / 2;
+                const time_t midTs = timestampAt(mid);
+                if (midTs < ts || (!inclusive && midTs == ts)) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+    };
+}
+
+TransactionHistoryPage WalletService::getTransactionHistoryPage(const std::string& walletId,
+                                                                const TransactionHistoryQuery& query) const {
+    TransactionHistoryPage page;
+    if (query.limit == 0) {
+        return page;
+    }
+
+    time_t cursorTimestamp = 0;
+    std::string cursorTransactionId;
+    if (!query.cursor.empty() && !decodeHistoryCursor(query.cursor, cursorTimestamp, cursorTransactionId)) {
+        LOG_WARNING("Invalid transaction history cursor for Wallet ID " + walletId + ": " + query.cursor);
+        return page;
+    }
+
+    // Archiving would move in-memory transactions into the archive while they are read
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+
+    // The in-memory entries the page can use are copied, so appends are not blocked while the
+    // archive is read: the newest limit + 1 matching ones (one more tells whether there is a next
+    // page) and every entry sharing the cursor's timestamp, among which the cursor is located.
+    std::vector<Transaction> hotEntries;
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        const std::vector<size_t>* hotPostingsList = nullptr;
+        {
+            std::lock_guard<std::mutex> indexLock(indexMutex);
+            // The list only grows while transactions are appended, which logLock prevents
+            hotPostingsList = &index.transactionPositionsForWallet(walletId);
+        }
+        const std::vector<size_t>& hotPostings = *hotPostingsList;
+        HistorySource hot{nullptr, [this, &hotPostings](size_t i) { return transactions[hotPostings[i]].timestamp; },
+                          hotPostings.size(), hotPostings.size()};
+        if (!query.cursor.empty()) {
+            hot.end = hot.boundFor(cursorTimestamp, false);
+        }
+        if (query.toTimestamp) {
+            hot.end = std::min(hot.end, hot.boundFor(*query.toTimestamp, false));
+        }
+        size_t matching = 0;
+        for (size_t i = hot.end; i-- > 0 && matching <= query.limit;) {
+            const Transaction& tx = transactions[hotPostings[i]];
+            if (query.fromTimestamp && tx.timestamp < *query.fromTimestamp) {
+                break;
+            }
+            const bool tied = !query.cursor.empty() && tx.timestamp == cursorTimestamp;
+            const bool matches = (!query.status || tx.status == *query.status) &&
+                                 (!query.reason || tx.reason == *query.reason);
+            if (tied || matches) {
+                hotEntries.push_back(tx);
+            }
+            matching += (matches && !tied) ? 1 : 0;
+        }
+        std::reverse(hotEntries.begin(), hotEntries.end()); // Oldest first, like every source
+    }
+
+    // Sources are ordered oldest first: archive segments in write order, then memory.
+    // Between sources, equal timestamps are broken by source order (later source is newer).
+    // Segments entirely outside the requested range (or after the cursor) are not touched at all.
+    // Segments are mapped on first use; views from them stay valid until archiveLock is released.
+    std::lock_guard<std::mutex> archiveLock(archiveMutex);
+    std::vector<HistorySource> sources;
+    archive.releaseCold();
+    for (size_t s = 0; s < archive.segments().size(); ++s) {
+        const ArchiveSegment& metadata = archive.segments()[s];
+        if ((query.fromTimestamp && metadata.newestTimestamp() < *query.fromTimestamp) ||
+            (query.toTimestamp && metadata.oldestTimestamp() > *query.toTimestamp) ||
+            (!query.cursor.empty() && metadata.oldestTimestamp() > cursorTimestamp)) {
+            continue;
+        }
+        const ArchiveSegment* segment = archive.acquire(s);
+        if (!segment) {
+            LOG_WARNING("History for Wallet ID " + walletId + " skips unreadable archive segment " + metadata.path());
+            continue;
+        }
+        const ArchiveSegment::Postings postings = segment->postingsForWallet(walletId);
+        if (postings.size() > 0) {
+            sources.push_back({[segment, postings](size_t i) { return segment->record(postings[i]); },
+                               [segment, postings](size_t i) { return segment->timestampAt(postings[i]); },
+                               postings.size(), postings.size()});
+        }
+    }
+    if (!hotEntries.empty()) {
+        sources.push_back({[&hotEntries](size_t i) { return TransactionView::of(hotEntries[i]); },
+                           [&hotEntries](size_t i) { return hotEntries[i].timestamp; },
+                           hotEntries.size(), hotEntries.size()});
+    }
+
+    if (!query.cursor.empty()) {
+        // Locate the cursor transaction among the entries sharing its timestamp. It may have
+        // moved from memory into the archive since the previous page, so every source is searched.
+        size_t cursorSource = sources.size();
+        size_t cursorEntry = 0;
+        for (size_t s = 0; s < sources.size() && cursorSource == sources.size(); ++s) {
+            const size_t tieEnd = sources[s].boundFor(cursorTimestamp, false);
+            for (size_t i = sources[s].boundFor(cursorTimestamp, true); i < tieEnd; ++i) {
+                if (sources[s].viewAt(i).transactionId == cursorTransactionId) {
+                    cursorSource = s;
+                    cursorEntry = i;
+                    break;
+                }
+            }
+        }
+        // Resume strictly after the cursor: ties in older sources still follow it, ties in newer
+        // ones came before it. An unknown cursor resumes strictly before its timestamp.
+        for (size_t s = 0; s < sources.size(); ++s) {
+            if (s == cursorSource) {
+                sources[s].end = cursorEntry;
+            } else {
+                sources[s].end = sources[s].boundFor(cursorTimestamp, s > cursorSource || cursorSource == sources.size());
+            }
+        }
+    }
+    if (query.toTimestamp) {
+        for (HistorySource& source : sources) {
+            source.end = std::min(source.end, source.boundFor(*query.toTimestamp, false));
+        }
+    }
+
+    // Merge the sources newest first
+    while (true) {
+        HistorySource* newest = nullptr;
+        time_t newestTimestamp = 0;
+        for (HistorySource& source : sources) {
+            if (source.end == 0) {
+                continue;
+            }
+            const time_t ts = source.timestampAt(source.end - 1);
+            if (!newest || ts >= newestTimestamp) {
+                newest = &source;
+                newestTimestamp = ts;
+            }
+        }
+        if (!newest || (query.fromTimestamp && newestTimestamp < *query.fromTimestamp)) {
+            break;
+        }
+        const TransactionView view = newest->viewAt(newest->end - 1);
+        if ((query.status && view.status != *query.status) || (query.reason && view.reason != *query.reason)) {
+            --newest->end;
+            continue;
+        }
+        if (page.transactions.size() == query.limit) {
+            page.nextCursor = encodeHistoryCursor(page.transactions.back());
+            break;
+        }
+        page.transactions.push_back(view.toTransaction());
+        --newest->end;
+    }
+    return page;
+}
+
+uint64_t WalletService::queueChanges() {
+    return fileHandler.queueWalletData(wallets, transactions);
+}
+
+void WalletService::releaseTransactionId(Transaction& transaction, const std::string& prefix) {
+    const std::string keyedId = transaction.transactionId.str();
+    transaction.transactionId = prefix + hashUtils.generateUUID().substr(0,12);
+    std::lock_guard<std::mutex> indexLock(indexMutex);
+    index.rebuildTransactions(); // The ID index only picks up appended records by itself
+    LOG_INFO("Failed transaction " + keyedId + " recorded as " + transaction.transactionId);
+}
+
+void WalletService::archiveIfNeeded() {
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        if (!AppConfig::USE_TRANSACTION_ARCHIVE || transactions.size() <= AppConfig::HOT_TRANSACTION_LIMIT) {
+            return;
+        }
+    }
+    if (!archiveOldTransactions()) {
+        // The transactions are safely in the write-ahead log; archiving is retried after the next commit
+        LOG_WARNING("Archiving old transactions failed, keeping them in memory for now");
+    }
+}
+
+bool WalletService::archiveOldTransactions() {
+    // Waits for running transfers; erasing from the front moves every in-memory transaction
+    std::unique_lock<std::shared_mutex> structureLock(structureMutex);
+    if (!AppConfig::USE_TRANSACTION_ARCHIVE || transactions.size() <= AppConfig::HOT_TRANSACTION_LIMIT) {
+        return true; // Another thread may have archived them first
+    }
+    // Only a prefix is moved, so the archive always holds exactly the oldest transactions.
+    // Pending transactions may still change and stop the prefix.
+    const size_t candidates = transactions.size() - AppConfig::HOT_TRANSACTIONS_KEPT;
+    size_t count = 0;
+    while (count < candidates && transactions[count].status != TransactionStatus::Pending) {
+        ++count;
+    }
+    if (count == 0) {
+        return true;
+    }
+    // One segment per run of transactions sharing a time bucket. Every segment extends the archived
+    // prefix, so stopping after any of them leaves the archive consistent.
+    size_t archived = 0;
+    while (archived < count) {
+        const uint32_t bucket = TransactionArchive::timeBucket(transactions[archived].timestamp);
+        size_t runEnd = archived + 1;
+        while (runEnd < count && TransactionArchive::timeBucket(transactions[runEnd].timestamp) == bucket) {
+            ++runEnd;
+        }
+        if (!archive.appendSegment(transactions, archived, runEnd - archived)) {
+            break;
+        }
+        archived = runEnd;
+    }
+    if (archived == 0) {
+        return false;
+    }
+
+    transactions.erase(transactions.begin(), transactions.begin() + static_cast<std::ptrdiff_t>(archived));
+    index.rebuildTransactions();
+    // The checkpoint rewrites the snapshot without the archived records and empties the log.
+    // If that fails they stay on disk twice and reconcileWithArchive drops them on the next start.
+    if (!fileHandler.checkpoint(wallets, transactions)) {
+        LOG_WARNING("Transactions were archived but the transaction snapshot could not be rewritten");
+    }
+    archive.compact(std::time(nullptr)); // Cheap unless a bucket has just been closed
+    return archived == count;
+}
+
+bool WalletService::compactArchive() {
+    if (!AppConfig::USE_TRANSACTION_ARCHIVE) {
+        return true;
+    }
+    std::unique_lock<std::shared_mutex> structureLock(structureMutex);
+    return archive.compact(std::time(nullptr));
+}
+
+void WalletService::reconcileWithArchive() {
+    std::unique_lock<std::shared_mutex> structureLock(structureMutex);
+    if (archive.segments().empty() || transactions.empty()) {
+        return;
+    }
+    const ArchiveSegment& newest = archive.segments().back();
+    const Identifier lastArchivedId = Identifier::find(newest.lastAppendedTransactionId());
+    // An interrupted run may have written several segments (one per time bucket)
+    const size_t scanLimit = std::min(transactions.size(), archive.transactionCount());
+    for (size_t i = 0; i < scanLimit; ++i) {
+        if (transactions[i].transactionId == lastArchivedId) {
+            LOG_WARNING("Dropping " + std::to_string(i + 1) + " in-memory transactions that are already archived");
+            transactions.erase(transactions.begin(), transactions.begin() + static_cast<std::ptrdiff_t>(i + 1));
+            index.rebuildTransactions();
+            if (!fileHandler.checkpoint(wallets, transactions)) {
+                LOG_ERROR("Failed to rewrite the transaction snapshot after reconciling with the archive");
+            }
+            return;
+        }
+    }
+}
+
+bool WalletService::depositPoints(const std::string& targetWalletId, Money amount, 
                                   const std::string& description, const std::string& initiatedByUserId,
                                   std::string& outMessage, 
-                                  const std::string& sourceWalletId) {
-    if (amount <= 0) {
+                                  const std::string& sourceWalletId, TransactionReason reason,
+                                  const std::string& idempotencyKey) {
+    if (!amount.isPositive()) {
         outMessage = "Deposit amount must be positive.";
-        LOG_WARNING("Deposit attempt failed: " + outMessage + " Amount: " + std::to_string(amount));
+        LOG_WARNING("Deposit attempt failed: " + outMessage + " Amount: " + amount.toString());
         return false;
     }
 
-    Wallet* pTargetWallet = nullptr;
-    for (auto& w : wallets) { // Non-const ref for modification
-        if (w.walletId == targetWalletId) pTargetWallet = &w;
+    IdempotencyCache::Reservation reservation; // See transferPoints
+    std::string transactionId;
+    std::string fingerprint;
+    if (!idempotencyKey.empty()) {
+        // The source of a deposit is a label shared by all deposits, so the key is scoped to the
+        // target as well: the earlier deposit is then always among the target's postings
+        const std::string scopedKey = "deposit:" + initiatedByUserId + ":" + targetWalletId + ":" + idempotencyKey;
+        transactionId = IdempotencyCache::transactionIdFor("DEP-", scopedKey);
+        fingerprint = targetWalletId + ":" + std::to_string(amount.minorUnits());
+        if (auto earlier = findEarlierOutcome(scopedKey, transactionId, fingerprint, targetWalletId, reservation)) {
+            outMessage = earlier->message;
+            LOG_INFO("Repeated deposit with idempotency key '" + idempotencyKey + "', TxID: " + earlier->transactionId);
+            return earlier->success;
+        }
+    }
+
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+    Wallet* pTargetWallet = nullptr; // Non-const for modification
+    Wallet* pSourceShard = nullptr;  // Debited when the points come from the master wallet
+    {
+        std::lock_guard<std::mutex> indexLock(indexMutex);
+        pTargetWallet = index.findWalletById(targetWalletId);
+        if (pTargetWallet && sourceWalletId == AppConfig::MASTER_WALLET_ID) {
+            pSourceShard = nextMasterShard();
+        }
     }
 
     if (!pTargetWallet) {
@@ -244,46 +1103,247 @@ bool WalletService::depositPoints(const std::string& targetWalletId, double amou
         LOG_WARNING("Deposit failed: " + outMessage);
         return false;
     }
+    if (isMasterShard(*pTargetWallet)) {
+        outMessage = "Khong the nap diem vao vi tong.";
+        LOG_WARNING("Deposit failed: " + outMessage + " Target: " + targetWalletId);
+        return false;
+    }
 
     Transaction tx;
-    tx.transactionId = "DEP-" + hashUtils.generateUUID().substr(0,12);
-    tx.sourceWalletId = sourceWalletId;
-    tx.targetWalletId = targetWalletId;
+    tx.transactionId = transactionId.empty() ? "DEP-" + hashUtils.generateUUID().substr(0,12) : transactionId;
+    tx.sourceWalletId = pSourceShard ? pSourceShard->walletId : Identifier(sourceWalletId);
+    tx.targetWalletId = pTargetWallet->walletId;
     tx.amount = amount;
-    tx.timestamp = TimeUtils::getCurrentTimestamp();
-    tx.description = description + " (Initiated by: " + initiatedByUserId + ")";
+    tx.setReason(reason, {description, initiatedByUserId});
     tx.status = TransactionStatus::Completed;
 
-    double originalTargetBalance = pTargetWallet->balance; // For potential rollback
+    // Held until the deposit is committed (see transferPoints). Without a shard to debit
+    // only the target's stripe is taken.
+    auto walletLocks = lockWalletPair(pTargetWallet->walletId,
+                                      pSourceShard ? pSourceShard->walletId : pTargetWallet->walletId);
+    Money originalTargetBalance = pTargetWallet->balance; // For potential rollback
+    Money originalShardBalance = pSourceShard ? pSourceShard->balance : Money();
+    Money newBalance;
+    size_t txPosition = 0;
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        // Update balance
+        pTargetWallet->balance += amount;
+        pTargetWallet->lastUpdateTimestamp = TimeUtils::getCurrentTimestamp();
+        tx.timestamp = pTargetWallet->lastUpdateTimestamp; // See transferPoints
+        newBalance = pTargetWallet->balance;
+        markDirty(*pTargetWallet);
+        if (pSourceShard) {
+            pSourceShard->balance -= amount; // May go negative: the master wallet issues points
+            pSourceShard->lastUpdateTimestamp = pTargetWallet->lastUpdateTimestamp;
+            markDirty(*pSourceShard);
+        }
+        txPosition = transactions.size();
+        transactions.push_back(tx);
+        ticket = queueChanges();
+    }
 
-    // Update balance
-    pTargetWallet->balance += amount;
-    pTargetWallet->lastUpdateTimestamp = TimeUtils::getCurrentTimestamp();
+    // The new balance and the deposit record are committed together
+    if (fileHandler.awaitWalletData(ticket)) {
+        walletLocks = {};
+        structureLock.unlock();
+        outMessage = "Deposit successful. New balance: " + newBalance.toString();
+        reservation.complete({true, outMessage, tx.transactionId.str(), fingerprint});
+        LOG_INFO("Deposit successful for wallet " + targetWalletId + 
+                 ". Amount: " + amount.toString() + 
+                 ", New balance: " + newBalance.toString());
+        archiveIfNeeded();
+        return true;
+    }
 
-    // Save updated wallets
-    if (fileHandler.saveWallets(wallets)) {
-        // Save transaction record
-        transactions.push_back(tx);
-        if (fileHandler.saveTransactions(transactions)) {
-            outMessage = "Deposit successful. New balance: " + std::to_string(pTargetWallet->balance);
-            LOG_INFO("Deposit successful for wallet " + targetWalletId + 
-                     ". Amount: " + std::to_string(amount) + 
-                     ", New balance: " + std::to_string(pTargetWallet->balance));
-            return true;
+    // Rollback in-memory changes and commit the rolled back state.
+    // Later deposits may have been appended meanwhile, so the record is marked failed, not removed.
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        pTargetWallet->balance = originalTargetBalance;
+        markDirty(*pTargetWallet);
+        if (pSourceShard) {
+            pSourceShard->balance = originalShardBalance;
+            markDirty(*pSourceShard);
+        }
+        transactions[txPosition].status = TransactionStatus::Failed;
+        if (!transactionId.empty()) {
+            releaseTransactionId(transactions[txPosition], "DEP-"); // See transferPoints
+        }
+        fileHandler.markTransactionUpdated(transactions[txPosition]);
+        ticket = queueChanges();
+    }
+    walletLocks = {};
+    outMessage = "Failed to save wallet updates. Deposit has been rolled back.";
+    if (!fileHandler.awaitWalletData(ticket)) {
+        LOG_ERROR("Failed to save transaction log for failed deposit (TxID: " + tx.transactionId + ")");
+    }
+    LOG_ERROR("Deposit failed to save wallet updates for wallet " + targetWalletId);
+    return false;
+}
+
+std::vector<PostingResult> WalletService::postBatch(const std::vector<WalletPosting>& postings,
+                                                    const std::string& initiatedByUserId) {
+    std::vector<PostingResult> results(postings.size());
+    if (postings.empty()) {
+        return results;
+    }
+
+    std::shared_lock<std::shared_mutex> structureLock(structureMutex);
+
+    // Resolve every wallet in one pass over the index
+    std::vector<Wallet*> sources(postings.size(), nullptr);
+    std::vector<Wallet*> targets(postings.size(), nullptr);
+    {
+        std::lock_guard<std::mutex> indexLock(indexMutex);
+        for (size_t i = 0; i < postings.size(); ++i) {
+            const WalletPosting& posting = postings[i];
+            if (!posting.amount.isPositive()) {
+                results[i].message = "So tien phai la so duong.";
+                continue;
+            }
+            targets[i] = index.findWalletById(posting.targetWalletId);
+            if (!targets[i] || isMasterShard(*targets[i])) {
+                results[i].message = targets[i] ? "Khong the nap diem vao vi tong."
+                                                : "Vi nhan (ID: " + posting.targetWalletId + ") khong tim thay.";
+                targets[i] = nullptr;
+                continue;
+            }
+            if (!posting.debitSource && posting.sourceWalletId == AppConfig::MASTER_WALLET_ID) {
+                sources[i] = nextMasterShard(); // Consecutive postings spread over the shards
+            } else if (posting.debitSource) {
+                sources[i] = index.findWalletById(posting.sourceWalletId);
+                // Shards are only debited by deposits from the master wallet, which skip the balance check
+                if (!sources[i] || sources[i] == targets[i] || isMasterShard(*sources[i])) {
+                    results[i].message = !sources[i] ? "Vi nguon (ID: " + posting.sourceWalletId + ") khong tim thay."
+                                         : sources[i] == targets[i] ? "Khong the chuyen diem den cung mot vi."
+                                                                    : "Khong the chuyen diem tu vi tong.";
+                    targets[i] = nullptr;
+                    sources[i] = nullptr;
+                }
+            }
+        }
+    }
+
+    // Transactions are built before any wallet is locked
+    std::vector<Transaction> batch;
+    std::vector<size_t> batchItem; // batch[k] belongs to postings[batchItem[k]]
+    std::vector<size_t> stripes;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if (!targets[i]) {
+            continue;
+        }
+        const WalletPosting& posting = postings[i];
+        Transaction tx;
+        tx.transactionId = (posting.debitSource ? "TXN-" : "DEP-") + hashUtils.generateUUID().substr(0,12);
+        tx.sourceWalletId = sources[i] ? sources[i]->walletId : Identifier(posting.sourceWalletId);
+        tx.targetWalletId = targets[i]->walletId;
+        tx.amount = posting.amount;
+        if (posting.reason == TransactionReason::Transfer || posting.reason == TransactionReason::Note) {
+            tx.setReason(posting.reason, {posting.description});
         } else {
-            // Rollback wallet balance if transaction save fails
-            pTargetWallet->balance = originalTargetBalance;
-            pTargetWallet->lastUpdateTimestamp = TimeUtils::getCurrentTimestamp();
-            fileHandler.saveWallets(wallets); // Save the rollback
-            outMessage = "Deposit processed but failed to record transaction. Balance has been restored.";
-            LOG_ERROR("Deposit failed to save transaction record for wallet " + targetWalletId);
-            return false;
+            tx.setReason(posting.reason, {posting.description, initiatedByUserId});
         }
-    } else {
-        // Rollback in-memory changes
-        pTargetWallet->balance = originalTargetBalance;
-        outMessage = "Failed to save wallet updates. Deposit has been rolled back.";
-        LOG_ERROR("Deposit failed to save wallet updates for wallet " + targetWalletId);
-        return false;
+        tx.status = TransactionStatus::Completed;
+        results[i].transactionId = tx.transactionId.str();
+        batch.push_back(std::move(tx));
+        batchItem.push_back(i);
+        stripes.push_back(stripeIndexFor(targets[i]->walletId));
+        if (sources[i]) {
+            stripes.push_back(stripeIndexFor(sources[i]->walletId));
+        }
+    }
+    if (batch.empty()) {
+        LOG_WARNING("Batch of " + std::to_string(postings.size()) + " postings rejected entirely");
+        return results;
+    }
+
+    // Ascending stripe order, as in lockWalletPair, so batches and single transfers cannot deadlock
+    std::sort(stripes.begin(), stripes.end());
+    stripes.erase(std::unique(stripes.begin(), stripes.end()), stripes.end());
+    std::vector<std::unique_lock<std::mutex>> walletLocks;
+    walletLocks.reserve(stripes.size());
+    for (size_t stripe : stripes) {
+        walletLocks.emplace_back(walletStripes[stripe]);
+    }
+
+    std::unordered_map<Wallet*, Money> originalBalances; // For potential rollback
+    size_t firstPosition = 0;
+    size_t applied = 0;
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        const time_t now = TimeUtils::getCurrentTimestamp(); // See transferPoints
+        firstPosition = transactions.size();
+        for (size_t k = 0; k < batch.size(); ++k) {
+            const size_t i = batchItem[k];
+            batch[k].timestamp = now;
+            Wallet* source = sources[i];
+            Wallet* target = targets[i];
+            // Deposits from the master wallet may take its shards negative
+            if (source && !isMasterShard(*source) && source->available() < batch[k].amount) {
+                // Recorded like a single transfer that fails for insufficient funds
+                batch[k].status = TransactionStatus::Failed;
+                results[i].message = "So du khong du. Hien co: " + source->available().toString() +
+                                     ", can chuyen: " + batch[k].amount.toString();
+                continue;
+            }
+            if (source) {
+                originalBalances.emplace(source, source->balance);
+                source->balance -= batch[k].amount;
+                source->lastUpdateTimestamp = now;
+            }
+            originalBalances.emplace(target, target->balance);
+            target->balance += batch[k].amount;
+            target->lastUpdateTimestamp = now;
+            results[i].success = true;
+            ++applied;
+        }
+        for (const auto& touched : originalBalances) {
+            markDirty(*touched.first);
+        }
+        transactions.insert(transactions.end(), batch.begin(), batch.end());
+        ticket = queueChanges();
+    }
+
+    // Every accepted posting is part of this one write-ahead log record
+    if (fileHandler.awaitWalletData(ticket)) {
+        walletLocks.clear();
+        structureLock.unlock();
+        LOG_INFO("Batch by '" + initiatedByUserId + "': " + std::to_string(applied) + " of " +
+                 std::to_string(postings.size()) + " postings applied");
+        for (size_t i = 0; i < postings.size(); ++i) {
+            if (results[i].success) {
+                results[i].message = "Thanh cong.";
+            }
+        }
+        archiveIfNeeded();
+        return results;
+    }
+
+    // Nothing of the batch reached the disk; undo all of it and record the failure
+    {
+        std::lock_guard<std::mutex> logLock(transactionLogMutex);
+        for (const auto& [wallet, originalBalance] : originalBalances) {
+            wallet->balance = originalBalance;
+            markDirty(*wallet);
+        }
+        for (size_t k = 0; k < batch.size(); ++k) {
+            transactions[firstPosition + k].status = TransactionStatus::Failed;
+        }
+        ticket = queueChanges();
+    }
+    walletLocks.clear();
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if (results[i].success) {
+            results[i].success = false;
+            results[i].message = "Loi khi luu du lieu. Giao dich da duoc hoan tac.";
+        }
+    }
+    if (!fileHandler.awaitWalletData(ticket)) {
+        LOG_ERROR("Failed to save transaction log for rolled back batch of " + std::to_string(batch.size()));
     }
+    LOG_ERROR("Batch by '" + initiatedByUserId + "' failed to save wallet updates and was rolled back");
+    return results;
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+// src/utils/BinarySnapshot.cpp
+#include "../../include/utils/BinarySnapshot.hpp"
+#include "../../include/utils/DurableFile.hpp"
+#include <array>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    constexpr char MAGIC[4] = {'R', 'W', 'S', 'B'};
+    constexpr size_t HEADER_SIZE = 32;
+
+    enum class RecordKind : uint16_t {
+        Users = 1,
+        Wallets = 2,
+        Transactions = 3
+    };
+
+    class BinaryWriter {
+    public:
+        std::string buffer;
+
+        void putU8(uint8_t value) { buffer.push_back(static_cast<char>(value)); }
+        void putU16(uint16_t value) { putLittleEndian(value, 2); }
+        void putU32(uint32_t value) { putLittleEndian(value, 4); }
+        void putU64(uint64_t value) { putLittleEndian(value, 8); }
+        void putI64(int64_t value) { putU64(static_cast<uint64_t>(value)); }
+        void putString(std::string_view value) {
+            putU32(static_cast<uint32_t>(value.size()));
+            buffer.append(value);
+        }
+
+    private:
+        void putLittleEndian(uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; ++i) {
+                buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+    };
+
+    // Bounds-checked cursor over a loaded snapshot; any overrun sets ok to false
+    class BinaryReader {
+    public:
+        BinaryReader(const char* data, size_t size) : data(data), size(size) {}
+
+        bool ok = true;
+
+        uint8_t getU8() { return static_cast<uint8_t>(getLittleEndian(1)); }
+        uint16_t getU16() { return static_cast<uint16_t>(getLittleEndian(2)); }
+        uint32_t getU32() { return static_cast<uint32_t>(getLittleEndian(4)); }
+        uint64_t getU64() { return getLittleEndian(8); }
+        int64_t getI64() { return static_cast<int64_t>(getU64()); }
+        std::string getString() {
+            return std::string(getStringView());
+        }
+        // Valid while the snapshot buffer lives; lets IDs be decoded without a temporary string
+        std::string_view getStringView() {
+            const uint32_t length = getU32();
+            if (!ok || size - pos < length) {
+                ok = false;
+                return std::string_view();
+            }
+            std::string_view value(data + pos, length);
+            pos += length;
+            return value;
+        }
+        bool atEnd() const { return pos == size; }
+
+    private:
+        const char* data;
+        size_t size;
+        size_t pos = 0;
+
+        uint64_t getLittleEndian(int bytes) {
+            if (!ok || size - pos < static_cast<size_t>(bytes)) {
+                ok = false;
+                return 0;
+            }
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+            }
+            pos += bytes;
+            return value;
+        }
+    };
+
+    // --- Record encodings ---
+    // A user record holds both parts of the account, in the order of the single-struct layout
+    void encode(BinaryWriter& out, const User& u, const UserDetails& d) {
+        out.putString(u.userId.view());
+        out.putString(u.username);
+        out.putString(d.passwordHash);
+        out.putString(d.fullName);
+        out.putString(d.email);
+        out.putString(d.phoneNumber);
+        out.putU8(static_cast<uint8_t>(u.role));
+        out.putU8(static_cast<uint8_t>(u.status));
+        out.putString(d.otpSecretKey);
+        out.putU8(u.isTemporaryPassword ? 1 : 0);
+    }
+
+    bool decode(BinaryReader& in, User& u, UserDetails& d) {
+        u.userId = Identifier(in.getStringView());
+        u.username = in.getString();
+        d.passwordHash = in.getString();
+        d.fullName = in.getString();
+        d.email = in.getString();
+        d.phoneNumber = in.getString();
+        const uint8_t role = in.getU8();
+        const uint8_t status = in.getU8();
+        d.otpSecretKey = in.getString();
+        u.isTemporaryPassword = in.getU8() != 0;
+        u.otpEnabled = !d.otpSecretKey.empty();
+        if (role > static_cast<uint8_t>(UserRole::AdminUser) || status > static_cast<uint8_t>(AccountStatus::Inactive)) {
+            return false;
+        }
+        u.role = static_cast<UserRole>(role);
+        u.status = static_cast<AccountStatus>(status);
+        return in.ok;
+    }
+
+    void encode(BinaryWriter& out, const Wallet& w) {
+        out.putString(w.walletId.view());
+        out.putString(w.userId.view());
+        out.putI64(w.balance.minorUnits());
+        out.putI64(static_cast<int64_t>(w.creationTimestamp));
+        out.putI64(static_cast<int64_t>(w.lastUpdateTimestamp));
+    }
+
+    bool decode(BinaryReader& in, Wallet& w) {
+        w.walletId = Identifier(in.getStringView());
+        w.userId = Identifier(in.getStringView());
+        w.balance = Money::fromMinorUnits(in.getI64());
+        w.creationTimestamp = static_cast<time_t>(in.getI64());
+        w.lastUpdateTimestamp = static_cast<time_t>(in.getI64());
+        return in.ok;
+    }
+
+    void encode(BinaryWriter& out, const Transaction& tx) {
+        out.putString(tx.transactionId.view());
+        out.putString(tx.sourceWalletId.view());
+        out.putString(tx.targetWalletId.view());
+        out.putI64(tx.amount.minorUnits());
+        out.putString(tx.reasonArgs);
+        out.putI64(static_cast<int64_t>(tx.timestamp));
+        out.putU8(static_cast<uint8_t>(tx.status));
+        out.putU8(static_cast<uint8_t>(tx.reason));
+    }
+
+    bool decode(BinaryReader& in, Transaction& tx) {
+        tx.transactionId = Identifier(in.getStringView());
+        tx.sourceWalletId = Identifier(in.getStringView());
+        tx.targetWalletId = Identifier(in.getStringView());
+        tx.amount = Money::fromMinorUnits(in.getI64());
+        tx.reasonArgs = in.getString();
+        tx.timestamp = static_cast<time_t>(in.getI64());
+        const uint8_t status = in.getU8();
+        const uint8_t reason = in.getU8();
+        if (status > static_cast<uint8_t>(TransactionStatus::Cancelled) || !Transaction::isValidReason(reason)) {
+            return false;
+        }
+        tx.status = static_cast<TransactionStatus>(status);
+        tx.reason = static_cast<TransactionReason>(reason);
+        return in.ok;
+    }
+
+    // Parallel vectors (same size as records) are encoded into the same record
+    template <typename T, typename... Parallel>
+    bool writeRecords(const std::string& filePath, RecordKind kind, const std::vector<T>& records,
+                      const std::vector<Parallel>&... parallel) {
+        BinaryWriter payload;
+        for (size_t i = 0; i < records.size(); ++i) {
+            encode(payload, records[i], parallel[i]...);
+        }
+
+        BinaryWriter header;
+        header.buffer.append(MAGIC, sizeof(MAGIC));
+        header.putU16(BinarySnapshot::FORMAT_VERSION);
+        header.putU16(static_cast<uint16_t>(kind));
+        header.putU64(records.size());
+        header.putU64(payload.buffer.size());
+        header.putU32(BinarySnapshot::crc32(payload.buffer.data(), payload.buffer.size()));
+        header.putU32(0); // Reserved
+
+        std::string error;
+        return DurableFile::writeAtomically(filePath, [&](std::ostream& file) {
+            file.write(header.buffer.data(), static_cast<std::streamsize>(header.buffer.size()));
+            file.write(payload.buffer.data(), static_cast<std::streamsize>(payload.buffer.size()));
+            return file.good();
+        }, error);
+    }
+
+    template <typename T, typename... Parallel>
+    bool readRecords(const std::string& filePath, RecordKind kind, std::string& outError, std::vector<T>& outRecords,
+                     std::vector<Parallel>&... outParallel) {
+        outRecords.clear();
+        (outParallel.clear(), ...);
+        std::ifstream file(filePath, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            outError = "file not found";
+            return false;
+        }
+        const std::streamoff fileSize = file.tellg();
+        if (fileSize < static_cast<std::streamoff>(HEADER_SIZE)) {
+            outError = "file is shorter than the header";
+            return false;
+        }
+        std::string contents(static_cast<size_t>(fileSize), '\0');
+        file.seekg(0);
+        if (!file.read(&contents[0], fileSize)) {
+            outError = "read failed";
+            return false;
+        }
+
+        if (std::memcmp(contents.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            outError = "bad magic";
+            return false;
+        }
+        BinaryReader header(contents.data() + sizeof(MAGIC), HEADER_SIZE - sizeof(MAGIC));
+        const uint16_t version = header.getU16();
+        const uint16_t recordKind = header.getU16();
+        const uint64_t recordCount = header.getU64();
+        const uint64_t payloadSize = header.getU64();
+        const uint32_t checksum = header.getU32();
+        if (version != BinarySnapshot::FORMAT_VERSION) {
+            outError = "unsupported version " + std::to_string(version);
+            return false;
+        }
+        if (recordKind != static_cast<uint16_t>(kind)) {
+            outError = "snapshot holds a different record kind";
+            return false;
+        }
+        if (payloadSize != contents.size() - HEADER_SIZE) {
+            outError = "payload size does not match the file size";
+            return false;
+        }
+        const char* payload = contents.data() + HEADER_SIZE;
+        if (BinarySnapshot::crc32(payload, payloadSize) != checksum) {
+            outError = "checksum mismatch";
+            return false;
+        }
+
+        if (recordCount > payloadSize) {
+            outError = "record count exceeds the payload"; // Every record takes at least one byte
+            return false;
+        }
+
+        BinaryReader in(payload, payloadSize);
+        outRecords.resize(static_cast<size_t>(recordCount));
+        (outParallel.resize(static_cast<size_t>(recordCount)), ...);
+        for (size_t i = 0; i < outRecords.size(); ++i) {
+            if (!decode(in, outRecords[i], outParallel[i]...)) {
+                outRecords.clear();
+                (outParallel.clear(), ...);
+                outError = "malformed record";
+                return false;
+            }
+        }
+        if (!in.atEnd()) {
+            outRecords.clear();
+            (outParallel.clear(), ...);
+            outError = "trailing bytes after the last record";
+            return false;
+        }
+        return true;
+    }
+}
+
+uint32_t BinarySnapshot::crc32(const char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool BinarySnapshot::write(const std::string& filePath, const std::vector<User>& users,
+                           const std::vector<UserDetails>& details) {
+    if (users.size() != details.size()) {
+        return false;
+    }
+    return writeRecords(filePath, RecordKind::Users, users, details);
+}
+
+bool BinarySnapshot::write(const std::string& filePath, const std::vector<Wallet>& wallets) {
+    return writeRecords(filePath, RecordKind::Wallets, wallets);
+}
+
+bool BinarySnapshot::write(const std::string& filePath, const std::vector<Transaction>& transactions) {
+    return writeRecords(filePath, RecordKind::Transactions, transactions);
+}
+
+bool BinarySnapshot::read(const std::string& filePath, std::vector<User>& outRecords,
+                          std::vector<UserDetails>& outDetails, std::string& outError) {
+    return readRecords(filePath, RecordKind::Users, outError, outRecords, outDetails);
+}
+
+bool BinarySnapshot::read(const std::string& filePath, std::vector<Wallet>& outRecords, std::string& outError) {
+    return readRecords(filePath, RecordKind::Wallets, outError, outRecords);
+}
+
+bool BinarySnapshot::read(const std::string& filePath, std::vector<Transaction>& outRecords, std::string& outError) {
+    return readRecords(filePath, RecordKind::Transactions, outError, outRecords);
+}
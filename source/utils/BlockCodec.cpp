@@ -0,0 +1,207 @@
+// src/utils/BlockCodec.cpp
+#include "../../include/utils/BlockCodec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef REWARD_SYSTEM_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t MAX_OFFSET = 65535;
+    constexpr int HASH_BITS = 14;
+#ifdef REWARD_SYSTEM_HAS_ZSTD
+    constexpr int ZSTD_LEVEL = 6;
+#endif
+
+    uint32_t read32(const char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hashOf(uint32_t value) {
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    void putLength(std::string& out, size_t extra) {
+        while (extra >= 255) {
+            out.push_back(static_cast<char>(255));
+            extra -= 255;
+        }
+        out.push_back(static_cast<char>(extra));
+    }
+
+    void putSequence(std::string& out, const char* literals, size_t literalCount, size_t offset, size_t matchLength) {
+        const size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+        out.push_back(static_cast<char>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+        if (literalCount >= 15) {
+            putLength(out, literalCount - 15);
+        }
+        out.append(literals, literalCount);
+        if (matchLength == 0) {
+            return; // Final sequence
+        }
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (matchCode >= 15) {
+            putLength(out, matchCode - 15);
+        }
+    }
+
+    void compressBuiltin(const char* data, size_t size, std::string& out) {
+        out.clear();
+        out.reserve(size / 2 + 16);
+        std::vector<int64_t> table(size_t(1) << HASH_BITS, -1);
+        size_t anchor = 0;
+        size_t i = 0;
+        while (i + MIN_MATCH <= size) {
+            const uint32_t word = read32(data + i);
+            const uint32_t h = hashOf(word);
+            const int64_t candidate = table[h];
+            table[h] = static_cast<int64_t>(i);
+            if (candidate < 0 || i - static_cast<size_t>(candidate) > MAX_OFFSET ||
+                read32(data + candidate) != word) {
+                ++i;
+                continue;
+            }
+            size_t length = MIN_MATCH;
+            while (i + length < size && data[candidate + length] == data[i + length]) {
+                ++length;
+            }
+            putSequence(out, data + anchor, i - anchor, i - static_cast<size_t>(candidate), length);
+            i += length;
+            anchor = i;
+        }
+        putSequence(out, data + anchor, size - anchor, 0, 0);
+    }
+
+    bool readLength(const unsigned char*& in, const unsigned char* end, size_t& length) {
+        while (true) {
+            if (in == end) {
+                return false;
+            }
+            const unsigned char byte = *in++;
+            length += byte;
+            if (byte != 255) {
+                return true;
+            }
+        }
+    }
+
+    bool decompressBuiltin(const char* data, size_t size, size_t rawSize, std::string& out) {
+        out.clear();
+        out.reserve(rawSize);
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* end = in + size;
+        while (in < end) {
+            const unsigned char token = *in++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !readLength(in, end, literals)) {
+                return false;
+            }
+            if (literals > static_cast<size_t>(end - in) || out.size() + literals > rawSize) {
+                return false;
+            }
+            out.append(reinterpret_cast<const char*>(in), literals);
+            in += literals;
+            if (in == end) {
+                break; // Final sequence has no match
+            }
+            if (end - in < 2) {
+                return false;
+            }
+            const size_t offset = static_cast<size_t>(in[0]) | (static_cast<size_t>(in[1]) << 8);
+            in += 2;
+            size_t length = (token & 0x0F);
+            if (length == 15 && !readLength(in, end, length)) {
+                return false;
+            }
+            length += MIN_MATCH;
+            if (offset == 0 || offset > out.size() || out.size() + length > rawSize) {
+                return false;
+            }
+            // Byte by byte: a match may overlap the bytes it produces
+            size_t from = out.size() - offset;
+            for (size_t k = 0; k < length; ++k) {
+                out.push_back(out[from + k]);
+            }
+        }
+        return out.size() == rawSize;
+    }
+}
+
+CompressionCodec BlockCodec::preferred() {
+#ifdef REWARD_SYSTEM_HAS_ZSTD
+    return CompressionCodec::Zstd;
+#else
+    return CompressionCodec::BuiltinLz;
+#endif
+}
+
+bool BlockCodec::isSupported(CompressionCodec codec) {
+    switch (codec) {
+        case CompressionCodec::None:
+        case CompressionCodec::BuiltinLz:
+            return true;
+        case CompressionCodec::Zstd:
+#ifdef REWARD_SYSTEM_HAS_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+bool BlockCodec::compress(CompressionCodec codec, const char* data, size_t size, std::string& out) {
+    switch (codec) {
+        case CompressionCodec::None:
+            out.assign(data, size);
+            return true;
+        case CompressionCodec::BuiltinLz:
+            compressBuiltin(data, size, out);
+            return true;
+        case CompressionCodec::Zstd:
+#ifdef REWARD_SYSTEM_HAS_ZSTD
+        {
+            out.resize(ZSTD_compressBound(size));
+            const size_t written = ZSTD_compress(&out[0], out.size(), data, size, ZSTD_LEVEL);
+            if (ZSTD_isError(written)) {
+                return false;
+            }
+            out.resize(written);
+            return true;
+        }
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+bool BlockCodec::decompress(CompressionCodec codec, const char* data, size_t size, size_t rawSize, std::string& out) {
+    switch (codec) {
+        case CompressionCodec::None:
+            if (size != rawSize) {
+                return false;
+            }
+            out.assign(data, size);
+            return true;
+        case CompressionCodec::BuiltinLz:
+            return decompressBuiltin(data, size, rawSize, out);
+        case CompressionCodec::Zstd:
+#ifdef REWARD_SYSTEM_HAS_ZSTD
+        {
+            out.resize(rawSize);
+            const size_t read = ZSTD_decompress(&out[0], rawSize, data, size);
+            return !ZSTD_isError(read) && read == rawSize;
+        }
+#else
+            return false;
+#endif
+    }
+    return false;
+}
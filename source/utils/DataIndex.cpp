@@ -0,0 +1,255 @@
+// src/utils/DataIndex.cpp
+#include "utils/DataIndex.hpp"
+#include "Config.h"
+#include <algorithm>
+
+DataIndex::DataIndex(std::vector<User>& users_ref, std::vector<UserDetails>& details_ref,
+                     std::vector<Wallet>& wallets_ref, std::vector<Transaction>& transactions_ref)
+    : users(users_ref), userDetails(details_ref), wallets(wallets_ref), transactions(transactions_ref) {}
+
+void DataIndex::rebuild() {
+    rebuildUsersIndex();
+    rebuildWalletsIndex();
+    rebuildTransactionsIndex();
+}
+
+void DataIndex::rebuildUsers() {
+    rebuildUsersIndex();
+}
+
+void DataIndex::rebuildWallets() {
+    rebuildWalletsIndex();
+}
+
+void DataIndex::rebuildTransactions() {
+    rebuildTransactionsIndex();
+}
+
+void DataIndex::rebuildUsersIndex() const {
+    userIdIndex.clear();
+    usernameIndex.clear();
+    emailIndex.clear();
+    userIdIndex.reserve(users.size());
+    usernameIndex.reserve(users.size());
+    emailIndex.reserve(users.size());
+    indexedUserCount = 0;
+    syncUsers();
+}
+
+void DataIndex::rebuildWalletsIndex() const {
+    walletIdIndex.clear();
+    walletByUserIdIndex.clear();
+    walletIdIndex.reserve(wallets.size());
+    walletByUserIdIndex.reserve(wallets.size());
+    indexedWalletCount = 0;
+    syncWallets();
+}
+
+void DataIndex::rebuildTransactionsIndex() const {
+    transactionsByWallet.clear();
+    transactionIdIndex.clear();
+    transactionIdIndex.reserve(transactions.size());
+    indexedTransactionCount = 0;
+    syncTransactions();
+}
+
+void DataIndex::syncUsers() const {
+    // A user is indexed once both of its parts were appended
+    const size_t complete = std::min(users.size(), userDetails.size());
+    if (complete < indexedUserCount) {
+        rebuildUsersIndex(); // A rolled back insert removed indexed records
+        return;
+    }
+    // emplace keeps the first occurrence, matching the old find_if semantics
+    for (size_t i = indexedUserCount; i < complete; ++i) {
+        const User& u = users[i];
+        userIdIndex.emplace(u.userId, i);
+        usernameIndex.emplace(u.username, i);
+        if (!userDetails[i].email.empty()) {
+            emailIndex.emplace(userDetails[i].email, i);
+        }
+    }
+    indexedUserCount = complete;
+}
+
+void DataIndex::syncWallets() const {
+    if (wallets.size() < indexedWalletCount) {
+        rebuildWalletsIndex();
+        return;
+    }
+    for (size_t i = indexedWalletCount; i < wallets.size(); ++i) {
+        const Wallet& w = wallets[i];
+        walletIdIndex.emplace(w.walletId, i);
+        // The master wallet's shards share its ID as owner; they are nobody's wallet
+        if (w.userId.view() != AppConfig::MASTER_WALLET_ID) {
+            walletByUserIdIndex.emplace(w.userId, i);
+        }
+    }
+    indexedWalletCount = wallets.size();
+}
+
+void DataIndex::syncTransactions() const {
+    if (transactions.size() < indexedTransactionCount) {
+        rebuildTransactionsIndex();
+        return;
+    }
+    for (size_t i = indexedTransactionCount; i < transactions.size(); ++i) {
+        const Transaction& tx = transactions[i];
+        transactionIdIndex.emplace(tx.transactionId, i);
+        addPosting(tx.sourceWalletId, i);
+        if (tx.targetWalletId != tx.sourceWalletId) {
+            addPosting(tx.targetWalletId, i);
+        }
+    }
+    indexedTransactionCount = transactions.size();
+}
+
+void DataIndex::addPosting(const Identifier& walletId, size_t position) const {
+    std::vector<size_t>& postings = transactionsByWallet[walletId];
+    const time_t timestamp = transactions[position].timestamp;
+    // New transactions are almost always the newest, so this is normally a push_back
+    if (postings.empty() || transactions[postings.back()].timestamp <= timestamp) {
+        postings.push_back(position);
+        return;
+    }
+    auto insertAt = std::upper_bound(postings.begin(), postings.end(), timestamp,
+        [this](time_t ts, size_t pos) { return ts < transactions[pos].timestamp; });
+    postings.insert(insertAt, position);
+}
+
+template <typename Key, typename KeyAt>
+const User* DataIndex::lookupUser(std::unordered_map<Key, size_t>& index, const Key& key, KeyAt keyAt) const {
+    syncUsers();
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return nullptr;
+    }
+    if (it->second < indexedUserCount && keyAt(it->second) == key) {
+        return &users[it->second];
+    }
+    // The record at that position changed underneath us; rebuild once and retry
+    rebuildUsersIndex();
+    it = index.find(key);
+    if (it != index.end() && keyAt(it->second) == key) {
+        return &users[it->second];
+    }
+    return nullptr;
+}
+
+const Wallet* DataIndex::lookupWallet(std::unordered_map<Identifier, size_t>& index, const Identifier& key,
+                                      Identifier Wallet::* field) const {
+    syncWallets();
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return nullptr;
+    }
+    if (it->second < wallets.size() && wallets[it->second].*field == key) {
+        return &wallets[it->second];
+    }
+    rebuildWalletsIndex();
+    it = index.find(key);
+    if (it != index.end() && wallets[it->second].*field == key) {
+        return &wallets[it->second];
+    }
+    return nullptr;
+}
+
+// --- Users ---
+const User* DataIndex::findUserById(std::string_view userId) const {
+    const Identifier key = Identifier::find(userId);
+    return key.empty() ? nullptr : lookupUser(userIdIndex, key, [this](size_t i) { return users[i].userId; });
+}
+
+User* DataIndex::findUserById(std::string_view userId) {
+    return const_cast<User*>(static_cast<const DataIndex&>(*this).findUserById(userId));
+}
+
+const User* DataIndex::findUserByUsername(const std::string& username) const {
+    return lookupUser(usernameIndex, username, [this](size_t i) -> const std::string& { return users[i].username; });
+}
+
+User* DataIndex::findUserByUsername(const std::string& username) {
+    return const_cast<User*>(static_cast<const DataIndex&>(*this).findUserByUsername(username));
+}
+
+const User* DataIndex::findUserByEmail(const std::string& email) const {
+    return lookupUser(emailIndex, email, [this](size_t i) -> const std::string& { return userDetails[i].email; });
+}
+
+User* DataIndex::findUserByEmail(const std::string& email) {
+    return const_cast<User*>(static_cast<const DataIndex&>(*this).findUserByEmail(email));
+}
+
+const UserDetails* DataIndex::detailsOf(const User& user) const {
+    const User* indexed = lookupUser(userIdIndex, user.userId, [this](size_t i) { return users[i].userId; });
+    return indexed ? &userDetails[static_cast<size_t>(indexed - users.data())] : nullptr;
+}
+
+UserDetails* DataIndex::detailsOf(const User& user) {
+    return const_cast<UserDetails*>(static_cast<const DataIndex&>(*this).detailsOf(user));
+}
+
+void DataIndex::updateUserEmail(const std::string& oldEmail, const User& user) {
+    syncUsers();
+    auto pos = userIdIndex.find(user.userId);
+    if (pos == userIdIndex.end()) {
+        return;
+    }
+    auto old = emailIndex.find(oldEmail);
+    if (old != emailIndex.end() && old->second == pos->second) {
+        emailIndex.erase(old);
+    }
+    const std::string& newEmail = userDetails[pos->second].email;
+    if (!newEmail.empty()) {
+        emailIndex[newEmail] = pos->second;
+    }
+}
+
+// --- Wallets ---
+const Wallet* DataIndex::findWalletById(std::string_view walletId) const {
+    const Identifier key = Identifier::find(walletId);
+    return key.empty() ? nullptr : lookupWallet(walletIdIndex, key, &Wallet::walletId);
+}
+
+Wallet* DataIndex::findWalletById(std::string_view walletId) {
+    return const_cast<Wallet*>(static_cast<const DataIndex&>(*this).findWalletById(walletId));
+}
+
+const Wallet* DataIndex::findWalletByUserId(std::string_view userId) const {
+    const Identifier key = Identifier::find(userId);
+    return key.empty() ? nullptr : lookupWallet(walletByUserIdIndex, key, &Wallet::userId);
+}
+
+Wallet* DataIndex::findWalletByUserId(std::string_view userId) {
+    return const_cast<Wallet*>(static_cast<const DataIndex&>(*this).findWalletByUserId(userId));
+}
+
+// --- Transactions ---
+const std::vector<size_t>& DataIndex::transactionPositionsForWallet(std::string_view walletId) const {
+    static const std::vector<size_t> noPostings;
+    syncTransactions();
+    auto it = transactionsByWallet.find(Identifier::find(walletId));
+    return it != transactionsByWallet.end() ? it->second : noPostings;
+}
+
+const Transaction* DataIndex::findTransactionById(std::string_view transactionId) const {
+    const Identifier key = Identifier::find(transactionId);
+    if (key.empty()) {
+        return nullptr;
+    }
+    syncTransactions();
+    auto it = transactionIdIndex.find(key);
+    if (it == transactionIdIndex.end()) {
+        return nullptr;
+    }
+    if (it->second < transactions.size() && transactions[it->second].transactionId == it->first) {
+        return &transactions[it->second];
+    }
+    rebuildTransactionsIndex(); // Transactions were removed from the front without a rebuild
+    it = transactionIdIndex.find(key);
+    return it != transactionIdIndex.end() ? &transactions[it->second] : nullptr;
+}
+
+Transaction* DataIndex::findTransactionById(std::string_view transactionId) {
+    return const_cast<Transaction*>(static_cast<const DataIndex&>(*this).findTransactionById(transactionId));
+}
@@ -6,6 +6,9 @@
 namespace fs = std::filesystem;
 
 bool DataInitializer::createEmptyJsonFile(const std::string& filePath) {
+    if (fs::exists(filePath)) {
+        return true; // Keep existing data; the transaction journal is replayed on top of it
+    }
     std::ofstream file(filePath);
     if (file.is_open()) {
         file << "[]";
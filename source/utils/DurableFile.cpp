@@ -0,0 +1,130 @@
+// src/utils/DurableFile.cpp
+#include "../../include/utils/DurableFile.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define REWARD_SYSTEM_HAS_FSYNC 1
+#elif defined(_WIN32) || defined(_WIN64)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+#ifdef REWARD_SYSTEM_HAS_FSYNC
+    bool syncPath(const std::string& path, int flags) {
+        const int fd = ::open(path.c_str(), flags);
+        if (fd < 0) {
+            return false;
+        }
+        const bool synced = ::fsync(fd) == 0;
+        ::close(fd);
+        return synced;
+    }
+#endif
+
+    // Replaces `to` with `from`. On Windows the rename is written through, so it is durable when
+    // this returns and there is no directory to sync afterwards.
+    bool replaceFile(const std::string& from, const std::string& to, std::string& outError) {
+#if defined(_WIN32) || defined(_WIN64)
+        if (!::MoveFileExW(std::filesystem::path(from).c_str(), std::filesystem::path(to).c_str(),
+                           MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            outError = "Windows error " + std::to_string(::GetLastError());
+            return false;
+        }
+        return true;
+#else
+        std::error_code ec;
+        std::filesystem::rename(from, to, ec);
+        if (ec) {
+            outError = ec.message();
+            return false;
+        }
+        return true;
+#endif
+    }
+}
+
+bool DurableFile::syncFile(const std::string& path) {
+#ifdef REWARD_SYSTEM_HAS_FSYNC
+    return syncPath(path, O_RDONLY);
+#elif defined(_WIN32) || defined(_WIN64)
+    // FlushFileBuffers needs a handle with write access; the sharing flags let other handles stay open
+    const HANDLE file = ::CreateFileW(std::filesystem::path(path).c_str(), GENERIC_WRITE,
+                                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    const bool synced = ::FlushFileBuffers(file) != 0;
+    ::CloseHandle(file);
+    return synced;
+#else
+    (void)path;
+    return false; // Durability cannot be guaranteed here, so every save reports failure
+#endif
+}
+
+bool DurableFile::syncParentDirectory(const std::string& path) {
+#ifdef REWARD_SYSTEM_HAS_FSYNC
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    return syncPath(parent.empty() ? std::string(".") : parent.string(), O_RDONLY | O_DIRECTORY);
+#elif defined(_WIN32) || defined(_WIN64)
+    // NTFS journals its metadata: a new file or a rename done through replaceFile is already durable
+    (void)path;
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool DurableFile::writeAtomically(const std::string& path, const std::function<bool(std::ostream&)>& writeContents,
+                                  std::string& outError) {
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            outError = "cannot create " + tempPath;
+            return false;
+        }
+        if (!writeContents(out)) {
+            out.close();
+            std::remove(tempPath.c_str());
+            outError = "writing " + tempPath + " failed";
+            return false;
+        }
+        out.flush();
+        if (!out.good()) {
+            out.close();
+            std::remove(tempPath.c_str());
+            outError = "writing " + tempPath + " failed";
+            return false;
+        }
+    }
+    // The data must be on disk before the rename can expose it
+    if (!syncFile(tempPath)) {
+        std::remove(tempPath.c_str());
+        outError = "fsync of " + tempPath + " failed";
+        return false;
+    }
+    std::string renameError;
+    if (!replaceFile(tempPath, path, renameError)) {
+        std::remove(tempPath.c_str());
+        outError = "rename to " + path + " failed: " + renameError;
+        return false;
+    }
+    if (!syncParentDirectory(path)) {
+        outError = "fsync of the directory holding " + path + " failed";
+        return false; // The new contents are in place but the rename may not survive a crash yet
+    }
+    return true;
+}
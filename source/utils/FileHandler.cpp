@@ -1,9 +1,21 @@
 // src/utils/FileHandler.cpp
 #include "../../include/utils/FileHandler.hpp"
 #include "../../include/utils/Logger.hpp"
+#include "../../include/utils/BinarySnapshot.hpp"
+#include "../../include/utils/DurableFile.hpp"
+#include "../../include/utils/JsonStreamReader.hpp"
+#include "../../include/utils/JsonStreamWriter.hpp"
+#include "../../include/utils/TransactionArchive.hpp"
+#include "../../include/Config.h"
 #include <filesystem> // For std::filesystem::create_directories (C++17)
                       // If not C++17, you might need OS-specific directory creation or a library.
 #include <fstream>
+#include <future>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -38,6 +50,187 @@ bool createEmptyJsonFile(const std::string& filePath) {
     return false;
 }
 
+// --- Journal Helpers ---
+namespace {
+    // JSON snapshots are skipped only when binary snapshots take their place
+    constexpr bool WRITE_JSON_SNAPSHOTS = AppConfig::WRITE_JSON_SNAPSHOTS || !AppConfig::USE_BINARY_SNAPSHOTS;
+
+    constexpr int WRITE_AHEAD_LOG_VERSION = 1;
+
+    // Frames a record as "<length> <payload>\n" so a torn final write can be detected on replay
+    void writeFramedRecord(std::ostream& out, const json& record) {
+        const std::string payload = record.dump();
+        out << payload.size() << ' ' << payload << '\n';
+    }
+
+    // Parses one framed line. Returns false if the frame is incomplete or the length does not match.
+    bool parseFramedRecord(const std::string& line, json& outRecord) {
+        const size_t separator = line.find(' ');
+        if (separator == std::string::npos || separator == 0) {
+            return false;
+        }
+        size_t declaredLength = 0;
+        try {
+            declaredLength = std::stoull(line.substr(0, separator));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (line.size() - separator - 1 != declaredLength) {
+            return false;
+        }
+        outRecord = json::parse(line.begin() + separator + 1, line.end(), nullptr, false);
+        return !outRecord.is_discarded();
+    }
+
+    // Streams a JSON array file into records without building a DOM of the whole file.
+    // Elements that cannot be converted are skipped one by one and kept in "<file>.rejected"
+    // for inspection. outElementCount counts every element, accepted or not, so it can be
+    // matched against journal headers. Returns false on a syntax error (records is cleared).
+    template <typename T>
+    bool streamJsonRecords(std::istream& in, const std::string& filePath, std::vector<T>& records,
+                           size_t& outElementCount, const std::function<void(const json&)>& inspect = {}) {
+        outElementCount = 0;
+        size_t rejected = 0;
+        std::ofstream rejectedFile;
+        std::string error;
+        const bool parsed = JsonStreamReader::readArray(in,
+            [&](json& element) {
+                ++outElementCount;
+                try {
+                    T record = element.get<T>();
+                    if (inspect) {
+                        inspect(element); // Before the record is kept, so a throwing inspect rejects it
+                    }
+                    records.push_back(std::move(record));
+                } catch (const std::exception& e) {
+                    ++rejected;
+                    if (!rejectedFile.is_open()) {
+                        rejectedFile.open(filePath + ".rejected", std::ios::out | std::ios::app);
+                    }
+                    rejectedFile << element.dump() << '\n';
+                    LOG_DEBUG("Rejected record #" + std::to_string(outElementCount) + " in " + filePath + ": " + e.what());
+                }
+            },
+            error);
+        if (!parsed) {
+            records.clear();
+            LOG_ERROR("JSON parse error in " + filePath + ": " + error);
+            return false;
+        }
+        if (rejected > 0) {
+            LOG_WARNING("Skipped " + std::to_string(rejected) + " malformed records in " + filePath +
+                        ", saved to " + filePath + ".rejected");
+        }
+        return true;
+    }
+
+    // users.json object of an account: both of its parts in one flat object
+    json userRecord(const User& user, const UserDetails& details) {
+        json record = user;
+        record.update(json(details));
+        return record;
+    }
+}
+
+bool FileHandler::resetWriteAheadLog() {
+    ensureDirectoryExists(writeAheadLogPath);
+    std::string error;
+    const bool written = DurableFile::writeAtomically(writeAheadLogPath, [](std::ostream& file) {
+        writeFramedRecord(file, json{{"walVersion", WRITE_AHEAD_LOG_VERSION}});
+        return file.good();
+    }, error);
+    if (!written) {
+        LOG_ERROR("Could not reset write-ahead log: " + error);
+        return false;
+    }
+    return true;
+}
+
+bool FileHandler::appendJournalRecords(const std::string& journalPath, const std::vector<json>& records) {
+    if (records.empty()) {
+        return true;
+    }
+    std::error_code ec;
+    const std::uintmax_t sizeBefore =
+        std::filesystem::exists(journalPath, ec) ? std::filesystem::file_size(journalPath, ec) : 0;
+    if (ec) {
+        LOG_ERROR("Could not read the size of journal " + journalPath + ": " + ec.message());
+        return false;
+    }
+    // Replay stops at the first torn record, so a partial append would hide every later one
+    auto discardAppended = [&journalPath, sizeBefore]() {
+        std::error_code resizeError;
+        std::filesystem::resize_file(journalPath, sizeBefore, resizeError);
+        if (resizeError) {
+            LOG_ERROR("Could not cut a failed append off journal " + journalPath + ": " + resizeError.message());
+        }
+    };
+    {
+        std::ofstream file(journalPath, std::ios::out | std::ios::app);
+        if (!file.is_open()) {
+            LOG_ERROR("Could not open journal for appending: " + journalPath);
+            return false;
+        }
+        for (const auto& record : records) {
+            writeFramedRecord(file, record);
+        }
+        file.flush(); // Each commit must reach the OS before the caller reports success
+        if (!file.good()) {
+            file.close();
+            discardAppended();
+            return false;
+        }
+    }
+    // ...and stable storage
+    if (AppConfig::SYNC_JOURNAL_APPENDS && !DurableFile::syncFile(journalPath)) {
+        LOG_ERROR("Could not sync journal to disk: " + journalPath);
+        discardAppended(); // The caller reports the commit as failed, so it must not be replayed
+        return false;
+    }
+    return true;
+}
+
+bool FileHandler::replayJournal(const std::string& journalPath, size_t expectedBaseCount,
+                                const std::function<void(const json&)>& applyRecord, size_t& outApplied) {
+    outApplied = 0;
+    std::ifstream file(journalPath);
+    if (!file.is_open()) {
+        return false; // No journal yet
+    }
+
+    std::string line;
+    json record;
+    if (!std::getline(file, line) || !parseFramedRecord(line, record) || !record.contains("journalBase")) {
+        LOG_WARNING("Journal has no valid header, ignoring it: " + journalPath);
+        return false;
+    }
+    if (record["journalBase"].get<size_t>() != expectedBaseCount) {
+        // The snapshot was rewritten after this journal was started (e.g. crash during compaction),
+        // so its records are already part of the snapshot.
+        LOG_WARNING("Journal does not match the current snapshot, ignoring it: " + journalPath);
+        return false;
+    }
+
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (!parseFramedRecord(line, record)) {
+            LOG_WARNING("Torn record found in journal " + journalPath + " after " +
+                        std::to_string(outApplied) + " records, discarding the tail");
+            return false;
+        }
+        try {
+            applyRecord(record);
+        } catch (const std::exception& e) {
+            LOG_WARNING("Invalid record in journal " + journalPath + ": " + std::string(e.what()));
+            return false;
+        }
+        ++outApplied;
+    }
+    return true;
+}
+
 FileHandler::FileHandler(const std::string& dataDir) {
     // Use the provided data directory or default to "data/"
     std::string baseDir = dataDir;
@@ -48,6 +241,12 @@ FileHandler::FileHandler(const std::string& dataDir) {
     usersFilePath = baseDir + "users.json";
     walletsFilePath = baseDir + "wallets.json";
     transactionsFilePath = baseDir + "transactions.json";
+    writeAheadLogPath = baseDir + AppConfig::WRITE_AHEAD_LOG_FILENAME;
+    legacyWalletsJournalPath = baseDir + AppConfig::LEGACY_WALLETS_JOURNAL_FILENAME;
+    legacyTransactionsJournalPath = baseDir + AppConfig::LEGACY_TRANSACTIONS_JOURNAL_FILENAME;
+    usersBinaryPath = baseDir + "users" + AppConfig::BINARY_SNAPSHOT_EXTENSION;
+    walletsBinaryPath = baseDir + "wallets" + AppConfig::BINARY_SNAPSHOT_EXTENSION;
+    transactionsBinaryPath = baseDir + "transactions" + AppConfig::BINARY_SNAPSHOT_EXTENSION;
 
     // Get absolute paths for logging
     std::filesystem::path absUsersPath = std::filesystem::absolute(usersFilePath);
@@ -63,11 +262,187 @@ FileHandler::FileHandler(const std::string& dataDir) {
     ensureDirectoryExists(usersFilePath);
     ensureDirectoryExists(walletsFilePath);
     ensureDirectoryExists(transactionsFilePath);
+
+    writerThread = std::thread(&FileHandler::writerLoop, this);
+}
+
+FileHandler::~FileHandler() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    workQueued.notify_one();
+    if (writerThread.joinable()) {
+        writerThread.join(); // The writer drains the queue before it exits
+    }
+}
+
+// --- Write-behind queue ---
+uint64_t FileHandler::submitLocked() {
+    ++queuedTicket;
+    workQueued.notify_one();
+    return queuedTicket;
+}
+
+bool FileHandler::awaitWrite(uint64_t ticket, PersistStream stream, Durability durability) {
+    if (durability == Durability::Enqueue) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(queueMutex);
+    batchWritten.wait(lock, [&] { return writtenTicket >= ticket; });
+    // The batch that held this ticket is the first one ending at or after it
+    auto failed = failedBatches.lower_bound(ticket);
+    return failed == failedBatches.end() || failed->second.first > ticket || !(failed->second.second & stream);
+}
+
+void FileHandler::flush() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    const uint64_t target = queuedTicket;
+    batchWritten.wait(lock, [&] { return writtenTicket >= target; });
+}
+
+void FileHandler::writerLoop() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        workQueued.wait(lock, [this] { return stopping || writtenTicket < queuedTicket; });
+        if (writtenTicket == queuedTicket) {
+            return; // Stopping and nothing left to write
+        }
+        PendingWrites batch = std::move(pending);
+        pending = PendingWrites();
+        const uint64_t firstTicket = writtenTicket + 1;
+        const uint64_t lastTicket = queuedTicket;
+        const bool appendsBlocked = logAppendsBlocked;
+        lock.unlock();
+
+        const unsigned failedStreams = writeBatch(batch, appendsBlocked);
+
+        lock.lock();
+        if (failedStreams != 0) {
+            failedBatches[lastTicket] = {firstTicket, failedStreams};
+            if (failedBatches.size() > 64) {
+                failedBatches.erase(failedBatches.begin());
+            }
+            // The files on disk no longer match what was queued; force a checkpoint on the next commit
+            // and fail the commits already queued behind this batch until it has run
+            if (failedStreams & WALLET_DATA_STREAM) {
+                persistedWalletCount = std::numeric_limits<size_t>::max();
+                logAppendsBlocked = true;
+            }
+        }
+        if (!(failedStreams & WALLET_DATA_STREAM) && batch.checkpointWallets) {
+            logAppendsBlocked = false;
+        }
+        writtenTicket = lastTicket;
+        batchWritten.notify_all();
+    }
+}
+
+unsigned FileHandler::writeBatch(PendingWrites& batch, bool appendsBlocked) {
+    unsigned failedStreams = 0;
+
+    if (batch.users) {
+        const bool written = (!WRITE_JSON_SNAPSHOTS || writeUsersJson(*batch.users, *batch.userDetails)) &&
+                             writeBinarySnapshot(usersBinaryPath, *batch.users, *batch.userDetails);
+        if (!written) {
+            LOG_ERROR("Failed to save " + std::to_string(batch.users->size()) + " users");
+            failedStreams |= USERS_STREAM;
+        }
+    }
+
+    if (batch.checkpointWallets) {
+        // Each snapshot is replaced atomically and replaying the old log over either of them is
+        // harmless, so a crash anywhere in here loses nothing
+        const bool written = writeTransactionsSnapshot(*batch.checkpointTransactions) &&
+                             writeWalletsSnapshot(*batch.checkpointWallets) &&
+                             (!AppConfig::USE_WRITE_AHEAD_LOG || resetWriteAheadLog());
+        if (!written) {
+            LOG_ERROR("Checkpoint of wallet data failed");
+            failedStreams |= WALLET_DATA_STREAM; // Commits queued after it must not be appended either
+        } else {
+            std::error_code ec; // The legacy journals are part of the snapshots now
+            std::filesystem::remove(legacyWalletsJournalPath, ec);
+            std::filesystem::remove(legacyTransactionsJournalPath, ec);
+        }
+    }
+    if (!(failedStreams & WALLET_DATA_STREAM) &&
+        (!batch.walletUpdates.empty() || !batch.transactionAppends.empty() || !batch.transactionUpdates.empty())) {
+        if (appendsBlocked && !batch.checkpointWallets) {
+            LOG_ERROR("Write-ahead log append skipped: an earlier wallet data write failed and no checkpoint has run since");
+            return failedStreams | WALLET_DATA_STREAM;
+        }
+        try {
+            json record = json::object();
+            if (!batch.walletUpdates.empty()) {
+                record["wallets"] = batch.walletUpdates;
+            }
+            if (!batch.transactionAppends.empty()) {
+                record["transactions"] = batch.transactionAppends;
+            }
+            if (!batch.transactionUpdates.empty()) {
+                record["transactionUpdates"] = batch.transactionUpdates;
+            }
+            if (!appendJournalRecords(writeAheadLogPath, {record})) {
+                LOG_ERROR("Failed to append " + std::to_string(batch.walletUpdates.size()) + " wallets and " +
+                          std::to_string(batch.transactionAppends.size()) + " transactions to the write-ahead log");
+                failedStreams |= WALLET_DATA_STREAM;
+            }
+        } catch (json::type_error& e) {
+            LOG_ERROR("JSON type error saving wallet data: " + std::string(e.what()));
+            failedStreams |= WALLET_DATA_STREAM;
+        }
+    }
+    return failedStreams;
+}
+
+template <typename T, typename... Parallel>
+bool FileHandler::loadBinarySnapshot(const std::string& binaryPath, const std::string& jsonPath, std::vector<T>& records,
+                                     std::vector<Parallel>&... parallel) {
+    std::error_code ec;
+    if (!std::filesystem::exists(binaryPath, ec)) {
+        return false;
+    }
+    // The JSON file is always written before the binary one, so a newer JSON file
+    // was edited or restored by hand and wins.
+    const auto binaryTime = std::filesystem::last_write_time(binaryPath, ec);
+    if (!ec && std::filesystem::exists(jsonPath, ec)) {
+        const auto jsonTime = std::filesystem::last_write_time(jsonPath, ec);
+        if (!ec && jsonTime > binaryTime) {
+            LOG_INFO("JSON file is newer than its binary snapshot, loading " + jsonPath);
+            return false;
+        }
+    }
+    std::string error;
+    if (!BinarySnapshot::read(binaryPath, records, parallel..., error)) {
+        LOG_WARNING("Ignoring binary snapshot " + binaryPath + ": " + error);
+        return false;
+    }
+    LOG_DEBUG("Loaded " + std::to_string(records.size()) + " records from binary snapshot " + binaryPath);
+    return true;
+}
+
+template <typename T, typename... Parallel>
+bool FileHandler::writeBinarySnapshot(const std::string& binaryPath, const std::vector<T>& records,
+                                      const std::vector<Parallel>&... parallel) {
+    if (!AppConfig::USE_BINARY_SNAPSHOTS) {
+        return true;
+    }
+    ensureDirectoryExists(binaryPath);
+    if (!BinarySnapshot::write(binaryPath, records, parallel...)) {
+        LOG_ERROR("Failed to write binary snapshot: " + binaryPath);
+        return false;
+    }
+    return true;
 }
 
 // --- User Data ---
-bool FileHandler::loadUsers(std::vector<User>& users) {
+bool FileHandler::loadUsers(std::vector<User>& users, std::vector<UserDetails>& details) {
     users.clear();
+    details.clear();
+    if (AppConfig::USE_BINARY_SNAPSHOTS && loadBinarySnapshot(usersBinaryPath, usersFilePath, users, details)) {
+        return true;
+    }
+
     std::ifstream file(usersFilePath);
     if (!file.is_open()) {
         // If file doesn't exist, create it with an empty array
@@ -78,47 +453,50 @@ bool FileHandler::loadUsers(std::vector<User>& users) {
         return true; // Not an error if file simply doesn't exist yet
     }
 
-    try {
-        json j;
-        file >> j; 
-        
-        if (j.is_array()) {
-            users = j.get<std::vector<User>>();
-        } else if (j.is_null()) {
-            // Empty file is not an error
-            LOG_INFO("Users file is empty or contains null");
-        } else {
-            LOG_ERROR("Users file does not contain a valid JSON array");
-            return false;
-        }
-    } catch (json::parse_error& e) {
-        LOG_ERROR("JSON parse error in users file: " + std::string(e.what()));
-        return false;
-    } catch (json::type_error& e) {
-        LOG_ERROR("JSON type error in users file: " + std::string(e.what()));
-        return false;
-    } catch (std::exception& e) {
-        LOG_ERROR("Error loading users: " + std::string(e.what()));
+    size_t elementCount = 0;
+    // Each object holds both parts of an account; the details are split off as the user is read
+    if (!streamJsonRecords(file, usersFilePath, users, elementCount,
+            [&details](const json& record) { details.push_back(record.get<UserDetails>()); })) {
+        details.clear();
         return false;
     }
     file.close();
+    for (size_t i = 0; i < users.size(); ++i) {
+        users[i].otpEnabled = !details[i].otpSecretKey.empty();
+    }
+    if (!users.empty()) {
+        writeBinarySnapshot(usersBinaryPath, users, details); // Next start reads the binary snapshot
+    }
     return true;
 }
 
-bool FileHandler::saveUsers(const std::vector<User>& users) {
+bool FileHandler::saveUsers(const std::vector<User>& users, const std::vector<UserDetails>& details,
+                            Durability durability) {
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        pending.users = users; // Replaces an older snapshot that has not been written yet
+        pending.userDetails = details;
+        ticket = submitLocked();
+    }
+    return awaitWrite(ticket, USERS_STREAM, durability);
+}
+
+bool FileHandler::writeUsersJson(const std::vector<User>& users, const std::vector<UserDetails>& details) {
     try {
         ensureDirectoryExists(usersFilePath);
-        json j = users; // Serialize users to JSON
-        
-        std::ofstream file(usersFilePath, std::ios::out | std::ios::trunc);
-        if (!file.is_open()) {
-            LOG_ERROR("Failed to open users file for writing");
+        std::string error;
+        const bool written = DurableFile::writeAtomically(usersFilePath, [&](std::ostream& file) {
+            JsonStreamWriter writer(file, !AppConfig::COMPACT_JSON_SNAPSHOTS); // Serialize users record by record
+            for (size_t i = 0; i < users.size(); ++i) {
+                writer.add(userRecord(users[i], details[i]));
+            }
+            return writer.finish();
+        }, error);
+        if (!written) {
+            LOG_ERROR("Failed to write users file: " + error);
             return false;
         }
-        
-        file << j.dump(4); // Pretty print JSON
-        file.flush(); // Ensure data is written to disk
-        file.close();
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Error saving users: " + std::string(e.what()));
@@ -127,127 +505,456 @@ bool FileHandler::saveUsers(const std::vector<User>& users) {
 }
 
 // --- Wallet Data ---
-bool FileHandler::loadWallets(std::vector<Wallet>& wallets) {
+bool FileHandler::loadWalletsSnapshot(std::vector<Wallet>& wallets, bool& outNeedsCheckpoint) {
     wallets.clear();
-    std::ifstream file(walletsFilePath);
-    if (!file.is_open()) {
-        // If file doesn't exist, create it with an empty array
-        ensureDirectoryExists(walletsFilePath);
-        if (!createEmptyJsonFile(walletsFilePath)) {
-            return false;
+    bool legacyAmounts = false; // Pre-fixed-point file storing balances as doubles
+
+    // Without a usable binary snapshot the data is checkpointed once after loading,
+    // which writes a fresh one for the next start.
+    const bool fromBinary = AppConfig::USE_BINARY_SNAPSHOTS &&
+                            loadBinarySnapshot(walletsBinaryPath, walletsFilePath, wallets);
+    size_t snapshotCount = wallets.size(); // Records in the snapshot file, including rejected ones
+    if (!fromBinary) {
+        std::ifstream file(walletsFilePath);
+        if (!file.is_open()) {
+            // If file doesn't exist, create it with an empty array
+            ensureDirectoryExists(walletsFilePath);
+            if (!createEmptyJsonFile(walletsFilePath)) {
+                return false;
+            }
+            LOG_INFO("Created new empty wallets file");
+        } else {
+            if (!streamJsonRecords(file, walletsFilePath, wallets, snapshotCount,
+                    [&legacyAmounts](const json& record) {
+                        legacyAmounts = legacyAmounts || !record.contains("balanceMinor");
+                    })) {
+                return false;
+            }
+            file.close();
         }
-        LOG_INFO("Created new empty wallets file");
-        return true;
     }
+    if (legacyAmounts) {
+        LOG_INFO("Migrating wallets file to fixed-point balances");
+    }
+    // Rejected records were dropped; the rewrite makes the snapshot match memory again
+    outNeedsCheckpoint = outNeedsCheckpoint || legacyAmounts || snapshotCount != wallets.size() ||
+                         (AppConfig::USE_BINARY_SNAPSHOTS && !fromBinary);
 
-    try {
-        json j;
-        file >> j;
-        if (j.is_array()) {
-            wallets = j.get<std::vector<Wallet>>();
-        } else if (j.is_null()) {
-            LOG_INFO("Wallets file is empty or contains null");
-        } else {
-            LOG_ERROR("Wallets file does not contain a valid JSON array");
-            return false;
+    // A delta log from an older version: each record is the full latest state of one wallet
+    if (std::filesystem::exists(legacyWalletsJournalPath)) {
+        std::unordered_map<Identifier, size_t> positions;
+        positions.reserve(wallets.size());
+        for (size_t i = 0; i < wallets.size(); ++i) {
+            positions[wallets[i].walletId] = i;
         }
-    } catch (json::parse_error& e) {
-        LOG_ERROR("JSON parse error in wallets file: " + std::string(e.what()));
-        return false;
-    } catch (json::type_error& e) {
-        LOG_ERROR("JSON type error in wallets file: " + std::string(e.what()));
-        return false;
-    } catch (std::exception& e) {
-        LOG_ERROR("Error loading wallets: " + std::string(e.what()));
-        return false;
+        size_t replayed = 0;
+        replayJournal(legacyWalletsJournalPath, snapshotCount,
+            [&wallets, &positions](const json& record) {
+                Wallet w = record.get<Wallet>();
+                auto it = positions.find(w.walletId);
+                if (it != positions.end()) {
+                    wallets[it->second] = std::move(w);
+                } else {
+                    positions.emplace(w.walletId, wallets.size());
+                    wallets.push_back(std::move(w));
+                }
+            },
+            replayed);
+        LOG_INFO("Replayed " + std::to_string(replayed) + " wallet updates from legacy delta log");
+        outNeedsCheckpoint = true;
     }
-    file.close();
     return true;
 }
 
-bool FileHandler::saveWallets(const std::vector<Wallet>& wallets) {
-    ensureDirectoryExists(walletsFilePath);
-    std::ofstream file(walletsFilePath);
-    if (!file.is_open()) {
-        std::cerr << "[FileHandler] ERROR: Could not open wallets file for writing: " << walletsFilePath << std::endl;
+bool FileHandler::writeWalletsSnapshot(const std::vector<Wallet>& wallets) {
+    if (WRITE_JSON_SNAPSHOTS && !writeWalletsJson(wallets)) {
         return false;
     }
+    return writeBinarySnapshot(walletsBinaryPath, wallets);
+}
+
+bool FileHandler::writeWalletsJson(const std::vector<Wallet>& wallets) {
+    ensureDirectoryExists(walletsFilePath);
+    std::string error;
     try {
-        json j = wallets;
-        file << j.dump(4);
+        const bool written = DurableFile::writeAtomically(walletsFilePath, [&](std::ostream& file) {
+            JsonStreamWriter writer(file, !AppConfig::COMPACT_JSON_SNAPSHOTS);
+            writer.addAll(wallets);
+            return writer.finish();
+        }, error);
+        if (!written) {
+            LOG_ERROR("Failed to write wallets file: " + error);
+            return false;
+        }
     } catch (json::type_error& e) {
-        std::cerr << "[FileHandler] ERROR: JSON type error saving wallets: " << e.what() << std::endl;
-        file.close();
+        LOG_ERROR("JSON type error saving wallets: " + std::string(e.what()));
         return false;
     } catch (std::exception& e) {
-        std::cerr << "[FileHandler] ERROR: Generic error saving wallets: " << e.what() << std::endl;
-        file.close();
+        LOG_ERROR("Generic error saving wallets: " + std::string(e.what()));
         return false;
     }
-    file.close();
     return true;
 }
 
+void FileHandler::markWalletDirty(size_t position) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    dirtyWalletPositions.push_back(position);
+}
+
+void FileHandler::markTransactionUpdated(const Transaction& transaction) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    updatedTransactions.push_back(transaction);
+}
+
 // --- Transaction Data ---
-bool FileHandler::loadTransactions(std::vector<Transaction>& transactions) {
+bool FileHandler::loadTransactionsSnapshot(std::vector<Transaction>& transactions, bool& outNeedsCheckpoint) {
     transactions.clear();
-    std::ifstream file(transactionsFilePath);
-    if (!file.is_open()) {
-        // If file doesn't exist, create it with an empty array
-        ensureDirectoryExists(transactionsFilePath);
-        if (!createEmptyJsonFile(transactionsFilePath)) {
-            return false;
+    bool legacyAmounts = false; // Pre-fixed-point file storing amounts as doubles
+    bool legacyDescriptions = false; // Descriptions stored as text instead of template arguments
+
+    const bool fromBinary = AppConfig::USE_BINARY_SNAPSHOTS &&
+                            loadBinarySnapshot(transactionsBinaryPath, transactionsFilePath, transactions);
+    size_t snapshotCount = transactions.size(); // Records in the snapshot file, including rejected ones
+    if (!fromBinary) {
+        std::ifstream file(transactionsFilePath);
+        if (!file.is_open()) {
+            // If file doesn't exist, create it with an empty array
+            ensureDirectoryExists(transactionsFilePath);
+            if (!createEmptyJsonFile(transactionsFilePath)) {
+                return false;
+            }
+            LOG_INFO("Created new empty transactions file");
+        } else {
+            if (!streamJsonRecords(file, transactionsFilePath, transactions, snapshotCount,
+                    [&legacyAmounts, &legacyDescriptions](const json& record) {
+                        legacyAmounts = legacyAmounts || !record.contains("amountMinor");
+                        legacyDescriptions = legacyDescriptions || !record.contains("reason");
+                    })) {
+                return false;
+            }
+            file.close();
         }
-        LOG_INFO("Created new empty transactions file");
-        return true;
     }
+    if (legacyAmounts) {
+        LOG_INFO("Migrating transactions file to fixed-point amounts");
+    }
+    outNeedsCheckpoint = outNeedsCheckpoint || legacyAmounts || legacyDescriptions || snapshotCount != transactions.size() ||
+                         (AppConfig::USE_BINARY_SNAPSHOTS && !fromBinary);
+
+    // A journal from an older version extending the snapshot
+    if (std::filesystem::exists(legacyTransactionsJournalPath)) {
+        size_t replayed = 0;
+        replayJournal(legacyTransactionsJournalPath, snapshotCount,
+            [&transactions](const json& record) { transactions.push_back(record.get<Transaction>()); },
+            replayed);
+        LOG_INFO("Replayed " + std::to_string(replayed) + " transactions from legacy journal");
+        outNeedsCheckpoint = true;
+    }
+    return true;
+}
+
+bool FileHandler::writeTransactionsSnapshot(const std::vector<Transaction>& transactions) {
+    if (WRITE_JSON_SNAPSHOTS && !writeTransactionsJson(transactions)) {
+        return false;
+    }
+    return writeBinarySnapshot(transactionsBinaryPath, transactions);
+}
 
+bool FileHandler::writeTransactionsJson(const std::vector<Transaction>& transactions) {
+    ensureDirectoryExists(transactionsFilePath);
+    std::string error;
     try {
-        json j;
-        file >> j;
-        if (j.is_array()) {
-            transactions = j.get<std::vector<Transaction>>();
-        } else if (j.is_null()) {
-            LOG_INFO("Transactions file is empty or contains null");
-        } else {
-            LOG_ERROR("Transactions file does not contain a valid JSON array");
+        const bool written = DurableFile::writeAtomically(transactionsFilePath, [&](std::ostream& file) {
+            JsonStreamWriter writer(file, !AppConfig::COMPACT_JSON_SNAPSHOTS);
+            writer.addAll(transactions);
+            return writer.finish(); // Also flushes
+        }, error);
+        if (!written) {
+            LOG_ERROR("Failed to write transactions file: " + error);
             return false;
         }
-    } catch (json::parse_error& e) {
-        LOG_ERROR("JSON parse error in transactions file: " + std::string(e.what()));
-        return false;
+        LOG_INFO("Successfully saved " + std::to_string(transactions.size()) + " transactions to file");
+        return true;
     } catch (json::type_error& e) {
-        LOG_ERROR("JSON type error in transactions file: " + std::string(e.what()));
+        LOG_ERROR("JSON type error saving transactions: " + std::string(e.what()));
         return false;
     } catch (std::exception& e) {
-        LOG_ERROR("Error loading transactions: " + std::string(e.what()));
+        LOG_ERROR("Generic error saving transactions: " + std::string(e.what()));
         return false;
     }
-    file.close();
-    return true;
 }
 
-bool FileHandler::saveTransactions(const std::vector<Transaction>& transactions) {
-    ensureDirectoryExists(transactionsFilePath);
-    std::ofstream file(transactionsFilePath, std::ios::out | std::ios::trunc);
+// --- Write-Ahead Log ---
+bool FileHandler::replayWriteAheadLog(std::vector<Wallet>& wallets, std::vector<Transaction>& transactions,
+                                      size_t& outApplied, size_t& outEntries) {
+    outApplied = 0;
+    outEntries = 0;
+    std::ifstream file(writeAheadLogPath);
     if (!file.is_open()) {
-        LOG_ERROR("Could not open transactions file for writing: " + transactionsFilePath);
+        return false; // No log yet
+    }
+
+    std::string line;
+    json record;
+    if (!std::getline(file, line) || !parseFramedRecord(line, record) ||
+        record.value("walVersion", 0) != WRITE_AHEAD_LOG_VERSION) {
+        LOG_WARNING("Write-ahead log has no valid header, ignoring it: " + writeAheadLogPath);
+        return false;
+    }
+
+    // Built on the first commit only; an empty log costs nothing
+    std::unordered_map<Identifier, size_t> walletPositions;
+    std::unordered_map<Identifier, size_t> transactionPositions;
+    bool indexed = false;
+
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<Wallet> commitWallets;
+        std::vector<Transaction> commitTransactions;
+        std::vector<Transaction> commitTransactionUpdates;
+        // A commit is decoded completely before any of it is applied
+        try {
+            if (!parseFramedRecord(line, record)) {
+                throw std::runtime_error("torn record");
+            }
+            if (record.contains("wallets")) {
+                commitWallets = record["wallets"].get<std::vector<Wallet>>();
+            }
+            if (record.contains("transactions")) {
+                commitTransactions = record["transactions"].get<std::vector<Transaction>>();
+            }
+            if (record.contains("transactionUpdates")) {
+                commitTransactionUpdates = record["transactionUpdates"].get<std::vector<Transaction>>();
+            }
+        } catch (const std::exception& e) {
+            LOG_WARNING("Write-ahead log is damaged after " + std::to_string(outApplied) +
+                        " commits (" + e.what() + "), discarding the tail");
+            return false;
+        }
+
+        if (!indexed) {
+            walletPositions.reserve(wallets.size());
+            for (size_t i = 0; i < wallets.size(); ++i) {
+                walletPositions[wallets[i].walletId] = i;
+            }
+            transactionPositions.reserve(transactions.size());
+            for (size_t i = 0; i < transactions.size(); ++i) {
+                transactionPositions.emplace(transactions[i].transactionId, i);
+            }
+            indexed = true;
+        }
+        for (auto& wallet : commitWallets) {
+            auto it = walletPositions.find(wallet.walletId);
+            if (it != walletPositions.end()) {
+                wallets[it->second] = std::move(wallet);
+            } else {
+                walletPositions.emplace(wallet.walletId, wallets.size());
+                wallets.push_back(std::move(wallet));
+            }
+        }
+        for (auto& tx : commitTransactions) {
+            // Present when the snapshot was written by a checkpoint that crashed before resetting the log
+            if (transactionPositions.emplace(tx.transactionId, transactions.size()).second) {
+                transactions.push_back(std::move(tx));
+            }
+        }
+        // After the appends: a transaction may be added and changed within one coalesced record
+        for (auto& tx : commitTransactionUpdates) {
+            auto it = transactionPositions.find(tx.transactionId);
+            if (it != transactionPositions.end()) {
+                transactions[it->second] = std::move(tx);
+            } else {
+                transactionPositions.emplace(tx.transactionId, transactions.size());
+                transactions.push_back(std::move(tx));
+            }
+        }
+        outEntries += commitWallets.size() + commitTransactions.size() + commitTransactionUpdates.size();
+        ++outApplied;
+    }
+    return true;
+}
+
+bool FileHandler::loadWalletData(std::vector<Wallet>& wallets, std::vector<Transaction>& transactions) {
+    // The two snapshots are independent files, so the transactions (usually the larger one) are
+    // parsed on a second thread while this one reads the wallets
+    bool walletsNeedCheckpoint = false;
+    bool transactionsNeedCheckpoint = false;
+    auto transactionsLoaded = std::async(std::launch::async, [this, &transactions, &transactionsNeedCheckpoint] {
+        return loadTransactionsSnapshot(transactions, transactionsNeedCheckpoint);
+    });
+    const bool walletsLoaded = loadWalletsSnapshot(wallets, walletsNeedCheckpoint);
+    if (!transactionsLoaded.get() || !walletsLoaded) {
+        return false;
+    }
+    bool needsCheckpoint = walletsNeedCheckpoint || transactionsNeedCheckpoint;
+
+    const size_t snapshotEntries = wallets.size() + transactions.size();
+    size_t replayedEntries = 0;
+    if (AppConfig::USE_WRITE_AHEAD_LOG) {
+        size_t replayed = 0;
+        // A missing, stale or damaged log is replaced by a checkpoint so new commits
+        // are never appended behind unreadable records
+        if (!replayWriteAheadLog(wallets, transactions, replayed, replayedEntries)) {
+            needsCheckpoint = true;
+        }
+        if (replayed > 0) {
+            LOG_INFO("Recovered " + std::to_string(replayed) + " commits from the write-ahead log");
+        }
+    }
+
+    if (needsCheckpoint) {
+        return checkpoint(wallets, transactions);
+    }
+    std::lock_guard<std::mutex> lock(queueMutex);
+    dirtyWalletPositions.clear();
+    persistedWalletCount = wallets.size();
+    persistedTransactionCount = transactions.size();
+    logEntries = replayedEntries;
+    checkpointEntries = snapshotEntries;
+    return true;
+}
+
+void FileHandler::queueCheckpointLocked(const std::vector<Wallet>& wallets, const std::vector<Transaction>& transactions) {
+    // Contains every commit queued before it
+    pending.checkpointWallets = wallets;
+    pending.checkpointTransactions = transactions;
+    pending.walletUpdates.clear();
+    pending.walletUpdateIndex.clear();
+    pending.transactionAppends.clear();
+    pending.transactionUpdates.clear();
+    dirtyWalletPositions.clear();
+    updatedTransactions.clear();
+    persistedWalletCount = wallets.size();
+    persistedTransactionCount = transactions.size();
+    logEntries = 0;
+    checkpointEntries = wallets.size() + transactions.size();
+}
+
+bool FileHandler::checkpoint(const std::vector<Wallet>& wallets, const std::vector<Transaction>& transactions) {
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queueCheckpointLocked(wallets, transactions);
+        ticket = submitLocked();
+    }
+    return awaitWrite(ticket, WALLET_DATA_STREAM, Durability::Wait);
+}
+
+bool FileHandler::commitWalletData(const std::vector<Wallet>& wallets, const std::vector<Transaction>& transactions,
+                                   Durability durability) {
+    return awaitWrite(queueWalletData(wallets, transactions), WALLET_DATA_STREAM, durability);
+}
+
+bool FileHandler::awaitWalletData(uint64_t ticket) {
+    return awaitWrite(ticket, WALLET_DATA_STREAM, Durability::Wait);
+}
+
+uint64_t FileHandler::queueWalletData(const std::vector<Wallet>& wallets, const std::vector<Transaction>& transactions) {
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        // Wallets and transactions are only ever appended; a shrunken vector (a rolled back wallet
+        // creation, archived transactions) cannot be expressed as a log record.
+        if (!AppConfig::USE_WRITE_AHEAD_LOG || wallets.size() < persistedWalletCount ||
+            transactions.size() < persistedTransactionCount) {
+            queueCheckpointLocked(wallets, transactions);
+        } else {
+            auto queueWallet = [this](const Wallet& wallet) {
+                auto queued = pending.walletUpdateIndex.find(wallet.walletId);
+                if (queued != pending.walletUpdateIndex.end()) {
+                    pending.walletUpdates[queued->second] = wallet; // Coalesced with an unwritten commit
+                    return;
+                }
+                pending.walletUpdateIndex.emplace(wallet.walletId, pending.walletUpdates.size());
+                pending.walletUpdates.push_back(wallet);
+                ++logEntries;
+            };
+            for (size_t position : dirtyWalletPositions) {
+                if (position < persistedWalletCount) { // Later ones are new and written below
+                    queueWallet(wallets[position]); // A repeated position coalesces
+                }
+            }
+            for (size_t i = persistedWalletCount; i < wallets.size(); ++i) {
+                queueWallet(wallets[i]); // New wallets are always written
+            }
+            pending.transactionAppends.insert(pending.transactionAppends.end(),
+                                              transactions.begin() + persistedTransactionCount, transactions.end());
+            logEntries += transactions.size() - persistedTransactionCount;
+            logEntries += updatedTransactions.size();
+            pending.transactionUpdates.insert(pending.transactionUpdates.end(),
+                                              updatedTransactions.begin(), updatedTransactions.end());
+            updatedTransactions.clear();
+            dirtyWalletPositions.clear();
+            persistedWalletCount = wallets.size();
+            persistedTransactionCount = transactions.size();
+
+            if (logEntries >= AppConfig::CHECKPOINT_MIN_LOG_ENTRIES && logEntries >= checkpointEntries) {
+                LOG_INFO("Write-ahead log reached " + std::to_string(logEntries) + " entries, checkpointing");
+                queueCheckpointLocked(wallets, transactions); // Supersedes the commit queued above
+            }
+        }
+        ticket = submitLocked();
+    }
+    return ticket;
+}
+
+// --- Export ---
+bool FileHandler::exportToJson(const std::string& directory, const std::vector<User>& users,
+                               const std::vector<UserDetails>& userDetails, const std::vector<Wallet>& wallets,
+                               const std::vector<Transaction>& transactions,
+                               const TransactionArchive* archive) {
+    std::string exportDir = directory;
+    if (!exportDir.empty() && exportDir.back() != '/' && exportDir.back() != '\\') {
+        exportDir += "/";
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(exportDir, ec);
+    if (ec) {
+        LOG_ERROR("Could not create export directory " + exportDir + ": " + ec.message());
         return false;
     }
+
     try {
-        json j = transactions;
-        file << j.dump(4);
-        file.flush(); // Ensure data is written to disk
-        file.close();
-        LOG_INFO("Successfully saved " + std::to_string(transactions.size()) + " transactions to file");
+        std::ofstream usersFile(exportDir + "users.json", std::ios::out | std::ios::trunc);
+        JsonStreamWriter usersWriter(usersFile, true);
+        for (size_t i = 0; i < users.size(); ++i) {
+            usersWriter.add(userRecord(users[i], userDetails[i]));
+        }
+
+        std::ofstream walletsFile(exportDir + "wallets.json", std::ios::out | std::ios::trunc);
+        JsonStreamWriter walletsWriter(walletsFile, true);
+        walletsWriter.addAll(wallets);
+
+        std::ofstream transactionsFile(exportDir + "transactions.json", std::ios::out | std::ios::trunc);
+        JsonStreamWriter transactionsWriter(transactionsFile, true);
+        size_t exported = transactions.size();
+        if (archive) {
+            for (size_t s = 0; s < archive->segments().size(); ++s) {
+                const ArchiveSegment* segment = archive->acquire(s);
+                if (!segment) {
+                    LOG_ERROR("Export aborted: archive segment " + archive->segments()[s].path() + " cannot be read");
+                    return false;
+                }
+                for (size_t i = 0; i < segment->recordCount(); ++i) {
+                    transactionsWriter.add(segment->record(i).toTransaction());
+                }
+                exported += segment->recordCount();
+                archive->releaseCold(); // Exporting a large archive stays within the mapping budget
+            }
+        }
+        transactionsWriter.addAll(transactions);
+
+        if (!usersWriter.finish() || !walletsWriter.finish() || !transactionsWriter.finish()) {
+            LOG_ERROR("Failed to write export files to " + exportDir);
+            return false;
+        }
+        LOG_INFO("Exported " + std::to_string(users.size()) + " users, " + std::to_string(wallets.size()) +
+                 " wallets and " + std::to_string(exported) + " transactions to " + exportDir);
         return true;
-    } catch (json::type_error& e) {
-        LOG_ERROR("JSON type error saving transactions: " + std::string(e.what()));
-        file.close();
-        return false;
-    } catch (std::exception& e) {
-        LOG_ERROR("Generic error saving transactions: " + std::string(e.what()));
-        file.close();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error exporting data to JSON: " + std::string(e.what()));
         return false;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,109 @@
+// src/utils/IdempotencyCache.cpp
+#include "../../include/utils/IdempotencyCache.hpp"
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+
+IdempotencyCache::Reservation::Reservation(Reservation&& other) noexcept
+    : cache(other.cache), key(std::move(other.key)) {
+    other.cache = nullptr;
+}
+
+IdempotencyCache::Reservation& IdempotencyCache::Reservation::operator=(Reservation&& other) noexcept {
+    if (this != &other) {
+        if (cache) {
+            cache->release(key);
+        }
+        cache = other.cache;
+        key = std::move(other.key);
+        other.cache = nullptr;
+    }
+    return *this;
+}
+
+IdempotencyCache::Reservation::~Reservation() {
+    if (cache) {
+        cache->release(key);
+    }
+}
+
+void IdempotencyCache::Reservation::complete(Outcome outcome) {
+    if (cache) {
+        cache->complete(key, std::move(outcome));
+        cache = nullptr;
+    }
+}
+
+IdempotencyCache::IdempotencyCache(size_t capacity_val, std::chrono::seconds ttl_val)
+    : capacity(capacity_val), ttl(ttl_val) {}
+
+std::optional<IdempotencyCache::Outcome> IdempotencyCache::claim(const std::string& key,
+                                                                 Reservation& outReservation) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        const auto now = std::chrono::steady_clock::now();
+        evictLocked(now);
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            const auto expires = now + ttl;
+            entries.emplace(key, Entry{std::nullopt, expires});
+            order.emplace_back(key, expires);
+            outReservation = Reservation(this, key);
+            return std::nullopt;
+        }
+        if (it->second.outcome) {
+            return it->second.outcome;
+        }
+        requestDone.wait(lock); // The same key is running on another thread
+    }
+}
+
+void IdempotencyCache::complete(const std::string& key, Outcome outcome) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            it->second.outcome = std::move(outcome);
+        }
+    }
+    requestDone.notify_all();
+}
+
+void IdempotencyCache::release(const std::string& key) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end() && !it->second.outcome) {
+            entries.erase(it); // The deque entry is dropped as stale later
+        }
+    }
+    requestDone.notify_all();
+}
+
+void IdempotencyCache::evictLocked(std::chrono::steady_clock::time_point now) {
+    while (!order.empty()) {
+        const auto& [key, expires] = order.front();
+        auto it = entries.find(key);
+        if (it == entries.end() || it->second.expires != expires) {
+            order.pop_front(); // Released, or claimed again since
+            continue;
+        }
+        if (!it->second.outcome || (expires > now && entries.size() <= capacity)) {
+            break; // A running request is never dropped; the cache briefly exceeds capacity instead
+        }
+        entries.erase(it);
+        order.pop_front();
+    }
+}
+
+std::string IdempotencyCache::transactionIdFor(const std::string& prefix, const std::string& key) {
+    // FNV-1a: std::hash is not guaranteed to give the same value in another build
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream id;
+    id << prefix << std::hex << std::setw(12) << std::setfill('0') << (hash & 0xFFFFFFFFFFFFULL);
+    return id.str();
+}
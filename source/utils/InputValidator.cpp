@@ -104,4 +104,11 @@ bool InputValidator::isValidDouble(const std::string& input, double& outValue) {
     } catch (const std::out_of_range&) {
         return false;
     }
-}
\ No newline at end of file
+}
+
+bool InputValidator::isValidAmount(const std::string& input, Money& outValue) {
+    if (!isNonEmpty(input)) {
+        return false;
+    }
+    return Money::parse(input, outValue);
+}
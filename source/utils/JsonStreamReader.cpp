@@ -0,0 +1,126 @@
+// src/utils/JsonStreamReader.cpp
+#include "../../include/utils/JsonStreamReader.hpp"
+#include <vector>
+
+namespace {
+    // Builds one array element at a time from SAX events
+    class ArrayElementSax : public nlohmann::json_sax<json> {
+    public:
+        explicit ArrayElementSax(const std::function<void(json&)>& callback) : onElement(callback) {}
+
+        std::string error;
+
+        bool null() override { return scalar(json(nullptr)); }
+        bool boolean(bool val) override { return scalar(json(val)); }
+        bool number_integer(number_integer_t val) override { return scalar(json(val)); }
+        bool number_unsigned(number_unsigned_t val) override { return scalar(json(val)); }
+        bool number_float(number_float_t val, const string_t&) override { return scalar(json(val)); }
+        bool string(string_t& val) override { return scalar(json(std::move(val))); }
+        bool binary(binary_t& val) override { return scalar(json::binary(std::move(val))); }
+
+        bool start_object(std::size_t) override { return startContainer(json::object()); }
+        bool end_object() override { return endContainer(); }
+        bool start_array(std::size_t) override {
+            if (!inTopArray && stack.empty()) {
+                if (finishedTopArray) {
+                    return fail("unexpected second top-level value");
+                }
+                inTopArray = true;
+                return true;
+            }
+            return startContainer(json::array());
+        }
+        bool end_array() override {
+            if (stack.empty()) {
+                inTopArray = false;
+                finishedTopArray = true;
+                return true;
+            }
+            return endContainer();
+        }
+
+        bool key(string_t& val) override {
+            pendingKey = std::move(val);
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+            return fail(ex.what());
+        }
+
+    private:
+        const std::function<void(json&)>& onElement;
+        json current;                // Element being built
+        std::vector<json*> stack;    // Open containers inside the current element
+        std::string pendingKey;
+        bool inTopArray = false;
+        bool finishedTopArray = false;
+
+        bool fail(const std::string& message) {
+            error = message;
+            return false;
+        }
+
+        // Adds a value to the innermost open container and returns where it was stored
+        json* place(json&& value) {
+            json& parent = *stack.back();
+            if (parent.is_object()) {
+                json& slot = parent[pendingKey];
+                slot = std::move(value);
+                return &slot;
+            }
+            parent.push_back(std::move(value));
+            return &parent.back();
+        }
+
+        bool scalar(json&& value) {
+            if (!inTopArray) {
+                if (value.is_null() && !finishedTopArray) {
+                    return true; // A "null" file is treated as empty
+                }
+                return fail("document is not a JSON array");
+            }
+            if (stack.empty()) {
+                onElement(value); // Scalar element; the callback decides whether it is acceptable
+                return true;
+            }
+            place(std::move(value));
+            return true;
+        }
+
+        bool startContainer(json&& container) {
+            if (!inTopArray) {
+                return fail("document is not a JSON array");
+            }
+            if (stack.empty()) {
+                current = std::move(container);
+                stack.push_back(&current);
+            } else {
+                stack.push_back(place(std::move(container)));
+            }
+            return true;
+        }
+
+        bool endContainer() {
+            stack.pop_back();
+            if (stack.empty()) {
+                onElement(current);
+                current = json();
+            }
+            return true;
+        }
+    };
+}
+
+bool JsonStreamReader::readArray(std::istream& in, const std::function<void(json&)>& onElement, std::string& outError) {
+    // An empty file holds no records
+    if (in.peek() == std::char_traits<char>::eof()) {
+        return true;
+    }
+    ArrayElementSax handler(onElement);
+    if (!json::sax_parse(in, &handler)) {
+        outError = handler.error.empty() ? "malformed JSON" : handler.error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,124 @@
+// src/utils/MappedFile.cpp
+#include "../../include/utils/MappedFile.hpp"
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define REWARD_SYSTEM_HAS_MMAP 1
+#elif defined(_WIN32) || defined(_WIN64)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <filesystem>
+#else
+#include <fstream>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : mapped(other.mapped), buffer(std::move(other.buffer)), length(other.length) {
+    other.mapped = nullptr;
+    other.length = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        mapped = other.mapped;
+        buffer = std::move(other.buffer);
+        length = other.length;
+        other.mapped = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& filePath) {
+    close();
+#ifdef REWARD_SYSTEM_HAS_MMAP
+    const int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void* region = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file
+    if (region == MAP_FAILED) {
+        return false;
+    }
+    mapped = static_cast<const char*>(region);
+    length = static_cast<size_t>(info.st_size);
+    return true;
+#elif defined(_WIN32) || defined(_WIN64)
+    const HANDLE file = ::CreateFileW(std::filesystem::path(filePath).c_str(), GENERIC_READ,
+                                      FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+        ::CloseHandle(file);
+        return false;
+    }
+    const HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    ::CloseHandle(file); // The mapping keeps its own reference to the file
+    if (!mapping) {
+        return false;
+    }
+    const void* region = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(mapping); // ...and the view to the mapping
+    if (!region) {
+        return false;
+    }
+    mapped = static_cast<const char*>(region);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+#else
+    std::ifstream file(filePath, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    const std::streamoff fileSize = file.tellg();
+    if (fileSize <= 0) {
+        return false;
+    }
+    buffer.resize(static_cast<size_t>(fileSize));
+    file.seekg(0);
+    if (!file.read(buffer.data(), fileSize)) {
+        buffer.clear();
+        return false;
+    }
+    length = buffer.size();
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef REWARD_SYSTEM_HAS_MMAP
+    if (mapped) {
+        ::munmap(const_cast<char*>(mapped), length);
+    }
+#elif defined(_WIN32) || defined(_WIN64)
+    if (mapped) {
+        ::UnmapViewOfFile(mapped);
+    }
+#endif
+    mapped = nullptr;
+    std::vector<char>().swap(buffer); // Releases the fallback copy's memory
+    length = 0;
+}
@@ -0,0 +1,75 @@
+// src/utils/StartupLoader.cpp
+#include "../../include/utils/StartupLoader.hpp"
+#include "../../include/utils/FileHandler.hpp"
+#include "../../include/utils/DataIndex.hpp"
+#include "../../include/utils/TransactionArchive.hpp"
+#include "../../include/utils/Logger.hpp"
+#include "../../include/Config.h"
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+StartupLoader::StartupLoader(FileHandler& fh_ref, DataIndex& idx_ref, TransactionArchive& archive_ref,
+                             std::vector<User>& u_ref, std::vector<UserDetails>& ud_ref,
+                             std::vector<Wallet>& w_ref, std::vector<Transaction>& t_ref)
+    : fileHandler(fh_ref), index(idx_ref), archive(archive_ref), users(u_ref), userDetails(ud_ref),
+      wallets(w_ref), transactions(t_ref) {}
+
+StartupLoader::Result StartupLoader::run() {
+    Result result;
+    std::mutex timingsMutex;
+    // Runs one stage and records how long it took
+    auto timed = [&result, &timingsMutex](const char* stage, auto&& work) {
+        const Clock::time_point start = Clock::now();
+        auto outcome = work();
+        const double elapsed = millisecondsSince(start);
+        std::lock_guard<std::mutex> lock(timingsMutex);
+        result.timings.push_back({stage, elapsed});
+        return outcome;
+    };
+    const Clock::time_point start = Clock::now();
+
+    // Each thread owns its vectors and index maps; nothing is shared until all have joined
+    auto usersDone = std::async(std::launch::async, [&] {
+        const bool loaded = timed("load users", [&] { return fileHandler.loadUsers(users, userDetails); });
+        timed("index users", [&] { index.rebuildUsers(); return true; });
+        return loaded;
+    });
+    auto archiveDone = std::async(std::launch::async, [&] {
+        if (!AppConfig::USE_TRANSACTION_ARCHIVE) {
+            return true;
+        }
+        return timed("open archive", [&] { return archive.open(); });
+    });
+    const bool walletDataLoaded = timed("load wallets and transactions", [&] {
+        return fileHandler.loadWalletData(wallets, transactions);
+    });
+    auto transactionsIndexed = std::async(std::launch::async, [&] {
+        return timed("index transactions", [&] { index.rebuildTransactions(); return true; });
+    });
+    timed("index wallets", [&] { index.rebuildWallets(); return true; });
+    transactionsIndexed.get();
+
+    result.walletDataLoaded = walletDataLoaded;
+    result.usersLoaded = usersDone.get();
+    result.archiveOpened = archiveDone.get();
+    result.timings.push_back({"total", millisecondsSince(start)});
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < result.timings.size(); ++i) {
+        summary << (i == 0 ? "" : ", ") << result.timings[i].stage << " " << result.timings[i].milliseconds << " ms";
+    }
+    LOG_INFO("Startup loading: " + summary.str());
+    return result;
+}
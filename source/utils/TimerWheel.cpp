@@ -0,0 +1,44 @@
+// src/utils/TimerWheel.cpp
+#include "../../include/utils/TimerWheel.hpp"
+#include <algorithm>
+
+TimerWheel::TimerWheel(size_t slotCount, time_t granularity_val, time_t now)
+    : slots(slotCount > 0 ? slotCount : 1),
+      granularity(granularity_val > 0 ? granularity_val : 1),
+      processedTick(now / granularity) {}
+
+void TimerWheel::schedule(const Identifier& id, time_t deadline) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const time_t tick = (deadline + granularity - 1) / granularity;
+    if (tick <= processedTick) {
+        overdue.push_back(id); // Already due: expires on the next advance, even within this tick
+        return;
+    }
+    slots[static_cast<size_t>(tick) % slots.size()].push_back({id, tick});
+}
+
+std::vector<Identifier> TimerWheel::advance(time_t now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Identifier> expired;
+    expired.swap(overdue);
+    const time_t nowTick = now / granularity;
+    if (nowTick <= processedTick) {
+        return expired;
+    }
+    // After a long pause one pass over the wheel covers every tick that passed
+    const time_t ticks = std::min<time_t>(nowTick - processedTick, static_cast<time_t>(slots.size()));
+    for (time_t t = 1; t <= ticks; ++t) {
+        std::vector<Timer>& slot = slots[static_cast<size_t>(processedTick + t) % slots.size()];
+        size_t kept = 0;
+        for (size_t i = 0; i < slot.size(); ++i) {
+            if (slot[i].tick <= nowTick) {
+                expired.push_back(slot[i].id);
+            } else {
+                slot[kept++] = slot[i]; // Due in a later turn of the wheel
+            }
+        }
+        slot.resize(kept);
+    }
+    processedTick = nowTick;
+    return expired;
+}
@@ -0,0 +1,995 @@
+// src/utils/TransactionArchive.cpp
+#include "../../include/utils/TransactionArchive.hpp"
+#include "../../include/utils/BinarySnapshot.hpp"
+#include "../../include/utils/BlockCodec.hpp"
+#include "../../include/utils/DurableFile.hpp"
+#include "../../include/utils/Logger.hpp"
+#include "../../include/Config.h"
+#include <algorithm>
+#include <ctime>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+namespace {
+    constexpr char MAGIC[4] = {'R', 'W', 'T', 'A'};
+    constexpr uint16_t FORMAT_VERSION = 2;
+    constexpr uint16_t COMPRESSED_FORMAT_VERSION = 3;
+    constexpr size_t HEADER_SIZE = 72;          // Version 2 adds the first merged sequence
+    constexpr size_t VERSION_1_HEADER_SIZE = 64;
+    constexpr size_t COMPRESSED_HEADER_SIZE = 96;
+    constexpr size_t RECORD_SIZE = 56;
+    constexpr size_t TIMESTAMP_SIZE = 8;
+    constexpr size_t BLOCK_ENTRY_SIZE = 40;
+    constexpr size_t WALLET_ENTRY_SIZE = 16;
+    constexpr size_t POSTING_SIZE = 4;
+    constexpr const char* SEGMENT_PREFIX = "segment-";
+    constexpr const char* SEGMENT_EXTENSION = ".arc";
+
+    // Segments are little-endian regardless of the host
+    uint32_t readU32(const char* p) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    uint64_t readU64(const char* p) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    void putLittleEndian(std::string& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // Stores each distinct string once and hands out (offset, length) pairs
+    class StringHeap {
+    public:
+        std::string bytes;
+
+        // The views must stay valid until the segment is written
+        std::pair<uint32_t, uint32_t> add(std::string_view value) {
+            auto it = offsets.find(value);
+            if (it == offsets.end()) {
+                it = offsets.emplace(value, static_cast<uint32_t>(bytes.size())).first;
+                bytes.append(value);
+            }
+            return {it->second, static_cast<uint32_t>(value.size())};
+        }
+
+    private:
+        std::unordered_map<std::string_view, uint32_t> offsets;
+    };
+
+    // Records copied out of a segment, so the segment can be unmapped before its file is replaced
+    // (Windows refuses to replace a file that is still mapped)
+    class DetachedRecords {
+    public:
+        std::vector<TransactionView> views;
+
+        void add(const TransactionView& view) {
+            // Deque elements never move, so the views into them stay valid as records are added
+            std::string& copy = strings.emplace_back();
+            copy.reserve(view.transactionId.size() + view.sourceWalletId.size() + view.targetWalletId.size() +
+                         view.reasonArgs.size());
+            copy.append(view.transactionId).append(view.sourceWalletId).append(view.targetWalletId).append(view.reasonArgs);
+            size_t offset = 0;
+            auto take = [&copy, &offset](std::string_view field) {
+                const std::string_view part(copy.data() + offset, field.size());
+                offset += field.size();
+                return part;
+            };
+            TransactionView detached = view;
+            detached.transactionId = take(view.transactionId);
+            detached.sourceWalletId = take(view.sourceWalletId);
+            detached.targetWalletId = take(view.targetWalletId);
+            detached.reasonArgs = take(view.reasonArgs);
+            views.push_back(detached);
+        }
+
+    private:
+        std::deque<std::string> strings;
+    };
+
+    void putString(std::string& out, StringHeap& heap, std::string_view value) {
+        const auto ref = heap.add(value);
+        putLittleEndian(out, ref.first, 4);
+        putLittleEndian(out, ref.second, 4);
+    }
+
+    void putRecord(std::string& out, StringHeap& heap, const TransactionView& tx) {
+        putLittleEndian(out, static_cast<uint64_t>(static_cast<int64_t>(tx.timestamp)), 8);
+        putLittleEndian(out, static_cast<uint64_t>(tx.amount.minorUnits()), 8);
+        putString(out, heap, tx.transactionId);
+        putString(out, heap, tx.sourceWalletId);
+        putString(out, heap, tx.targetWalletId);
+        putString(out, heap, tx.reasonArgs);
+        out.push_back(static_cast<char>(tx.status));
+        out.push_back(static_cast<char>(tx.reason)); // Zero (free text) in segments written before templates
+        out.append(RECORD_SIZE - 50, '\0'); // Padding keeps records 8-byte aligned
+    }
+
+    std::string_view stringAt(const char* heap, size_t heapSize, uint32_t offset, uint32_t length) {
+        if (static_cast<size_t>(offset) + length > heapSize) {
+            return std::string_view(); // Damaged reference; never read outside the heap
+        }
+        return std::string_view(heap + offset, length);
+    }
+
+    void putVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool getVarint(const char*& p, const char* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            const unsigned char byte = static_cast<unsigned char>(*p++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t zigzag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // A compressed block's records are first encoded as a compact stream, which the codec then
+    // packs far better than fixed-size records full of heap offsets. Per record: zigzag varint
+    // timestamp delta, zigzag varint amount, status byte (reason in the high nibble), then the four strings, each either
+    // varint k (the k-th distinct string of the block) or 0, varint length and the new bytes.
+    void encodeBlock(const std::vector<TransactionView>& records, size_t first, size_t end, std::string& out) {
+        std::unordered_map<std::string_view, uint64_t> seen;
+        int64_t previousTimestamp = 0;
+        for (size_t i = first; i < end; ++i) {
+            const TransactionView& tx = records[i];
+            putVarint(out, zigzag(static_cast<int64_t>(tx.timestamp) - previousTimestamp));
+            previousTimestamp = static_cast<int64_t>(tx.timestamp);
+            putVarint(out, zigzag(tx.amount.minorUnits()));
+            out.push_back(static_cast<char>(static_cast<uint8_t>(tx.status) | (static_cast<uint8_t>(tx.reason) << 4)));
+            for (std::string_view value : {tx.transactionId, tx.sourceWalletId, tx.targetWalletId, tx.reasonArgs}) {
+                auto it = seen.find(value);
+                if (it != seen.end()) {
+                    putVarint(out, it->second);
+                    continue;
+                }
+                seen.emplace(value, seen.size() + 1);
+                putVarint(out, 0);
+                putVarint(out, value.size());
+                out.append(value);
+            }
+        }
+    }
+
+    // Rebuilds the fixed-size records of an encoded block, followed by its string heap
+    bool decodeBlockRecords(const std::string& encoded, size_t recordCount, std::string& out) {
+        const char* p = encoded.data();
+        const char* end = p + encoded.size();
+        std::string heapBytes;
+        std::vector<std::pair<uint32_t, uint32_t>> strings; // (offset, length) in heapBytes
+        out.clear();
+        out.reserve(recordCount * RECORD_SIZE);
+        int64_t timestamp = 0;
+        for (size_t i = 0; i < recordCount; ++i) {
+            uint64_t delta = 0;
+            uint64_t amount = 0;
+            if (!getVarint(p, end, delta) || !getVarint(p, end, amount) || p == end) {
+                return false;
+            }
+            timestamp += unzigzag(delta);
+            const uint8_t statusAndReason = static_cast<uint8_t>(*p++);
+            putLittleEndian(out, static_cast<uint64_t>(timestamp), 8);
+            putLittleEndian(out, static_cast<uint64_t>(unzigzag(amount)), 8);
+            for (int field = 0; field < 4; ++field) {
+                uint64_t code = 0;
+                if (!getVarint(p, end, code) || code > strings.size()) {
+                    return false;
+                }
+                if (code == 0) {
+                    uint64_t length = 0;
+                    if (!getVarint(p, end, length) || length > static_cast<uint64_t>(end - p)) {
+                        return false;
+                    }
+                    strings.emplace_back(static_cast<uint32_t>(heapBytes.size()), static_cast<uint32_t>(length));
+                    heapBytes.append(p, length);
+                    p += length;
+                    code = strings.size();
+                }
+                putLittleEndian(out, strings[code - 1].first, 4);
+                putLittleEndian(out, strings[code - 1].second, 4);
+            }
+            out.push_back(static_cast<char>(statusAndReason & 0x0F));
+            out.push_back(static_cast<char>(statusAndReason >> 4));
+            out.append(RECORD_SIZE - 50, '\0');
+        }
+        if (p != end) {
+            return false;
+        }
+        out += heapBytes;
+        return true;
+    }
+
+    TransactionView readRecord(const char* r, const char* heap, size_t heapSize) {
+        TransactionView view;
+        view.timestamp = static_cast<time_t>(static_cast<int64_t>(readU64(r)));
+        view.amount = Money::fromMinorUnits(static_cast<int64_t>(readU64(r + 8)));
+        view.transactionId = stringAt(heap, heapSize, readU32(r + 16), readU32(r + 20));
+        view.sourceWalletId = stringAt(heap, heapSize, readU32(r + 24), readU32(r + 28));
+        view.targetWalletId = stringAt(heap, heapSize, readU32(r + 32), readU32(r + 36));
+        view.reasonArgs = stringAt(heap, heapSize, readU32(r + 40), readU32(r + 44));
+        const uint8_t status = static_cast<uint8_t>(r[48]);
+        view.status = status <= static_cast<uint8_t>(TransactionStatus::Cancelled)
+                          ? static_cast<TransactionStatus>(status)
+                          : TransactionStatus::Failed;
+        const uint8_t reason = static_cast<uint8_t>(r[49]);
+        view.reason = Transaction::isValidReason(reason) ? static_cast<TransactionReason>(reason) : TransactionReason::Note;
+        return view;
+    }
+}
+
+// --- ArchiveSegment ---
+uint32_t ArchiveSegment::Postings::operator[](size_t i) const {
+    return readU32(data + i * POSTING_SIZE);
+}
+
+bool ArchiveSegment::map(bool verifyChecksum, Header& outHeader, std::string& outError) const {
+    if (!file.open(filePath)) {
+        outError = "cannot map file";
+        return false;
+    }
+    const char* base = file.data();
+    const size_t size = file.size();
+    if (size < VERSION_1_HEADER_SIZE || std::memcmp(base, MAGIC, sizeof(MAGIC)) != 0) {
+        outError = "not an archive segment";
+        unload();
+        return false;
+    }
+    const uint16_t version = static_cast<uint16_t>(static_cast<unsigned char>(base[4]) |
+                                                   (static_cast<unsigned char>(base[5]) << 8));
+    if (version != FORMAT_VERSION && version != COMPRESSED_FORMAT_VERSION && version != 1) {
+        outError = "unsupported version " + std::to_string(version);
+        unload();
+        return false;
+    }
+    const bool isCompressed = version == COMPRESSED_FORMAT_VERSION;
+    const size_t headerSize = version == 1 ? VERSION_1_HEADER_SIZE : isCompressed ? COMPRESSED_HEADER_SIZE : HEADER_SIZE;
+    if (size < headerSize) {
+        outError = "truncated header";
+        unload();
+        return false;
+    }
+    outHeader.records = readU32(base + 8);
+    outHeader.walletCount = readU32(base + 12);
+    outHeader.postingCount = readU32(base + 16);
+    outHeader.lastIdOffset = readU32(base + 20);
+    outHeader.lastIdLength = readU32(base + 24);
+    outHeader.firstSequence = version == 1 ? sequenceNumber : readU64(base + 64);
+    outHeader.compressed = isCompressed;
+    const uint32_t checksum = readU32(base + 28);
+    const uint64_t recordsOffset = readU64(base + 32); // The timestamp column in compressed segments
+    const uint64_t walletsOffset = readU64(base + 40);
+    const uint64_t postingsOffset = readU64(base + 48);
+    const uint64_t heapOffset = readU64(base + 56);
+
+    // Sections must be laid out back to back inside the file
+    uint64_t heapEnd = size;
+    bool laidOut = recordsOffset == headerSize;
+    if (isCompressed) {
+        outHeader.codec = static_cast<CompressionCodec>(static_cast<unsigned char>(base[6]));
+        const uint64_t blockTableOffset = readU64(base + 72);
+        heapEnd = readU64(base + 80); // Block data follows the heap
+        outHeader.blockCount = readU32(base + 88);
+        outHeader.blockRecords = readU32(base + 92);
+        laidOut = laidOut && outHeader.blockRecords > 0 &&
+                  outHeader.blockCount == (outHeader.records + outHeader.blockRecords - 1) / outHeader.blockRecords &&
+                  blockTableOffset == recordsOffset + outHeader.records * TIMESTAMP_SIZE &&
+                  walletsOffset == blockTableOffset + outHeader.blockCount * BLOCK_ENTRY_SIZE;
+        if (laidOut && !BlockCodec::isSupported(outHeader.codec)) {
+            outError = "compressed with a codec this build does not support";
+            unload();
+            return false;
+        }
+    } else {
+        laidOut = laidOut && walletsOffset == recordsOffset + outHeader.records * RECORD_SIZE;
+    }
+    if (!laidOut ||
+        postingsOffset != walletsOffset + outHeader.walletCount * WALLET_ENTRY_SIZE ||
+        heapOffset != postingsOffset + outHeader.postingCount * POSTING_SIZE ||
+        heapOffset > heapEnd || heapEnd > size) {
+        outError = "section table does not match the file size";
+        unload();
+        return false;
+    }
+    if (verifyChecksum && BinarySnapshot::crc32(base + headerSize, size - headerSize) != checksum) {
+        outError = "checksum mismatch";
+        unload();
+        return false;
+    }
+
+    recordBase = isCompressed ? nullptr : base + recordsOffset;
+    timestampBase = isCompressed ? base + recordsOffset : nullptr;
+    blockTable = isCompressed ? base + readU64(base + 72) : nullptr;
+    blockData = isCompressed ? base + heapEnd : nullptr;
+    blockDataSize = size - heapEnd;
+    walletBase = base + walletsOffset;
+    postingBase = base + postingsOffset;
+    heap = base + heapOffset;
+    heapSize = heapEnd - heapOffset;
+    return true;
+}
+
+bool ArchiveSegment::open(const std::string& path, uint64_t sequence, bool verifyChecksum, std::string& outError) {
+    filePath = path;
+    sequenceNumber = sequence;
+    Header header;
+    if (!map(verifyChecksum, header, outError)) {
+        return false;
+    }
+    if (header.firstSequence > sequence) {
+        outError = "merged sequence range is inverted";
+        unload();
+        return false;
+    }
+    records = header.records;
+    walletCount = header.walletCount;
+    postingCount = header.postingCount;
+    firstSequence = header.firstSequence;
+    compressed = header.compressed;
+    codec = header.codec;
+    blockCount = header.blockCount;
+    blockRecords = header.blockRecords;
+    lastAppendedId = std::string(heapString(header.lastIdOffset, header.lastIdLength));
+    oldest = records == 0 ? 0 : timestampAt(0);
+    newest = records == 0 ? 0 : timestampAt(records - 1);
+    return true;
+}
+
+bool ArchiveSegment::load() const {
+    if (isLoaded()) {
+        return true;
+    }
+    Header header;
+    std::string error;
+    if (!map(false, header, error)) {
+        LOG_ERROR("Could not map archive segment " + filePath + ": " + error);
+        return false;
+    }
+    if (header.records != records || header.walletCount != walletCount || header.postingCount != postingCount ||
+        header.compressed != compressed || header.blockCount != blockCount) {
+        LOG_ERROR("Archive segment " + filePath + " changed on disk since it was opened");
+        unload();
+        return false;
+    }
+    return true;
+}
+
+void ArchiveSegment::unload() const {
+    file.close();
+    recordBase = timestampBase = blockTable = blockData = walletBase = postingBase = heap = nullptr;
+    heapSize = 0;
+    blockDataSize = 0;
+    decodedBlocks.clear();
+    decodedBytes = 0;
+}
+
+const std::string* ArchiveSegment::decodeBlock(size_t block) const {
+    auto cached = decodedBlocks.find(block);
+    if (cached != decodedBlocks.end()) {
+        return &cached->second;
+    }
+    if (!blockTable || block >= blockCount) {
+        return nullptr;
+    }
+    const char* entry = blockTable + block * BLOCK_ENTRY_SIZE;
+    const uint64_t offset = readU64(entry + 16);
+    const uint32_t packedSize = readU32(entry + 24);
+    const uint32_t rawSize = readU32(entry + 28);
+    const uint32_t checksum = readU32(entry + 32);
+    const size_t blockRecordCount = std::min(blockRecords, records - block * blockRecords);
+    std::string encoded;
+    std::string decoded;
+    if (offset + packedSize > blockDataSize ||
+        !BlockCodec::decompress(codec, blockData + offset, packedSize, rawSize, encoded) ||
+        BinarySnapshot::crc32(encoded.data(), encoded.size()) != checksum ||
+        !decodeBlockRecords(encoded, blockRecordCount, decoded)) {
+        LOG_ERROR("Archive segment " + filePath + " has a damaged block " + std::to_string(block));
+        return nullptr;
+    }
+    decodedBytes += decoded.size();
+    return &decodedBlocks.emplace(block, std::move(decoded)).first->second;
+}
+
+time_t ArchiveSegment::timestampAt(size_t recordNumber) const {
+    if (recordNumber >= records) {
+        return 0;
+    }
+    if (timestampBase) {
+        return static_cast<time_t>(static_cast<int64_t>(readU64(timestampBase + recordNumber * TIMESTAMP_SIZE)));
+    }
+    if (recordBase) {
+        return static_cast<time_t>(static_cast<int64_t>(readU64(recordBase + recordNumber * RECORD_SIZE)));
+    }
+    return 0;
+}
+
+std::string_view ArchiveSegment::heapString(uint32_t offset, uint32_t length) const {
+    return stringAt(heap, heapSize, offset, length);
+}
+
+TransactionView ArchiveSegment::record(size_t recordNumber) const {
+    if (recordNumber >= records) {
+        return TransactionView();
+    }
+    if (!compressed) {
+        return recordBase ? readRecord(recordBase + recordNumber * RECORD_SIZE, heap, heapSize) : TransactionView();
+    }
+    // A block holds its records followed by its own string heap
+    const size_t block = recordNumber / blockRecords;
+    const std::string* decoded = decodeBlock(block);
+    if (!decoded) {
+        return TransactionView();
+    }
+    const size_t blockRecordCount = std::min(blockRecords, records - block * blockRecords);
+    const size_t blockHeapOffset = blockRecordCount * RECORD_SIZE;
+    return readRecord(decoded->data() + (recordNumber % blockRecords) * RECORD_SIZE,
+                      decoded->data() + blockHeapOffset, decoded->size() - blockHeapOffset);
+}
+
+ArchiveSegment::Postings ArchiveSegment::postingsForWallet(const std::string& walletId) const {
+    Postings result;
+    if (!walletBase) {
+        return result;
+    }
+    // Binary search over the wallet table, which is sorted by wallet id bytes
+    size_t low = 0;
+    size_t high = walletCount;
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        const char* entry = walletBase + mid * WALLET_ENTRY_SIZE;
+        const int cmp = heapString(readU32(entry), readU32(entry + 4)).compare(walletId);
+        if (cmp == 0) {
+            const uint32_t first = readU32(entry + 8);
+            const uint32_t count = readU32(entry + 12);
+            if (static_cast<size_t>(first) + count <= postingCount) {
+                result.data = postingBase + static_cast<size_t>(first) * POSTING_SIZE;
+                result.count = count;
+            }
+            return result;
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return result;
+}
+
+// --- TransactionArchive ---
+TransactionArchive::TransactionArchive(const std::string& directoryPath, const std::string& retiredDirectoryPath)
+    : directory(directoryPath), retiredDirectory(retiredDirectoryPath) {
+    for (std::string* path : {&directory, &retiredDirectory}) {
+        if (!path->empty() && path->back() != '/' && path->back() != '\\') {
+            *path += "/";
+        }
+    }
+}
+
+std::string TransactionArchive::segmentPath(uint64_t sequence, uint32_t bucket) const {
+    std::string number = std::to_string(sequence);
+    number.insert(0, number.size() < 8 ? 8 - number.size() : 0, '0');
+    // The bucket is informational; segments are identified and ordered by their sequence
+    return directory + SEGMENT_PREFIX + number + "-" + std::to_string(bucket) + SEGMENT_EXTENSION;
+}
+
+uint32_t TransactionArchive::timeBucket(time_t timestamp) {
+    std::tm utc{};
+    #if defined(_WIN32) || defined(_WIN64)
+        gmtime_s(&utc, &timestamp);
+    #else
+        gmtime_r(&timestamp, &utc);
+    #endif
+    const uint32_t month = static_cast<uint32_t>(utc.tm_year + 1900) * 100 + static_cast<uint32_t>(utc.tm_mon + 1);
+    return AppConfig::ARCHIVE_BUCKET_BY_DAY ? month * 100 + static_cast<uint32_t>(utc.tm_mday) : month;
+}
+
+bool TransactionArchive::open() {
+    loadedSegments.clear();
+    nextSequence = 1;
+    allSegmentsOpened = true;
+    std::error_code ec;
+    if (!std::filesystem::exists(directory, ec)) {
+        return true; // Nothing archived yet
+    }
+
+    std::vector<std::pair<uint64_t, std::string>> found;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(SEGMENT_PREFIX, 0) != 0 || entry.path().extension() != SEGMENT_EXTENSION) {
+            continue; // Also skips leftover .tmp files from an interrupted append
+        }
+        try {
+            // Parsing stops at the '-' in front of the bucket (older segment names have none)
+            found.emplace_back(std::stoull(name.substr(std::strlen(SEGMENT_PREFIX))), entry.path().string());
+        } catch (const std::exception&) {
+            LOG_WARNING("Ignoring unrecognized archive file: " + entry.path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    loadedSegments.reserve(found.size());
+    for (const auto& item : found) {
+        ArchiveSegment segment;
+        std::string error;
+        if (!segment.open(item.second, item.first, AppConfig::VERIFY_ARCHIVE_CHECKSUMS_ON_OPEN, error)) {
+            LOG_ERROR("Could not open archive segment " + item.second + ": " + error);
+            allSegmentsOpened = false;
+        } else {
+            afterOpen(segment);
+            loadedSegments.push_back(std::move(segment));
+        }
+        nextSequence = std::max(nextSequence, item.first + 1);
+    }
+
+    // Merges and compression write their segment before deleting the ones it replaces. Leftovers
+    // of a crash in between are duplicates and are removed now: merge inputs lie in the merged
+    // segment's sequence range and bucket, and a rewritten segment kept its sequence but has a
+    // name from before bucketed naming.
+    std::vector<bool> superseded(loadedSegments.size(), false);
+    for (const ArchiveSegment& newer : loadedSegments) {
+        if (newer.recordCount() == 0) {
+            continue;
+        }
+        const uint32_t bucket = timeBucket(newer.oldestTimestamp());
+        const std::string canonicalName = std::filesystem::path(segmentPath(newer.sequence(), bucket)).filename().string();
+        const bool canonical = std::filesystem::path(newer.path()).filename().string() == canonicalName;
+        for (size_t i = 0; i < loadedSegments.size(); ++i) {
+            const ArchiveSegment& older = loadedSegments[i];
+            if (&older == &newer || older.recordCount() == 0 || timeBucket(older.oldestTimestamp()) != bucket) {
+                continue;
+            }
+            const bool mergedInto = older.sequence() >= newer.firstMergedSequence() && older.sequence() < newer.sequence();
+            const bool rewritten = older.sequence() == newer.sequence() && canonical;
+            if (mergedInto || rewritten) {
+                superseded[i] = true;
+            }
+        }
+    }
+    std::vector<ArchiveSegment> current;
+    current.reserve(loadedSegments.size());
+    for (size_t i = 0; i < loadedSegments.size(); ++i) {
+        if (!superseded[i]) {
+            current.push_back(std::move(loadedSegments[i]));
+            continue;
+        }
+        const std::string path = loadedSegments[i].path();
+        loadedSegments[i].unload();
+        LOG_WARNING("Removing archive segment already replaced by an interrupted compaction: " + path);
+        std::filesystem::remove(path, ec);
+    }
+    loadedSegments = std::move(current);
+
+    LOG_INFO("Opened " + std::to_string(loadedSegments.size()) + " archive segments holding " +
+             std::to_string(transactionCount()) + " transactions");
+    return allSegmentsOpened;
+}
+
+size_t TransactionArchive::transactionCount() const {
+    size_t total = 0;
+    for (const auto& segment : loadedSegments) {
+        total += segment.recordCount();
+    }
+    return total;
+}
+
+void TransactionArchive::afterOpen(ArchiveSegment& segment) const {
+    if (AppConfig::LAZY_ARCHIVE_LOADING) {
+        segment.unload(); // Only the metadata stays in memory until a query needs the segment
+    }
+}
+
+const ArchiveSegment* TransactionArchive::acquire(size_t position) const {
+    if (position >= loadedSegments.size()) {
+        return nullptr;
+    }
+    const ArchiveSegment& segment = loadedSegments[position];
+    if (!segment.load()) {
+        return nullptr;
+    }
+    segment.lastUse = ++useClock;
+    return &segment;
+}
+
+void TransactionArchive::releaseCold() const {
+    if (!AppConfig::LAZY_ARCHIVE_LOADING) {
+        return;
+    }
+    size_t mapped = mappedBytes();
+    if (mapped <= AppConfig::ARCHIVE_MAPPED_BYTES_BUDGET) {
+        return;
+    }
+    std::vector<const ArchiveSegment*> loaded;
+    for (const ArchiveSegment& segment : loadedSegments) {
+        if (segment.isLoaded()) {
+            loaded.push_back(&segment);
+        }
+    }
+    std::sort(loaded.begin(), loaded.end(),
+              [](const ArchiveSegment* a, const ArchiveSegment* b) { return a->lastUse < b->lastUse; });
+    for (const ArchiveSegment* segment : loaded) {
+        if (mapped <= AppConfig::ARCHIVE_MAPPED_BYTES_BUDGET) {
+            break;
+        }
+        mapped -= segment->mappedBytes();
+        segment->unload();
+    }
+}
+
+size_t TransactionArchive::mappedBytes() const {
+    size_t total = 0;
+    for (const ArchiveSegment& segment : loadedSegments) {
+        total += segment.mappedBytes();
+    }
+    return total;
+}
+
+bool TransactionArchive::appendSegment(const std::vector<Transaction>& transactions, size_t first, size_t count) {
+    if (first >= transactions.size()) {
+        return true;
+    }
+    count = std::min(count, transactions.size() - first);
+    if (count == 0) {
+        return true;
+    }
+
+    // Records are stored in timestamp order so per-wallet postings can be binary searched by time
+    std::vector<TransactionView> records;
+    records.reserve(count);
+    for (size_t i = first; i < first + count; ++i) {
+        records.push_back(TransactionView::of(transactions[i]));
+    }
+    std::stable_sort(records.begin(), records.end(), [](const TransactionView& a, const TransactionView& b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    ArchiveSegment segment;
+    if (!writeSegment(records, transactions[first + count - 1].transactionId.view(), nextSequence, nextSequence, false, segment)) {
+        return false;
+    }
+    ++nextSequence;
+    LOG_INFO("Archived " + std::to_string(count) + " transactions to " + segment.path());
+    loadedSegments.push_back(std::move(segment));
+    return true;
+}
+
+bool TransactionArchive::writeSegment(const std::vector<TransactionView>& records, std::string_view lastAppendedId,
+                                      uint64_t sequence, uint64_t firstMergedSequence, bool compressed,
+                                      ArchiveSegment& outSegment) {
+    std::unordered_map<std::string_view, std::vector<uint32_t>> postingsByWallet;
+    for (uint32_t recordNumber = 0; recordNumber < records.size(); ++recordNumber) {
+        const TransactionView& tx = records[recordNumber];
+        postingsByWallet[tx.sourceWalletId].push_back(recordNumber);
+        if (tx.targetWalletId != tx.sourceWalletId) {
+            postingsByWallet[tx.targetWalletId].push_back(recordNumber);
+        }
+    }
+
+    // Uncompressed records share the segment heap; compressed blocks carry their own
+    StringHeap heap;
+    std::string recordBytes;
+    std::string blockTableBytes;
+    std::string blockBytes;
+    const CompressionCodec codec = BlockCodec::preferred();
+    const size_t blockRecords = AppConfig::COLD_ARCHIVE_BLOCK_RECORDS;
+    if (!compressed) {
+        recordBytes.reserve(records.size() * RECORD_SIZE);
+        for (const TransactionView& tx : records) {
+            putRecord(recordBytes, heap, tx);
+        }
+    } else {
+        recordBytes.reserve(records.size() * TIMESTAMP_SIZE);
+        for (const TransactionView& tx : records) {
+            putLittleEndian(recordBytes, static_cast<uint64_t>(static_cast<int64_t>(tx.timestamp)), 8);
+        }
+        for (size_t first = 0; first < records.size(); first += blockRecords) {
+            const size_t end = std::min(records.size(), first + blockRecords);
+            std::string raw;
+            encodeBlock(records, first, end, raw);
+            std::string packed;
+            if (!BlockCodec::compress(codec, raw.data(), raw.size(), packed)) {
+                LOG_ERROR("Could not compress archive block for segment " + std::to_string(sequence));
+                return false;
+            }
+            putLittleEndian(blockTableBytes, static_cast<uint64_t>(static_cast<int64_t>(records[first].timestamp)), 8);
+            putLittleEndian(blockTableBytes, static_cast<uint64_t>(static_cast<int64_t>(records[end - 1].timestamp)), 8);
+            putLittleEndian(blockTableBytes, blockBytes.size(), 8);
+            putLittleEndian(blockTableBytes, packed.size(), 4);
+            putLittleEndian(blockTableBytes, raw.size(), 4);
+            putLittleEndian(blockTableBytes, BinarySnapshot::crc32(raw.data(), raw.size()), 4);
+            putLittleEndian(blockTableBytes, 0, 4);
+            blockBytes += packed;
+        }
+    }
+
+    std::vector<std::string_view> walletIds;
+    walletIds.reserve(postingsByWallet.size());
+    for (const auto& item : postingsByWallet) {
+        walletIds.push_back(item.first);
+    }
+    std::sort(walletIds.begin(), walletIds.end());
+
+    std::string walletBytes;
+    std::string postingBytes;
+    uint32_t postingCount = 0;
+    for (std::string_view walletId : walletIds) {
+        const std::vector<uint32_t>& postings = postingsByWallet[walletId];
+        putString(walletBytes, heap, walletId);
+        putLittleEndian(walletBytes, postingCount, 4);
+        putLittleEndian(walletBytes, postings.size(), 4);
+        for (uint32_t recordNumber : postings) {
+            putLittleEndian(postingBytes, recordNumber, 4);
+        }
+        postingCount += static_cast<uint32_t>(postings.size());
+    }
+    const auto lastId = heap.add(lastAppendedId);
+
+    std::string body = recordBytes + blockTableBytes + walletBytes + postingBytes + heap.bytes + blockBytes;
+    std::string header(MAGIC, sizeof(MAGIC));
+    putLittleEndian(header, compressed ? COMPRESSED_FORMAT_VERSION : FORMAT_VERSION, 2);
+    putLittleEndian(header, compressed ? static_cast<uint8_t>(codec) : 0, 1);
+    putLittleEndian(header, 0, 1);
+    putLittleEndian(header, records.size(), 4);
+    putLittleEndian(header, walletIds.size(), 4);
+    putLittleEndian(header, postingCount, 4);
+    putLittleEndian(header, lastId.first, 4);
+    putLittleEndian(header, lastId.second, 4);
+    putLittleEndian(header, BinarySnapshot::crc32(body.data(), body.size()), 4);
+    const uint64_t recordsOffset = compressed ? COMPRESSED_HEADER_SIZE : HEADER_SIZE;
+    const uint64_t blockTableOffset = recordsOffset + recordBytes.size();
+    const uint64_t walletsOffset = blockTableOffset + blockTableBytes.size();
+    const uint64_t postingsOffset = walletsOffset + walletBytes.size();
+    const uint64_t heapOffset = postingsOffset + postingBytes.size();
+    putLittleEndian(header, recordsOffset, 8);
+    putLittleEndian(header, walletsOffset, 8);
+    putLittleEndian(header, postingsOffset, 8);
+    putLittleEndian(header, heapOffset, 8);
+    putLittleEndian(header, firstMergedSequence, 8);
+    if (compressed) {
+        putLittleEndian(header, blockTableOffset, 8);
+        putLittleEndian(header, heapOffset + heap.bytes.size(), 8);
+        putLittleEndian(header, (records.size() + blockRecords - 1) / blockRecords, 4);
+        putLittleEndian(header, blockRecords, 4);
+    }
+
+    // Published atomically and durably: the archived transactions are dropped from the hot
+    // snapshot (or the merged segments deleted) afterwards, so the segment must survive a crash first
+    std::filesystem::create_directories(directory);
+    const uint32_t bucket = records.empty() ? 0 : timeBucket(records.front().timestamp);
+    const std::string finalPath = segmentPath(sequence, bucket);
+    std::string writeError;
+    const bool written = DurableFile::writeAtomically(finalPath, [&](std::ostream& out) {
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(body.data(), static_cast<std::streamsize>(body.size()));
+        return out.good();
+    }, writeError);
+    if (!written) {
+        LOG_ERROR("Could not write archive segment " + finalPath + ": " + writeError);
+        return false;
+    }
+
+    std::string error;
+    if (!outSegment.open(finalPath, sequence, true, error)) {
+        LOG_ERROR("Archive segment " + finalPath + " failed verification: " + error);
+        return false;
+    }
+    afterOpen(outSegment);
+    return true;
+}
+
+bool TransactionArchive::compact(time_t now) {
+    bool compacted = true;
+
+    if (AppConfig::ARCHIVE_RETENTION_DAYS > 0) {
+        const time_t cutoff = now - static_cast<time_t>(AppConfig::ARCHIVE_RETENTION_DAYS) * 24 * 60 * 60;
+        std::vector<ArchiveSegment> kept;
+        kept.reserve(loadedSegments.size());
+        for (size_t i = 0; i < loadedSegments.size(); ++i) {
+            ArchiveSegment& segment = loadedSegments[i];
+            // The newest segment stays: reconcileWithArchive finds the last archived transaction in it
+            const bool newest = i + 1 == loadedSegments.size();
+            if (!newest && segment.newestTimestamp() < cutoff) {
+                if (retireSegment(segment)) {
+                    continue;
+                }
+                compacted = false;
+            }
+            kept.push_back(std::move(segment));
+        }
+        loadedSegments = std::move(kept);
+    }
+
+    if (!allSegmentsOpened) {
+        // A segment that failed to open could lie inside a merged range and be deleted as superseded
+        LOG_WARNING("Skipping archive segment merges because a segment could not be opened");
+        return compacted;
+    }
+    const uint32_t currentBucket = timeBucket(now);
+    const time_t coldCutoff = AppConfig::COLD_ARCHIVE_AFTER_DAYS > 0
+                                  ? now - static_cast<time_t>(AppConfig::COLD_ARCHIVE_AFTER_DAYS) * 24 * 60 * 60
+                                  : std::numeric_limits<time_t>::min();
+    std::vector<uint32_t> failedBuckets;
+    while (true) {
+        std::map<uint32_t, std::vector<size_t>> closedBuckets;
+        for (size_t i = 0; i < loadedSegments.size(); ++i) {
+            const ArchiveSegment& segment = loadedSegments[i];
+            if (segment.recordCount() == 0) {
+                continue;
+            }
+            const uint32_t bucket = timeBucket(segment.oldestTimestamp());
+            // Skip the bucket still being filled and segments written before bucketing that span several
+            if (bucket >= currentBucket || timeBucket(segment.newestTimestamp()) != bucket ||
+                std::find(failedBuckets.begin(), failedBuckets.end(), bucket) != failedBuckets.end()) {
+                continue;
+            }
+            closedBuckets[bucket].push_back(i);
+        }
+        auto mergeable = std::find_if(closedBuckets.begin(), closedBuckets.end(),
+                                      [](const auto& item) { return item.second.size() > 1; });
+        if (mergeable == closedBuckets.end()) {
+            break;
+        }
+        const bool cold = loadedSegments[mergeable->second.back()].newestTimestamp() < coldCutoff;
+        if (!mergeSegments(mergeable->second, cold)) {
+            failedBuckets.push_back(mergeable->first);
+            compacted = false;
+        }
+    }
+
+    for (size_t i = 0; i < loadedSegments.size(); ++i) {
+        const ArchiveSegment& segment = loadedSegments[i];
+        if (!segment.isCompressed() && segment.recordCount() > 0 && segment.newestTimestamp() < coldCutoff &&
+            !compressSegment(i)) {
+            compacted = false;
+        }
+    }
+    return compacted;
+}
+
+bool TransactionArchive::mergeSegments(const std::vector<size_t>& positions, bool compressed) {
+    size_t total = 0;
+    uint64_t firstMerged = loadedSegments[positions.front()].firstMergedSequence();
+    for (size_t position : positions) {
+        if (!loadedSegments[position].load()) {
+            return false;
+        }
+        total += loadedSegments[position].recordCount();
+        firstMerged = std::min(firstMerged, loadedSegments[position].firstMergedSequence());
+    }
+    DetachedRecords records;
+    records.views.reserve(total);
+    for (size_t position : positions) {
+        const ArchiveSegment& segment = loadedSegments[position];
+        for (size_t r = 0; r < segment.recordCount(); ++r) {
+            records.add(segment.record(r));
+        }
+    }
+    // Stable, so equal timestamps keep segment order, which is how history queries break ties
+    std::stable_sort(records.views.begin(), records.views.end(), [](const TransactionView& a, const TransactionView& b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    // Taking over the newest input's sequence and last appended id keeps reconcileWithArchive working
+    const ArchiveSegment& newest = loadedSegments[positions.back()];
+    // The merged file may replace the newest input, which must not be mapped by then
+    for (size_t position : positions) {
+        loadedSegments[position].unload();
+    }
+    ArchiveSegment merged;
+    if (!writeSegment(records.views, newest.lastAppendedTransactionId(), newest.sequence(), firstMerged, compressed,
+                      merged)) {
+        if (!AppConfig::LAZY_ARCHIVE_LOADING) {
+            for (size_t position : positions) {
+                loadedSegments[position].load(); // Every segment stays mapped when not loading lazily
+            }
+        }
+        return false;
+    }
+
+    // The merged file may have replaced the newest input under the same name
+    std::vector<std::string> obsoletePaths;
+    for (auto it = positions.rbegin(); it != positions.rend(); ++it) {
+        ArchiveSegment& input = loadedSegments[*it];
+        if (input.path() != merged.path()) {
+            obsoletePaths.push_back(input.path());
+        }
+        input.unload();
+        loadedSegments.erase(loadedSegments.begin() + static_cast<std::ptrdiff_t>(*it));
+    }
+    auto insertAt = std::find_if(loadedSegments.begin(), loadedSegments.end(), [&merged](const ArchiveSegment& segment) {
+        return segment.sequence() > merged.sequence();
+    });
+    const std::string mergedPath = merged.path();
+    loadedSegments.insert(insertAt, std::move(merged));
+
+    for (const std::string& path : obsoletePaths) {
+        std::error_code ec;
+        if (!std::filesystem::remove(path, ec) && ec) {
+            LOG_WARNING("Could not remove merged archive segment " + path + " (removed on the next start): " + ec.message());
+        }
+    }
+    LOG_INFO("Merged " + std::to_string(positions.size()) + " archive segments holding " +
+             std::to_string(total) + " transactions into " + mergedPath);
+    return true;
+}
+
+bool TransactionArchive::compressSegment(size_t position) {
+    ArchiveSegment& segment = loadedSegments[position];
+    if (!segment.load()) {
+        return false;
+    }
+    DetachedRecords records;
+    records.views.reserve(segment.recordCount());
+    for (size_t r = 0; r < segment.recordCount(); ++r) {
+        records.add(segment.record(r));
+    }
+    const size_t originalSize = segment.mappedBytes();
+    // The rewritten file replaces this one, which must not be mapped by then
+    segment.unload();
+    // Same sequence, merge range and last appended id, so only the encoding changes
+    ArchiveSegment rewritten;
+    if (!writeSegment(records.views, segment.lastAppendedTransactionId(), segment.sequence(),
+                      segment.firstMergedSequence(), true, rewritten)) {
+        if (!AppConfig::LAZY_ARCHIVE_LOADING) {
+            segment.load();
+        }
+        return false;
+    }
+    std::error_code ec;
+    const uintmax_t compressedSize = std::filesystem::file_size(rewritten.path(), ec);
+    const std::string originalPath = segment.path();
+    if (originalPath != rewritten.path() && !std::filesystem::remove(originalPath, ec) && ec) {
+        LOG_WARNING("Could not remove archive segment " + originalPath + " (removed on the next start): " + ec.message());
+    }
+    LOG_INFO("Compressed archive segment " + rewritten.path() + " from " + std::to_string(originalSize) +
+             " to " + std::to_string(compressedSize) + " bytes");
+    segment = std::move(rewritten);
+    return true;
+}
+
+bool TransactionArchive::retireSegment(ArchiveSegment& segment) {
+    std::error_code ec;
+    std::filesystem::create_directories(retiredDirectory, ec);
+    const std::string source = segment.path();
+    const std::string target = retiredDirectory + std::filesystem::path(source).filename().string();
+    std::filesystem::rename(source, target, ec);
+    if (ec) {
+        LOG_ERROR("Could not move archive segment " + source + " to " + target + ": " + ec.message());
+        return false;
+    }
+    segment.unload();
+    DurableFile::syncParentDirectory(source);
+    DurableFile::syncParentDirectory(target);
+    LOG_INFO("Moved archive segment " + source + " past the retention period to " + target);
+    return true;
+}
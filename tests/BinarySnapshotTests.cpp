@@ -0,0 +1,137 @@
+// tests/BinarySnapshotTests.cpp
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "TestSupport.hpp"
+#include "utils/BinarySnapshot.hpp"
+
+namespace {
+    constexpr size_t HEADER_SIZE = 32; // See the layout in BinarySnapshot.hpp
+
+    std::vector<Transaction> sampleTransactions() {
+        std::vector<Transaction> transactions;
+        transactions.push_back(makeTransaction("TXN-1", "WALLET-A", "WALLET-B", Money::fromPoints(40), 1700000000));
+        Transaction deposit = makeTransaction("DEP-A-LONGER-THAN-SIXTEEN", "SYSTEM_DEPOSIT", "WALLET-A",
+                                              Money::fromMinorUnits(123456789), 1700000100, TransactionStatus::Failed);
+        deposit.setReason(TransactionReason::Deposit, {"thuong Tet", "ADMIN-1"});
+        transactions.push_back(deposit);
+        Transaction pending = makeTransaction("TXN-2", "WALLET-B", "WALLET-A", Money::fromMinorUnits(1), 1700000200,
+                                              TransactionStatus::Pending);
+        pending.setReason(TransactionReason::Note, {""});
+        transactions.push_back(pending);
+        return transactions;
+    }
+
+    void flipByte(const std::string& path, std::streamoff offset) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(offset);
+        const char original = static_cast<char>(file.get());
+        file.seekp(offset);
+        file.put(static_cast<char>(original ^ 0x5A));
+    }
+}
+
+TEST(BinarySnapshotTest, TransactionsRoundTrip) {
+    TempDirectory dir;
+    const std::string path = dir.file("transactions.bin");
+    const std::vector<Transaction> written = sampleTransactions();
+    ASSERT_TRUE(BinarySnapshot::write(path, written));
+
+    std::vector<Transaction> read;
+    std::string error;
+    ASSERT_TRUE(BinarySnapshot::read(path, read, error)) << error;
+    ASSERT_EQ(read.size(), written.size());
+    for (size_t i = 0; i < written.size(); ++i) {
+        EXPECT_EQ(read[i].transactionId, written[i].transactionId);
+        EXPECT_EQ(read[i].sourceWalletId, written[i].sourceWalletId);
+        EXPECT_EQ(read[i].targetWalletId, written[i].targetWalletId);
+        EXPECT_EQ(read[i].amount, written[i].amount);
+        EXPECT_EQ(read[i].timestamp, written[i].timestamp);
+        EXPECT_EQ(read[i].status, written[i].status);
+        EXPECT_EQ(read[i].reason, written[i].reason);
+        EXPECT_EQ(read[i].description(), written[i].description());
+    }
+}
+
+TEST(BinarySnapshotTest, UsersAndWalletsRoundTrip) {
+    TempDirectory dir;
+    User user;
+    user.userId = "USER-1";
+    user.username = "alice";
+    user.role = UserRole::AdminUser;
+    user.status = AccountStatus::Active;
+    user.isTemporaryPassword = true;
+    UserDetails details;
+    details.passwordHash = "hash";
+    details.fullName = "Nguyen Van A";
+    details.email = "a@example.com";
+    details.phoneNumber = "0900000000";
+    details.otpSecretKey = "JBSWY3DPEHPK3PXP";
+    ASSERT_TRUE(BinarySnapshot::write(dir.file("users.bin"), {user}, {details}));
+
+    std::vector<User> users;
+    std::vector<UserDetails> userDetails;
+    std::string error;
+    ASSERT_TRUE(BinarySnapshot::read(dir.file("users.bin"), users, userDetails, error)) << error;
+    ASSERT_EQ(users.size(), 1u);
+    ASSERT_EQ(userDetails.size(), 1u);
+    EXPECT_EQ(users[0].userId, user.userId);
+    EXPECT_EQ(users[0].username, user.username);
+    EXPECT_EQ(users[0].role, user.role);
+    EXPECT_EQ(users[0].status, user.status);
+    EXPECT_TRUE(users[0].isTemporaryPassword);
+    EXPECT_EQ(userDetails[0].email, details.email);
+    EXPECT_EQ(userDetails[0].otpSecretKey, details.otpSecretKey);
+
+    Wallet wallet = makeWallet("WALLET-A", "USER-1", Money::fromMinorUnits(-2500));
+    wallet.creationTimestamp = 1600000000;
+    wallet.lastUpdateTimestamp = 1700000000;
+    ASSERT_TRUE(BinarySnapshot::write(dir.file("wallets.bin"), std::vector<Wallet>{wallet}));
+    std::vector<Wallet> wallets;
+    ASSERT_TRUE(BinarySnapshot::read(dir.file("wallets.bin"), wallets, error)) << error;
+    ASSERT_EQ(wallets.size(), 1u);
+    EXPECT_EQ(wallets[0].walletId, wallet.walletId);
+    EXPECT_EQ(wallets[0].userId, wallet.userId);
+    EXPECT_EQ(wallets[0].balance, wallet.balance);
+    EXPECT_EQ(wallets[0].creationTimestamp, wallet.creationTimestamp);
+    EXPECT_EQ(wallets[0].lastUpdateTimestamp, wallet.lastUpdateTimestamp);
+}
+
+TEST(BinarySnapshotTest, CorruptedPayloadFailsTheChecksum) {
+    TempDirectory dir;
+    const std::string path = dir.file("transactions.bin");
+    ASSERT_TRUE(BinarySnapshot::write(path, sampleTransactions()));
+    flipByte(path, static_cast<std::streamoff>(HEADER_SIZE + 10));
+
+    std::vector<Transaction> read;
+    std::string error;
+    EXPECT_FALSE(BinarySnapshot::read(path, read, error));
+    EXPECT_TRUE(read.empty());
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(BinarySnapshotTest, TruncatedOrForeignFilesAreRejected) {
+    TempDirectory dir;
+    const std::string path = dir.file("transactions.bin");
+    ASSERT_TRUE(BinarySnapshot::write(path, sampleTransactions()));
+    std::string error;
+
+    // A snapshot of another record kind
+    std::vector<Wallet> wallets;
+    EXPECT_FALSE(BinarySnapshot::read(path, wallets, error));
+    EXPECT_TRUE(wallets.empty());
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    std::vector<Transaction> read;
+    EXPECT_FALSE(BinarySnapshot::read(path, read, error));
+    EXPECT_TRUE(read.empty());
+
+    EXPECT_FALSE(BinarySnapshot::read(dir.file("missing.bin"), read, error));
+}
+
+TEST(BinarySnapshotTest, Crc32MatchesTheStandardCheckValue) {
+    const std::string input = "123456789";
+    EXPECT_EQ(BinarySnapshot::crc32(input.data(), input.size()), 0xCBF43926u);
+}
@@ -0,0 +1,70 @@
+// tests/BlockCodecTests.cpp
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "utils/BlockCodec.hpp"
+
+namespace {
+    std::vector<CompressionCodec> supportedCodecs() {
+        std::vector<CompressionCodec> codecs;
+        for (CompressionCodec codec : {CompressionCodec::None, CompressionCodec::BuiltinLz, CompressionCodec::Zstd}) {
+            if (BlockCodec::isSupported(codec)) {
+                codecs.push_back(codec);
+            }
+        }
+        return codecs;
+    }
+
+    // Archive-like data: records repeating most of their bytes, longer than the 64 KiB window
+    std::string repetitiveData() {
+        std::string data;
+        for (int i = 0; data.size() < 200000; ++i) {
+            data += "TXN-" + std::to_string(i) + "|WALLET-A|WALLET-B|Chuyen diem tu tester|1700000000\n";
+        }
+        return data;
+    }
+
+    std::string noiseData(size_t size) {
+        std::string data(size, '\0');
+        uint32_t state = 12345;
+        for (char& c : data) {
+            state = state * 1103515245u + 12345u;
+            c = static_cast<char>(state >> 24);
+        }
+        return data;
+    }
+}
+
+TEST(BlockCodecTest, RoundTripsEveryKindOfInput) {
+    const std::vector<std::string> inputs = {std::string(), "a", "abcabcabcabcabcabc", repetitiveData(), noiseData(70000)};
+    for (CompressionCodec codec : supportedCodecs()) {
+        for (const std::string& input : inputs) {
+            std::string packed;
+            ASSERT_TRUE(BlockCodec::compress(codec, input.data(), input.size(), packed));
+            std::string unpacked;
+            ASSERT_TRUE(BlockCodec::decompress(codec, packed.data(), packed.size(), input.size(), unpacked))
+                << "codec " << static_cast<int>(codec) << ", " << input.size() << " bytes";
+            EXPECT_EQ(unpacked, input);
+        }
+    }
+}
+
+TEST(BlockCodecTest, CompressesRepetitiveData) {
+    const std::string input = repetitiveData();
+    std::string packed;
+    ASSERT_TRUE(BlockCodec::compress(BlockCodec::preferred(), input.data(), input.size(), packed));
+    EXPECT_LT(packed.size(), input.size() / 3);
+}
+
+TEST(BlockCodecTest, DamagedInputFailsCleanly) {
+    const std::string input = repetitiveData();
+    for (CompressionCodec codec : supportedCodecs()) {
+        std::string packed;
+        ASSERT_TRUE(BlockCodec::compress(codec, input.data(), input.size(), packed));
+        std::string unpacked;
+        EXPECT_FALSE(BlockCodec::decompress(codec, packed.data(), packed.size() / 2, input.size(), unpacked));
+        EXPECT_FALSE(BlockCodec::decompress(codec, packed.data(), packed.size(), input.size() + 1, unpacked));
+        EXPECT_FALSE(BlockCodec::decompress(codec, packed.data(), packed.size(), input.size() - 1, unpacked));
+    }
+}
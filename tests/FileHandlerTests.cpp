@@ -0,0 +1,174 @@
+// tests/FileHandlerTests.cpp
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "TestSupport.hpp"
+#include "utils/FileHandler.hpp"
+#include "Config.h"
+
+namespace {
+    // Wallet data as loaded by a fresh FileHandler, the way the application starts
+    struct LoadedWalletData {
+        std::vector<Wallet> wallets;
+        std::vector<Transaction> transactions;
+        bool loaded = false;
+    };
+
+    LoadedWalletData loadWalletData(const std::string& dataDir) {
+        LoadedWalletData data;
+        FileHandler fileHandler(dataDir);
+        data.loaded = fileHandler.loadWalletData(data.wallets, data.transactions);
+        return data;
+    }
+
+    // Two wallets, then a transfer between them, each written as one commit
+    void commitTransfer(FileHandler& fileHandler, std::vector<Wallet>& wallets, std::vector<Transaction>& transactions) {
+        wallets.push_back(makeWallet("WALLET-A", "USER-A", Money::fromPoints(100)));
+        wallets.push_back(makeWallet("WALLET-B", "USER-B", Money()));
+        ASSERT_TRUE(fileHandler.commitWalletData(wallets, transactions));
+        wallets[0].balance = Money::fromPoints(60);
+        wallets[1].balance = Money::fromPoints(40);
+        fileHandler.markWalletDirty(0);
+        fileHandler.markWalletDirty(1);
+        transactions.push_back(makeTransaction("TXN-1", "WALLET-A", "WALLET-B", Money::fromPoints(40), 1700000000));
+        ASSERT_TRUE(fileHandler.commitWalletData(wallets, transactions));
+    }
+}
+
+TEST(FileHandlerTest, CommitsAreReplayedFromTheLog) {
+    TempDirectory dir;
+    const std::string dataDir = dir.directory("data");
+    {
+        FileHandler fileHandler(dataDir);
+        std::vector<Wallet> wallets;
+        std::vector<Transaction> transactions;
+        ASSERT_TRUE(fileHandler.loadWalletData(wallets, transactions));
+        commitTransfer(fileHandler, wallets, transactions);
+    }
+
+    const LoadedWalletData data = loadWalletData(dataDir);
+    ASSERT_TRUE(data.loaded);
+    ASSERT_EQ(data.wallets.size(), 2u);
+    EXPECT_EQ(data.wallets[0].balance, Money::fromPoints(60));
+    EXPECT_EQ(data.wallets[1].balance, Money::fromPoints(40));
+    ASSERT_EQ(data.transactions.size(), 1u);
+    EXPECT_EQ(data.transactions[0].transactionId, "TXN-1");
+    EXPECT_EQ(data.transactions[0].amount, Money::fromPoints(40));
+}
+
+// A crash in the middle of an append leaves a torn record; the commits before it still count
+TEST(FileHandlerTest, TornLogTailIsDroppedOnReplay) {
+    TempDirectory dir;
+    const std::string dataDir = dir.directory("data");
+    {
+        FileHandler fileHandler(dataDir);
+        std::vector<Wallet> wallets;
+        std::vector<Transaction> transactions;
+        ASSERT_TRUE(fileHandler.loadWalletData(wallets, transactions));
+        commitTransfer(fileHandler, wallets, transactions);
+    }
+    {
+        std::ofstream log(dataDir + AppConfig::WRITE_AHEAD_LOG_FILENAME, std::ios::app);
+        log << "80 {\"transactions\":[{\"transactionId\":\"TXN-2\"";
+    }
+
+    {
+        FileHandler fileHandler(dataDir);
+        std::vector<Wallet> wallets;
+        std::vector<Transaction> transactions;
+        ASSERT_TRUE(fileHandler.loadWalletData(wallets, transactions));
+        ASSERT_EQ(transactions.size(), 1u);
+        EXPECT_EQ(wallets[0].balance, Money::fromPoints(60));
+        // Commits after the torn record must not be hidden behind it
+        transactions.push_back(makeTransaction("TXN-3", "WALLET-B", "WALLET-A", Money::fromPoints(5), 1700000100));
+        ASSERT_TRUE(fileHandler.commitWalletData(wallets, transactions));
+    }
+    const LoadedWalletData data = loadWalletData(dataDir);
+    ASSERT_TRUE(data.loaded);
+    ASSERT_EQ(data.transactions.size(), 2u);
+    EXPECT_EQ(data.transactions[1].transactionId, "TXN-3");
+}
+
+// After a failed append no later commit is appended behind it; the first one that can be
+// written again goes out as a checkpoint holding everything before it
+TEST(FileHandlerTest, FailedAppendBlocksTheLogUntilACheckpoint) {
+    TempDirectory dir;
+    const std::string dataDir = dir.directory("data");
+    const std::filesystem::path logPath = dataDir + AppConfig::WRITE_AHEAD_LOG_FILENAME;
+    {
+        FileHandler fileHandler(dataDir);
+        std::vector<Wallet> wallets;
+        std::vector<Transaction> transactions;
+        ASSERT_TRUE(fileHandler.loadWalletData(wallets, transactions));
+        commitTransfer(fileHandler, wallets, transactions);
+
+        // The log cannot be opened while a directory stands in its place
+        std::filesystem::remove(logPath);
+        std::filesystem::create_directory(logPath);
+        transactions.push_back(makeTransaction("TXN-2", "WALLET-A", "WALLET-B", Money::fromPoints(1), 1700000050));
+        EXPECT_FALSE(fileHandler.commitWalletData(wallets, transactions));
+        transactions.push_back(makeTransaction("TXN-3", "WALLET-A", "WALLET-B", Money::fromPoints(2), 1700000060));
+        EXPECT_FALSE(fileHandler.commitWalletData(wallets, transactions));
+
+        std::filesystem::remove(logPath);
+        transactions.push_back(makeTransaction("TXN-4", "WALLET-A", "WALLET-B", Money::fromPoints(3), 1700000070));
+        EXPECT_TRUE(fileHandler.commitWalletData(wallets, transactions));
+    }
+
+    const LoadedWalletData data = loadWalletData(dataDir);
+    ASSERT_TRUE(data.loaded);
+    ASSERT_EQ(data.transactions.size(), 4u);
+    EXPECT_EQ(data.transactions[3].transactionId, "TXN-4");
+}
+
+TEST(FileHandlerTest, CheckpointEmptiesTheLog) {
+    TempDirectory dir;
+    const std::string dataDir = dir.directory("data");
+    const std::filesystem::path logPath = dataDir + AppConfig::WRITE_AHEAD_LOG_FILENAME;
+    {
+        FileHandler fileHandler(dataDir);
+        std::vector<Wallet> wallets;
+        std::vector<Transaction> transactions;
+        ASSERT_TRUE(fileHandler.loadWalletData(wallets, transactions));
+        const std::uintmax_t emptyLogSize = std::filesystem::file_size(logPath); // Just the header
+        commitTransfer(fileHandler, wallets, transactions);
+        EXPECT_GT(std::filesystem::file_size(logPath), emptyLogSize);
+
+        ASSERT_TRUE(fileHandler.checkpoint(wallets, transactions));
+        EXPECT_EQ(std::filesystem::file_size(logPath), emptyLogSize);
+    }
+
+    const LoadedWalletData data = loadWalletData(dataDir);
+    ASSERT_TRUE(data.loaded);
+    ASSERT_EQ(data.wallets.size(), 2u);
+    EXPECT_EQ(data.wallets[1].balance, Money::fromPoints(40));
+    EXPECT_EQ(data.transactions.size(), 1u);
+}
+
+// A crash after a checkpoint rewrote the snapshots but before it reset the log replays the old
+// log over the new snapshots, which must neither duplicate transactions nor change balances
+TEST(FileHandlerTest, LogReplayedOverNewerSnapshotsIsHarmless) {
+    TempDirectory dir;
+    const std::string dataDir = dir.directory("data");
+    const std::filesystem::path logPath = dataDir + AppConfig::WRITE_AHEAD_LOG_FILENAME;
+    const std::filesystem::path staleLogPath = dir.file("stale.wal");
+    {
+        FileHandler fileHandler(dataDir);
+        std::vector<Wallet> wallets;
+        std::vector<Transaction> transactions;
+        ASSERT_TRUE(fileHandler.loadWalletData(wallets, transactions));
+        commitTransfer(fileHandler, wallets, transactions);
+        std::filesystem::copy_file(logPath, staleLogPath);
+        ASSERT_TRUE(fileHandler.checkpoint(wallets, transactions));
+    }
+    std::filesystem::copy_file(staleLogPath, logPath, std::filesystem::copy_options::overwrite_existing);
+
+    const LoadedWalletData data = loadWalletData(dataDir);
+    ASSERT_TRUE(data.loaded);
+    ASSERT_EQ(data.wallets.size(), 2u);
+    EXPECT_EQ(data.wallets[0].balance, Money::fromPoints(60));
+    EXPECT_EQ(data.wallets[1].balance, Money::fromPoints(40));
+    ASSERT_EQ(data.transactions.size(), 1u);
+    EXPECT_EQ(data.transactions[0].transactionId, "TXN-1");
+}
@@ -0,0 +1,96 @@
+// tests/IdempotencyCacheTests.cpp
+#include <gtest/gtest.h>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+#include "utils/IdempotencyCache.hpp"
+
+namespace {
+    IdempotencyCache::Outcome outcome(bool success, const std::string& transactionId) {
+        IdempotencyCache::Outcome result;
+        result.success = success;
+        result.message = success ? "ok" : "failed";
+        result.transactionId = transactionId;
+        result.fingerprint = "WALLET-B:100";
+        return result;
+    }
+}
+
+TEST(IdempotencyCacheTest, CompletedOutcomeIsReturnedToRetries) {
+    IdempotencyCache cache(16, std::chrono::seconds(60));
+    IdempotencyCache::Reservation first;
+    EXPECT_FALSE(cache.claim("key", first));
+    ASSERT_TRUE(first.active());
+    first.complete(outcome(true, "TXN-1"));
+
+    IdempotencyCache::Reservation retry;
+    const std::optional<IdempotencyCache::Outcome> earlier = cache.claim("key", retry);
+    ASSERT_TRUE(earlier);
+    EXPECT_FALSE(retry.active());
+    EXPECT_TRUE(earlier->success);
+    EXPECT_EQ(earlier->transactionId, "TXN-1");
+}
+
+TEST(IdempotencyCacheTest, UncompletedReservationReleasesTheKey) {
+    IdempotencyCache cache(16, std::chrono::seconds(60));
+    {
+        IdempotencyCache::Reservation abandoned;
+        EXPECT_FALSE(cache.claim("key", abandoned));
+    }
+    IdempotencyCache::Reservation next;
+    EXPECT_FALSE(cache.claim("key", next));
+    EXPECT_TRUE(next.active());
+}
+
+TEST(IdempotencyCacheTest, ConcurrentClaimWaitsForTheRunningRequest) {
+    IdempotencyCache cache(16, std::chrono::seconds(60));
+    IdempotencyCache::Reservation running;
+    ASSERT_FALSE(cache.claim("key", running));
+
+    std::optional<IdempotencyCache::Outcome> seen;
+    std::thread retry([&] {
+        IdempotencyCache::Reservation reservation;
+        seen = cache.claim("key", reservation);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    running.complete(outcome(false, "TXN-2"));
+    retry.join();
+
+    ASSERT_TRUE(seen);
+    EXPECT_FALSE(seen->success);
+    EXPECT_EQ(seen->transactionId, "TXN-2");
+}
+
+TEST(IdempotencyCacheTest, OldestFinishedKeysAreEvictedAboveCapacity) {
+    IdempotencyCache cache(2, std::chrono::seconds(60));
+    for (const char* key : {"a", "b", "c"}) {
+        IdempotencyCache::Reservation reservation;
+        ASSERT_FALSE(cache.claim(key, reservation));
+        reservation.complete(outcome(true, std::string("TXN-") + key));
+    }
+    IdempotencyCache::Reservation reservation;
+    EXPECT_TRUE(cache.claim("c", reservation));
+    EXPECT_FALSE(cache.claim("a", reservation)); // Must be looked up elsewhere again
+}
+
+TEST(IdempotencyCacheTest, ExpiredKeysAreForgotten) {
+    IdempotencyCache cache(16, std::chrono::seconds(0));
+    {
+        IdempotencyCache::Reservation reservation;
+        ASSERT_FALSE(cache.claim("key", reservation));
+        reservation.complete(outcome(true, "TXN-1"));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    IdempotencyCache::Reservation reservation;
+    EXPECT_FALSE(cache.claim("key", reservation));
+}
+
+TEST(IdempotencyCacheTest, TransactionIdIsDerivedFromTheKey) {
+    const std::string id = IdempotencyCache::transactionIdFor("TXN-", "transfer:U1:key");
+    EXPECT_EQ(id, IdempotencyCache::transactionIdFor("TXN-", "transfer:U1:key"));
+    EXPECT_NE(id, IdempotencyCache::transactionIdFor("TXN-", "transfer:U2:key"));
+    ASSERT_EQ(id.size(), 4u + 12u);
+    EXPECT_EQ(id.rfind("TXN-", 0), 0u);
+    EXPECT_EQ(id.find_first_not_of("0123456789abcdef", 4), std::string::npos);
+}
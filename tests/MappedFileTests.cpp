@@ -0,0 +1,41 @@
+// tests/MappedFileTests.cpp
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <utility>
+#include "TestSupport.hpp"
+#include "utils/MappedFile.hpp"
+
+TEST(MappedFileTest, MapsTheWholeFile) {
+    TempDirectory dir;
+    const std::string path = dir.file("data.bin");
+    std::string contents(10000, '\0');
+    for (size_t i = 0; i < contents.size(); ++i) {
+        contents[i] = static_cast<char>(i * 31);
+    }
+    std::ofstream(path, std::ios::binary) << contents;
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(path));
+    ASSERT_TRUE(file.isOpen());
+    ASSERT_EQ(file.size(), contents.size());
+    EXPECT_EQ(std::string(file.data(), file.size()), contents);
+
+    // Moving hands over the mapping without copying it
+    const char* data = file.data();
+    MappedFile moved(std::move(file));
+    EXPECT_EQ(moved.data(), data);
+    EXPECT_EQ(moved.size(), contents.size());
+    EXPECT_FALSE(file.isOpen());
+
+    moved.close();
+    EXPECT_FALSE(moved.isOpen());
+    EXPECT_EQ(moved.size(), 0u);
+}
+
+TEST(MappedFileTest, MissingFileDoesNotOpen) {
+    TempDirectory dir;
+    MappedFile file;
+    EXPECT_FALSE(file.open(dir.file("missing.bin")));
+    EXPECT_FALSE(file.isOpen());
+}
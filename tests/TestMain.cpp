@@ -0,0 +1,12 @@
+// tests/TestMain.cpp
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "utils/Logger.hpp"
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    // Failure paths log errors on purpose; keep them in a file instead of the test output
+    const std::filesystem::path logPath = std::filesystem::temp_directory_path() / "reward_system_tests.log";
+    Logger::getInstance(logPath.string(), LogLevel::ERROR, LogLevel::DEBUG, false);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,58 @@
+// tests/TestSupport.hpp
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include "models/Transaction.hpp"
+#include "models/Wallet.hpp"
+
+// A fresh directory under the system temporary directory, removed with everything in it
+class TempDirectory {
+public:
+    TempDirectory() {
+        static std::atomic<unsigned> counter{0};
+        const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        root = std::filesystem::temp_directory_path() /
+               ("reward_system_test_" + std::to_string(stamp) + "_" + std::to_string(counter++));
+        std::filesystem::create_directories(root);
+    }
+    ~TempDirectory() {
+        std::error_code ec;
+        std::filesystem::remove_all(root, ec);
+    }
+    TempDirectory(const TempDirectory&) = delete;
+    TempDirectory& operator=(const TempDirectory&) = delete;
+
+    // Path of a file or directory inside; directories end with a separator, as the services expect
+    std::string file(const std::string& name) const { return (root / name).string(); }
+    std::string directory(const std::string& name) const { return (root / name).string() + "/"; }
+    const std::filesystem::path& path() const { return root; }
+
+private:
+    std::filesystem::path root;
+};
+
+inline Transaction makeTransaction(const std::string& id, const std::string& source, const std::string& target,
+                                   Money amount, time_t timestamp,
+                                   TransactionStatus status = TransactionStatus::Completed) {
+    Transaction tx;
+    tx.transactionId = id;
+    tx.sourceWalletId = source;
+    tx.targetWalletId = target;
+    tx.amount = amount;
+    tx.timestamp = timestamp;
+    tx.status = status;
+    tx.setReason(TransactionReason::Transfer, {"tester"});
+    return tx;
+}
+
+inline Wallet makeWallet(const std::string& walletId, const std::string& userId, Money balance) {
+    Wallet wallet;
+    wallet.walletId = walletId;
+    wallet.userId = userId;
+    wallet.balance = balance;
+    return wallet;
+}
@@ -0,0 +1,51 @@
+// tests/TimerWheelTests.cpp
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "utils/TimerWheel.hpp"
+
+namespace {
+    std::vector<std::string> sortedIds(const std::vector<Identifier>& ids) {
+        std::vector<std::string> result;
+        for (const Identifier& id : ids) {
+            result.push_back(id.str());
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+}
+
+TEST(TimerWheelTest, TimersExpireOnTheTickOfTheirDeadline) {
+    TimerWheel wheel(4, 10, 1000);
+    wheel.schedule(Identifier("soon"), 1020);
+    wheel.schedule(Identifier("next-turn"), 1100); // More than one turn of the wheel away
+    wheel.schedule(Identifier("overdue"), 900);
+
+    EXPECT_EQ(sortedIds(wheel.advance(1010)), std::vector<std::string>{"overdue"});
+    EXPECT_TRUE(wheel.advance(1019).empty());
+    EXPECT_EQ(sortedIds(wheel.advance(1020)), std::vector<std::string>{"soon"});
+    EXPECT_TRUE(wheel.advance(1090).empty());
+    EXPECT_EQ(sortedIds(wheel.advance(1100)), std::vector<std::string>{"next-turn"});
+    EXPECT_TRUE(wheel.advance(2000).empty());
+}
+
+// Deadlines between ticks are rounded up, never fired early
+TEST(TimerWheelTest, DeadlinesAreRoundedUpToATick) {
+    TimerWheel wheel(8, 10, 1000);
+    wheel.schedule(Identifier("between"), 1015);
+    EXPECT_TRUE(wheel.advance(1015).empty());
+    EXPECT_EQ(sortedIds(wheel.advance(1020)), std::vector<std::string>{"between"});
+}
+
+TEST(TimerWheelTest, LongPauseExpiresEveryDueTimerOnce) {
+    TimerWheel wheel(4, 10, 1000);
+    for (int i = 0; i < 20; ++i) {
+        wheel.schedule(Identifier("T" + std::to_string(i)), 1000 + i * 25);
+    }
+    wheel.schedule(Identifier("later"), 5000);
+
+    EXPECT_EQ(wheel.advance(1500).size(), 20u);
+    EXPECT_TRUE(wheel.advance(1500).empty());
+    EXPECT_EQ(sortedIds(wheel.advance(5000)), std::vector<std::string>{"later"});
+}
@@ -0,0 +1,201 @@
+// tests/TransactionArchiveTests.cpp
+#include <gtest/gtest.h>
+#include <fstream>
+#include <vector>
+#include "TestSupport.hpp"
+#include "utils/TransactionArchive.hpp"
+#include "Config.h"
+
+namespace {
+    constexpr time_t DAY = 24 * 60 * 60;
+
+    // A time in a closed, cold bucket (older than COLD_ARCHIVE_AFTER_DAYS, newer than the
+    // retention period) with room for `span` seconds in the same bucket
+    time_t coldBucketStart(time_t now, time_t span) {
+        time_t base = now - static_cast<time_t>(AppConfig::COLD_ARCHIVE_AFTER_DAYS + 60) * DAY;
+        while (TransactionArchive::timeBucket(base) != TransactionArchive::timeBucket(base + span)) {
+            base -= DAY;
+        }
+        return base;
+    }
+
+    std::vector<Transaction> makeRun(const std::string& prefix, size_t count, time_t first) {
+        std::vector<Transaction> run;
+        for (size_t i = 0; i < count; ++i) {
+            run.push_back(makeTransaction(prefix + std::to_string(i), "WALLET-A", i % 2 ? "WALLET-B" : "WALLET-C",
+                                          Money::fromPoints(static_cast<int64_t>(i + 1)),
+                                          first + static_cast<time_t>(i)));
+        }
+        return run;
+    }
+
+    size_t segmentFileCount(const TempDirectory& dir) {
+        size_t count = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(dir.path() / "archive")) {
+            count += entry.path().extension() == ".arc" ? 1 : 0;
+        }
+        return count;
+    }
+}
+
+TEST(TransactionArchiveTest, AppendedSegmentReadsBack) {
+    TempDirectory dir;
+    TransactionArchive archive(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(archive.open());
+    const std::vector<Transaction> run = makeRun("TXN-R", 5, 1700000000);
+    ASSERT_TRUE(archive.appendSegment(run, 0, run.size()));
+
+    TransactionArchive reopened(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(reopened.open());
+    ASSERT_EQ(reopened.segments().size(), 1u);
+    const ArchiveSegment* segment = reopened.acquire(0);
+    ASSERT_NE(segment, nullptr);
+    ASSERT_EQ(segment->recordCount(), run.size());
+    for (size_t i = 0; i < run.size(); ++i) {
+        const TransactionView view = segment->record(i);
+        EXPECT_EQ(view.transactionId, run[i].transactionId.view());
+        EXPECT_EQ(view.amount, run[i].amount);
+        EXPECT_EQ(view.timestamp, run[i].timestamp);
+    }
+    EXPECT_EQ(segment->postingsForWallet("WALLET-A").size(), run.size());
+    EXPECT_EQ(segment->postingsForWallet("WALLET-B").size(), 2u);
+}
+
+TEST(TransactionArchiveTest, UnloadedSegmentMapsAgainOnAcquire) {
+    TempDirectory dir;
+    TransactionArchive archive(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(archive.open());
+    const std::vector<Transaction> run = makeRun("TXN-U", 3, 1700000000);
+    ASSERT_TRUE(archive.appendSegment(run, 0, run.size()));
+
+    const ArchiveSegment& metadata = archive.segments()[0];
+    metadata.unload();
+    EXPECT_FALSE(metadata.isLoaded());
+    EXPECT_EQ(metadata.recordCount(), run.size()); // Metadata stays available
+    EXPECT_EQ(metadata.postingsForWallet("WALLET-A").size(), 0u);
+
+    const ArchiveSegment* segment = archive.acquire(0);
+    ASSERT_NE(segment, nullptr);
+    EXPECT_TRUE(segment->isLoaded());
+    EXPECT_EQ(segment->record(2).transactionId, "TXN-U2");
+}
+
+TEST(ArchiveSegmentTest, ChecksumRejectsCorruptedData) {
+    TempDirectory dir;
+    TransactionArchive archive(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(archive.open());
+    const std::vector<Transaction> run = makeRun("TXN-K", 4, 1700000000);
+    ASSERT_TRUE(archive.appendSegment(run, 0, run.size()));
+    const std::string path = archive.segments()[0].path();
+    archive.segments()[0].unload();
+    {
+        // The last byte belongs to the string heap
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(-1, std::ios::end);
+        const char last = static_cast<char>(file.get());
+        file.seekp(-1, std::ios::end);
+        file.put(static_cast<char>(last ^ 0x20));
+    }
+
+    std::string error;
+    ArchiveSegment unchecked;
+    EXPECT_TRUE(unchecked.open(path, 1, false, error)) << error;
+    ArchiveSegment checked;
+    EXPECT_FALSE(checked.open(path, 1, true, error));
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(ArchiveSegmentTest, TruncatedSegmentIsRejected) {
+    TempDirectory dir;
+    TransactionArchive archive(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(archive.open());
+    const std::vector<Transaction> run = makeRun("TXN-T", 4, 1700000000);
+    ASSERT_TRUE(archive.appendSegment(run, 0, run.size()));
+    const std::string path = archive.segments()[0].path();
+    archive.segments()[0].unload();
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+
+    ArchiveSegment segment;
+    std::string error;
+    EXPECT_FALSE(segment.open(path, 1, false, error));
+    EXPECT_FALSE(error.empty());
+}
+
+// Compaction rewrites segments that queries have mapped; the inputs must be unmapped before
+// their files are replaced (Windows cannot replace a mapped file)
+TEST(TransactionArchiveTest, CompactMergesAndCompressesMappedSegments) {
+    TempDirectory dir;
+    const time_t now = std::time(nullptr);
+    const time_t first = coldBucketStart(now, 100);
+    TransactionArchive archive(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(archive.open());
+    const std::vector<Transaction> older = makeRun("TXN-O", 4, first);
+    const std::vector<Transaction> newer = makeRun("TXN-N", 3, first + 50);
+    ASSERT_TRUE(archive.appendSegment(older, 0, older.size()));
+    ASSERT_TRUE(archive.appendSegment(newer, 0, newer.size()));
+    ASSERT_NE(archive.acquire(0), nullptr);
+    ASSERT_NE(archive.acquire(1), nullptr);
+
+    ASSERT_TRUE(archive.compact(now));
+
+    ASSERT_EQ(archive.segments().size(), 1u);
+    EXPECT_TRUE(archive.segments()[0].isCompressed());
+    EXPECT_EQ(segmentFileCount(dir), 1u);
+    const ArchiveSegment* merged = archive.acquire(0);
+    ASSERT_NE(merged, nullptr);
+    ASSERT_EQ(merged->recordCount(), older.size() + newer.size());
+    EXPECT_EQ(merged->record(0).transactionId, "TXN-O0");
+    EXPECT_EQ(merged->record(merged->recordCount() - 1).transactionId, "TXN-N2");
+    EXPECT_EQ(merged->lastAppendedTransactionId(), "TXN-N2");
+    EXPECT_EQ(merged->postingsForWallet("WALLET-A").size(), older.size() + newer.size());
+}
+
+TEST(TransactionArchiveTest, CompactCompressesAMappedSegmentInPlace) {
+    TempDirectory dir;
+    const time_t now = std::time(nullptr);
+    TransactionArchive archive(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(archive.open());
+    const std::vector<Transaction> run = makeRun("TXN-C", 6, coldBucketStart(now, 10));
+    ASSERT_TRUE(archive.appendSegment(run, 0, run.size()));
+    const ArchiveSegment* before = archive.acquire(0);
+    ASSERT_NE(before, nullptr);
+    const std::string path = before->path();
+
+    ASSERT_TRUE(archive.compact(now));
+
+    ASSERT_EQ(archive.segments().size(), 1u);
+    EXPECT_EQ(archive.segments()[0].path(), path);
+    EXPECT_TRUE(archive.segments()[0].isCompressed());
+    const ArchiveSegment* after = archive.acquire(0);
+    ASSERT_NE(after, nullptr);
+    ASSERT_EQ(after->recordCount(), run.size());
+    for (size_t i = 0; i < run.size(); ++i) {
+        EXPECT_EQ(after->record(i).transactionId, run[i].transactionId.view());
+        EXPECT_EQ(after->record(i).description(), run[i].description());
+    }
+
+    // The compressed segment also survives a restart
+    TransactionArchive reopened(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(reopened.open());
+    ASSERT_EQ(reopened.segments().size(), 1u);
+    EXPECT_TRUE(reopened.segments()[0].isCompressed());
+}
+
+TEST(TransactionArchiveTest, CompactRetiresSegmentsPastRetention) {
+    TempDirectory dir;
+    const time_t now = std::time(nullptr);
+    const time_t expired = now - static_cast<time_t>(AppConfig::ARCHIVE_RETENTION_DAYS + 30) * DAY;
+    TransactionArchive archive(dir.directory("archive"), dir.directory("retired"));
+    ASSERT_TRUE(archive.open());
+    const std::vector<Transaction> old = makeRun("TXN-X", 2, expired);
+    const std::vector<Transaction> recent = makeRun("TXN-Y", 2, now - DAY);
+    ASSERT_TRUE(archive.appendSegment(old, 0, old.size()));
+    ASSERT_TRUE(archive.appendSegment(recent, 0, recent.size()));
+
+    ASSERT_TRUE(archive.compact(now));
+
+    ASSERT_EQ(archive.segments().size(), 1u);
+    EXPECT_EQ(archive.segments()[0].lastAppendedTransactionId(), "TXN-Y1");
+    EXPECT_TRUE(std::filesystem::exists(dir.path() / "retired"));
+    EXPECT_FALSE(std::filesystem::is_empty(dir.path() / "retired"));
+}
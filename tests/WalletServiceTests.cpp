@@ -0,0 +1,394 @@
+// tests/WalletServiceTests.cpp
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TestSupport.hpp"
+#include "services/WalletService.hpp"
+#include "services/OTPService.hpp"
+#include "utils/DataIndex.hpp"
+#include "utils/FileHandler.hpp"
+#include "utils/HashUtils.hpp"
+#include "utils/TransactionArchive.hpp"
+#include "utils/TimeUtils.hpp"
+#include "Config.h"
+
+namespace {
+    // A WalletService over empty data in a temporary directory. Users added with addUser own
+    // one wallet each and have no OTP.
+    class WalletServiceTest : public ::testing::Test {
+    protected:
+        TempDirectory dir;
+        std::vector<User> users;
+        std::vector<UserDetails> userDetails;
+        std::vector<Wallet> wallets;
+        std::vector<Transaction> transactions;
+        FileHandler fileHandler{dir.directory("data")};
+        HashUtils hashUtils;
+        OTPService otpService;
+        DataIndex index{users, userDetails, wallets, transactions};
+        TransactionArchive archive{dir.directory("data/archive"), dir.directory("data/retired")};
+        WalletService service{users, wallets, transactions, index, archive, fileHandler, otpService, hashUtils};
+
+        void SetUp() override {
+            ASSERT_TRUE(fileHandler.loadWalletData(wallets, transactions));
+            ASSERT_TRUE(archive.open());
+        }
+
+        // Creates the user and its wallet; returns the wallet ID
+        std::string addUser(const std::string& userId) {
+            User user;
+            user.userId = userId;
+            user.username = "user_" + userId;
+            users.push_back(user);
+            userDetails.emplace_back();
+            std::string message;
+            EXPECT_TRUE(service.createWalletForUser(userId, message)) << message;
+            const std::optional<Wallet> wallet = service.getWalletByUserId(userId);
+            return wallet ? wallet->walletId.str() : std::string();
+        }
+
+        Money balanceOf(const std::string& walletId) const {
+            const std::optional<Wallet> wallet = service.getWalletByWalletId(walletId);
+            return wallet ? wallet->balance : Money();
+        }
+    };
+}
+
+// Pages are read through cursors across archived and in-memory transactions, including several
+// deposits sharing one timestamp
+TEST_F(WalletServiceTest, HistoryPagesCoverArchiveAndMemoryOnce) {
+    const std::string walletId = addUser("U0");
+    const time_t archivedFrom = TimeUtils::getCurrentTimestamp() - 3600;
+    std::vector<Transaction> archived;
+    for (int i = 0; i < 5; ++i) {
+        archived.push_back(makeTransaction("TXN-OLD" + std::to_string(i), "WALLET-OTHER", walletId,
+                                           Money::fromPoints(1), archivedFrom + i));
+    }
+    ASSERT_TRUE(archive.appendSegment(archived, 0, archived.size()));
+    std::string message;
+    for (int i = 0; i < 6; ++i) {
+        ASSERT_TRUE(service.depositPoints(walletId, Money::fromPoints(10), "seed", "ADMIN", message)) << message;
+    }
+
+    TransactionHistoryQuery query;
+    query.limit = 4;
+    std::vector<Transaction> all;
+    size_t pages = 0;
+    do {
+        const TransactionHistoryPage page = service.getTransactionHistoryPage(walletId, query);
+        ASSERT_LE(page.transactions.size(), query.limit);
+        all.insert(all.end(), page.transactions.begin(), page.transactions.end());
+        query.cursor = page.nextCursor;
+        ++pages;
+    } while (!query.cursor.empty() && pages < 10);
+
+    ASSERT_EQ(all.size(), 11u);
+    EXPECT_EQ(pages, 3u);
+    std::set<std::string> ids;
+    for (size_t i = 0; i < all.size(); ++i) {
+        ids.insert(all[i].transactionId.str());
+        if (i > 0) {
+            EXPECT_GE(all[i - 1].timestamp, all[i].timestamp);
+        }
+    }
+    EXPECT_EQ(ids.size(), all.size());
+    EXPECT_EQ(all.back().transactionId, "TXN-OLD0");
+    EXPECT_EQ(service.getTransactionHistory(walletId).size(), all.size());
+}
+
+TEST_F(WalletServiceTest, HistoryFiltersApplyBeforeTheLimit) {
+    const std::string walletId = addUser("U0");
+    const std::string otherId = addUser("U1");
+    std::string message;
+    ASSERT_TRUE(service.depositPoints(walletId, Money::fromPoints(5), "seed", "ADMIN", message));
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(service.transferPoints("U0", walletId, otherId, Money::fromPoints(1), "", message)) << message;
+    }
+    EXPECT_FALSE(service.transferPoints("U0", walletId, otherId, Money::fromPoints(100), "", message));
+
+    TransactionHistoryQuery query;
+    query.limit = 2;
+    query.reason = TransactionReason::Transfer;
+    query.status = TransactionStatus::Completed;
+    TransactionHistoryPage page = service.getTransactionHistoryPage(walletId, query);
+    ASSERT_EQ(page.transactions.size(), 2u);
+    ASSERT_FALSE(page.nextCursor.empty());
+    query.cursor = page.nextCursor;
+    page = service.getTransactionHistoryPage(walletId, query);
+    ASSERT_EQ(page.transactions.size(), 1u);
+    EXPECT_TRUE(page.nextCursor.empty());
+    EXPECT_EQ(page.transactions[0].status, TransactionStatus::Completed);
+    EXPECT_EQ(page.transactions[0].reason, TransactionReason::Transfer);
+}
+
+TEST_F(WalletServiceTest, HistoryHonoursTimeRangeAndRejectsBadCursors) {
+    const std::string walletId = addUser("U0");
+    const time_t base = TimeUtils::getCurrentTimestamp() - 1000;
+    std::vector<Transaction> archived;
+    for (int i = 0; i < 10; ++i) {
+        archived.push_back(makeTransaction("TXN-T" + std::to_string(i), "WALLET-OTHER", walletId,
+                                           Money::fromPoints(1), base + i * 10));
+    }
+    ASSERT_TRUE(archive.appendSegment(archived, 0, archived.size()));
+
+    TransactionHistoryQuery query;
+    query.limit = 100;
+    query.fromTimestamp = base + 20;
+    query.toTimestamp = base + 50;
+    const TransactionHistoryPage page = service.getTransactionHistoryPage(walletId, query);
+    ASSERT_EQ(page.transactions.size(), 4u);
+    EXPECT_EQ(page.transactions.front().transactionId, "TXN-T5");
+    EXPECT_EQ(page.transactions.back().transactionId, "TXN-T2");
+    EXPECT_TRUE(page.nextCursor.empty());
+
+    for (const std::string cursor : {"garbage", ":TXN-T1", "12x:TXN-T1", "123:"}) {
+        TransactionHistoryQuery bad;
+        bad.cursor = cursor;
+        EXPECT_TRUE(service.getTransactionHistoryPage(walletId, bad).transactions.empty()) << cursor;
+    }
+    TransactionHistoryQuery none;
+    none.limit = 0;
+    EXPECT_TRUE(service.getTransactionHistoryPage(walletId, none).transactions.empty());
+}
+
+// Master wallet shards may go negative, so a batch must not debit one like a user wallet
+TEST_F(WalletServiceTest, BatchRejectsMasterShardAsTransferSource) {
+    const std::string walletId = addUser("U0");
+    ASSERT_TRUE(service.ensureMasterWalletShards());
+    std::string shardId;
+    for (const Wallet& wallet : wallets) {
+        if (wallet.userId == AppConfig::MASTER_WALLET_ID) {
+            shardId = wallet.walletId.str();
+        }
+    }
+    ASSERT_FALSE(shardId.empty());
+
+    WalletPosting fromShard;
+    fromShard.targetWalletId = walletId;
+    fromShard.amount = Money::fromPoints(1000);
+    fromShard.sourceWalletId = shardId;
+    fromShard.debitSource = true;
+    fromShard.reason = TransactionReason::Transfer;
+    WalletPosting fromMaster;
+    fromMaster.targetWalletId = walletId;
+    fromMaster.amount = Money::fromPoints(7);
+    fromMaster.sourceWalletId = AppConfig::MASTER_WALLET_ID;
+    fromMaster.reason = TransactionReason::AdminDeposit;
+
+    const std::vector<PostingResult> results = service.postBatch({fromShard, fromMaster}, "ADMIN");
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_FALSE(results[0].success);
+    EXPECT_TRUE(results[1].success);
+    EXPECT_EQ(balanceOf(walletId), Money::fromPoints(7));
+    EXPECT_EQ(service.getMasterWalletBalance(), Money::fromPoints(-7));
+}
+
+// Transfers between overlapping wallet pairs run on many threads while history is read; no
+// points may be created or lost and no balance may go negative
+TEST_F(WalletServiceTest, ConcurrentTransfersConservePoints) {
+    constexpr int WALLETS = 6;
+    constexpr int THREADS = 8;
+    constexpr int TRANSFERS_PER_THREAD = 40;
+    std::vector<std::string> walletIds;
+    std::string message;
+    for (int i = 0; i < WALLETS; ++i) {
+        walletIds.push_back(addUser("U" + std::to_string(i)));
+        ASSERT_TRUE(service.depositPoints(walletIds.back(), Money::fromPoints(50), "seed", "ADMIN", message));
+    }
+
+    std::atomic<int> succeeded{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (int n = 0; n < TRANSFERS_PER_THREAD; ++n) {
+                const int from = (t + n) % WALLETS;
+                const int to = (from + 1 + (n % (WALLETS - 1))) % WALLETS;
+                std::string outMessage;
+                if (service.transferPoints("U" + std::to_string(from), walletIds[from], walletIds[to],
+                                           Money::fromPoints(1 + (n % 7)), "", outMessage)) {
+                    ++succeeded;
+                }
+            }
+        });
+    }
+    // History pages are read meanwhile; each must come out newest first
+    std::atomic<bool> writing{true};
+    std::thread reader([&] {
+        while (writing) {
+            TransactionHistoryQuery query;
+            query.limit = 5;
+            do {
+                const TransactionHistoryPage page = service.getTransactionHistoryPage(walletIds[0], query);
+                for (size_t i = 1; i < page.transactions.size(); ++i) {
+                    EXPECT_GE(page.transactions[i - 1].timestamp, page.transactions[i].timestamp);
+                }
+                query.cursor = page.nextCursor;
+            } while (!query.cursor.empty());
+        }
+    });
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    writing = false;
+    reader.join();
+
+    Money total;
+    size_t completedTransfers = 0;
+    for (const std::string& walletId : walletIds) {
+        const Money balance = balanceOf(walletId);
+        EXPECT_GE(balance, Money()) << walletId;
+        total += balance;
+        for (const Transaction& tx : service.getTransactionHistory(walletId)) {
+            completedTransfers += tx.sourceWalletId == walletId && tx.reason == TransactionReason::Transfer &&
+                                  tx.status == TransactionStatus::Completed;
+        }
+    }
+    EXPECT_EQ(total, Money::fromPoints(50 * WALLETS));
+    EXPECT_EQ(service.getTotalBalance(), total);
+    EXPECT_EQ(completedTransfers, static_cast<size_t>(succeeded.load()));
+}
+
+TEST_F(WalletServiceTest, RetriedTransferWithAKeyRunsOnce) {
+    const std::string from = addUser("U0");
+    const std::string to = addUser("U1");
+    std::string message;
+    ASSERT_TRUE(service.depositPoints(from, Money::fromPoints(100), "seed", "ADMIN", message));
+
+    EXPECT_TRUE(service.transferPoints("U0", from, to, Money::fromPoints(30), "", message, "order-1"));
+    EXPECT_TRUE(service.transferPoints("U0", from, to, Money::fromPoints(30), "", message, "order-1"));
+    EXPECT_EQ(balanceOf(to), Money::fromPoints(30));
+    // The same key for a different transfer is rejected
+    EXPECT_FALSE(service.transferPoints("U0", from, to, Money::fromPoints(31), "", message, "order-1"));
+    EXPECT_EQ(balanceOf(to), Money::fromPoints(30));
+
+    // A rejected transfer is not run again either, even once the funds are there
+    EXPECT_FALSE(service.transferPoints("U0", from, to, Money::fromPoints(500), "", message, "order-2"));
+    ASSERT_TRUE(service.depositPoints(from, Money::fromPoints(500), "seed", "ADMIN", message));
+    EXPECT_FALSE(service.transferPoints("U0", from, to, Money::fromPoints(500), "", message, "order-2"));
+    EXPECT_EQ(balanceOf(to), Money::fromPoints(30));
+}
+
+TEST_F(WalletServiceTest, ConcurrentRetriesWithOneKeyTransferOnce) {
+    const std::string from = addUser("U0");
+    const std::string to = addUser("U1");
+    std::string message;
+    ASSERT_TRUE(service.depositPoints(from, Money::fromPoints(100), "seed", "ADMIN", message));
+
+    std::atomic<int> succeeded{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            std::string outMessage;
+            if (service.transferPoints("U0", from, to, Money::fromPoints(10), "", outMessage, "retry-key")) {
+                ++succeeded;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(succeeded.load(), 8); // Every retry reports the first outcome
+    EXPECT_EQ(balanceOf(to), Money::fromPoints(10));
+    EXPECT_EQ(service.getTransactionHistory(to).size(), 1u);
+}
+
+// A write error is not the answer to a keyed request: the retry runs the transfer again
+TEST_F(WalletServiceTest, KeyedTransferCanBeRetriedAfterAWriteError) {
+    const std::string from = addUser("U0");
+    const std::string to = addUser("U1");
+    std::string message;
+    ASSERT_TRUE(service.depositPoints(from, Money::fromPoints(100), "seed", "ADMIN", message));
+
+    // The write-ahead log cannot be written while a directory stands in its place
+    const std::filesystem::path logPath = dir.directory("data") + AppConfig::WRITE_AHEAD_LOG_FILENAME;
+    std::filesystem::remove(logPath);
+    std::filesystem::create_directory(logPath);
+    EXPECT_FALSE(service.transferPoints("U0", from, to, Money::fromPoints(25), "", message, "order-1"));
+    EXPECT_EQ(balanceOf(from), Money::fromPoints(100));
+
+    std::filesystem::remove(logPath);
+    EXPECT_TRUE(service.transferPoints("U0", from, to, Money::fromPoints(25), "", message, "order-1")) << message;
+    EXPECT_EQ(balanceOf(from), Money::fromPoints(75));
+    EXPECT_EQ(balanceOf(to), Money::fromPoints(25));
+    EXPECT_TRUE(service.transferPoints("U0", from, to, Money::fromPoints(25), "", message, "order-1"));
+    EXPECT_EQ(balanceOf(to), Money::fromPoints(25));
+}
+
+TEST_F(WalletServiceTest, HeldPointsCannotBeSpentUntilSettled) {
+    const std::string from = addUser("U0");
+    const std::string to = addUser("U1");
+    std::string message;
+    ASSERT_TRUE(service.depositPoints(from, Money::fromPoints(100), "seed", "ADMIN", message));
+
+    std::string committed;
+    std::string cancelled;
+    ASSERT_TRUE(service.reserveTransfer("U0", from, to, Money::fromPoints(60), "", committed, message)) << message;
+    EXPECT_FALSE(service.reserveTransfer("U0", from, to, Money::fromPoints(60), "", cancelled, message));
+    EXPECT_FALSE(service.transferPoints("U0", from, to, Money::fromPoints(50), "", message));
+    ASSERT_TRUE(service.reserveTransfer("U0", from, to, Money::fromPoints(30), "", cancelled, message));
+    EXPECT_EQ(service.getWalletByWalletId(from)->held, Money::fromPoints(90));
+    EXPECT_EQ(balanceOf(from), Money::fromPoints(100));
+
+    // Only the owner of the sender wallet settles a hold, and only once
+    EXPECT_FALSE(service.commitTransfer("U1", committed, message));
+    EXPECT_TRUE(service.commitTransfer("U0", committed, message)) << message;
+    EXPECT_FALSE(service.commitTransfer("U0", committed, message));
+    EXPECT_FALSE(service.commitTransfer("U0", "TXN-DOES-NOT-EXIST", message));
+    EXPECT_TRUE(service.cancelTransfer("U0", cancelled, message)) << message;
+    EXPECT_FALSE(service.commitTransfer("U0", cancelled, message));
+
+    const std::optional<Wallet> sender = service.getWalletByWalletId(from);
+    EXPECT_EQ(sender->balance, Money::fromPoints(40));
+    EXPECT_EQ(sender->held, Money());
+    EXPECT_EQ(balanceOf(to), Money::fromPoints(60));
+}
+
+// Holds left pending by an earlier run are restored on startup and expire once their timeout has passed
+TEST_F(WalletServiceTest, RestoredHoldsExpireAfterTheirTimeout) {
+    const std::string from = addUser("U0");
+    const std::string to = addUser("U1");
+    std::string message;
+    ASSERT_TRUE(service.depositPoints(from, Money::fromPoints(100), "seed", "ADMIN", message));
+    const time_t now = TimeUtils::getCurrentTimestamp();
+    transactions.push_back(makeTransaction("TXN-STALE", from, to, Money::fromPoints(20),
+                                           now - AppConfig::PENDING_TRANSFER_TIMEOUT_SECONDS - 60,
+                                           TransactionStatus::Pending));
+    transactions.push_back(makeTransaction("TXN-RECENT", from, to, Money::fromPoints(5), now,
+                                           TransactionStatus::Pending));
+    service.restorePendingTransfers();
+    EXPECT_EQ(service.getWalletByWalletId(from)->held, Money::fromPoints(25));
+
+    service.releaseExpiredHolds();
+    EXPECT_EQ(service.getWalletByWalletId(from)->held, Money::fromPoints(5));
+    EXPECT_EQ(index.findTransactionById("TXN-STALE")->status, TransactionStatus::Cancelled);
+    EXPECT_EQ(index.findTransactionById("TXN-RECENT")->status, TransactionStatus::Pending);
+    EXPECT_EQ(balanceOf(from), Money::fromPoints(100));
+    EXPECT_EQ(balanceOf(to), Money());
+}
+
+// An expired hold whose cancellation cannot be saved keeps its points on hold (and is tried again later)
+TEST_F(WalletServiceTest, ExpiredHoldStaysHeldWhenItsCancellationFails) {
+    const std::string from = addUser("U0");
+    const std::string to = addUser("U1");
+    std::string message;
+    ASSERT_TRUE(service.depositPoints(from, Money::fromPoints(100), "seed", "ADMIN", message));
+    transactions.push_back(makeTransaction("TXN-STALE", from, to, Money::fromPoints(20),
+                                           TimeUtils::getCurrentTimestamp() - AppConfig::PENDING_TRANSFER_TIMEOUT_SECONDS - 60,
+                                           TransactionStatus::Pending));
+    service.restorePendingTransfers();
+
+    const std::filesystem::path logPath = dir.directory("data") + AppConfig::WRITE_AHEAD_LOG_FILENAME;
+    std::filesystem::remove(logPath);
+    std::filesystem::create_directory(logPath);
+    service.releaseExpiredHolds();
+    EXPECT_EQ(service.getWalletByWalletId(from)->held, Money::fromPoints(20));
+    EXPECT_EQ(index.findTransactionById("TXN-STALE")->status, TransactionStatus::Pending);
+
+    std::filesystem::remove(logPath);
+    ASSERT_TRUE(service.cancelTransfer("U0", "TXN-STALE", message)) << message;
+    EXPECT_EQ(service.getWalletByWalletId(from)->held, Money());
+}